@@ -327,34 +327,9 @@ bool reshade::d3d10::runtime_d3d10::capture_screenshot(uint8_t *buffer) const
 		return false;
 	auto mapped_data = static_cast<const uint8_t *>(mapped.pData);
 
-	for (uint32_t y = 0, pitch = _width * 4; y < _height; y++, buffer += pitch, mapped_data += mapped.RowPitch)
-	{
-		if (_backbuffer_format == DXGI_FORMAT_R10G10B10A2_UNORM ||
-			_backbuffer_format == DXGI_FORMAT_R10G10B10A2_UINT)
-		{
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ((rgba & 0x3FF) / 4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0xFFC00) >> 10) / 4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) / 4) & 0xFF;
-				buffer[x + 3] = 0xFF;
-			}
-		}
-		else
-		{
-			std::memcpy(buffer, mapped_data, pitch);
-
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				buffer[x + 3] = 0xFF; // Clear alpha channel
-				if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
-					_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
-					std::swap(buffer[x + 0], buffer[x + 2]); // Format is BGRA, but output should be RGBA, so flip channels
-			}
-		}
-	}
+	// Screenshots are always RGBA without transparency, regardless of the back buffer format
+	const pixel_format src_format = pixel_format_from_dxgi(_backbuffer_format);
+	convert_pixels(src_format, mapped_data, mapped.RowPitch, pixel_format_for_screenshot(src_format), buffer, _width * 4, _width, _height, true);
 
 	intermediate->Unmap(0);
 
@@ -382,9 +357,12 @@ bool reshade::d3d10::runtime_d3d10::init_effect(size_t index)
 	const std::string hlsl = effect.preamble + effect.module.hlsl;
 	std::unordered_map<std::string, com_ptr<IUnknown>> entry_points;
 
-	// Compile the generated HLSL source code to DX byte code
+	// Compile the generated HLSL source code to DX byte code (only for the techniques that are initialized now, the others are compiled once they get enabled)
 	for (const auto &entry_point : effect.module.entry_points)
 	{
+		if (!is_entry_point_pending(index, entry_point.name))
+			continue;
+
 		com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
 		std::string profile = entry_point.is_pixel_shader ? "ps" : "vs";
 
@@ -441,7 +419,8 @@ bool reshade::d3d10::runtime_d3d10::init_effect(size_t index)
 	if (index >= _effect_constant_buffers.size())
 		_effect_constant_buffers.resize(index + 1);
 
-	if (!effect.uniform_data_storage.empty())
+	// The constant buffer is shared by all techniques, so it already exists if this effect was initialized for other techniques before
+	if (!effect.uniform_data_storage.empty() && _effect_constant_buffers[index] == nullptr)
 	{
 		const D3D10_BUFFER_DESC desc = { static_cast<UINT>(effect.uniform_data_storage.size()), D3D10_USAGE_DYNAMIC, D3D10_BIND_CONSTANT_BUFFER, D3D10_CPU_ACCESS_WRITE };
 		const D3D10_SUBRESOURCE_DATA init_data = { effect.uniform_data_storage.data(), desc.ByteWidth };
@@ -471,10 +450,13 @@ bool reshade::d3d10::runtime_d3d10::init_effect(size_t index)
 
 		const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
 			[&texture_name = info.texture_name](const auto &item) {
-			return item.unique_name == texture_name && item.impl != nullptr;
+			return item.unique_name == texture_name;
 		});
 		if (existing_texture == _textures.end())
 			return false;
+		// Textures only used by techniques that are not enabled yet were not created, so there is nothing to bind
+		if (existing_texture->impl == nullptr)
+			continue;
 
 		D3D10_SAMPLER_DESC desc = {};
 		desc.Filter = static_cast<D3D10_FILTER>(info.filter);
@@ -523,7 +505,7 @@ bool reshade::d3d10::runtime_d3d10::init_effect(size_t index)
 
 	for (technique &technique : _techniques)
 	{
-		if (technique.impl != nullptr || technique.effect_index != index)
+		if (!is_technique_pending(technique, index))
 			continue;
 
 		// Copy construct new technique implementation instead of move because effect may contain multiple techniques
@@ -854,32 +836,22 @@ void reshade::d3d10::runtime_d3d10::upload_texture(texture &texture, const uint8
 	const auto impl = texture.impl->as<d3d10_tex_data>();
 	assert(impl != nullptr && texture.impl_reference == texture_reference::none && pixels != nullptr);
 
-	unsigned int upload_pitch;
+	// Images are always loaded as RGBA, so convert them to the layout of the texture first
+	const pixel_format format = pixel_format_from_texture_format(texture.format);
+	if (format == pixel_format::unknown)
+	{
+		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
+		return;
+	}
+
+	const unsigned int upload_pitch = texture.width * static_cast<unsigned int>(pixel_format_size(format));
 	std::vector<uint8_t> upload_data;
 
-	switch (texture.format)
+	if (format != pixel_format::rgba8_unorm)
 	{
-	case reshadefx::texture_format::r8:
-		upload_pitch = texture.width;
-		upload_data.resize(upload_pitch * texture.height);
-		for (uint32_t i = 0, k = 0; i < texture.width * texture.height * 4; i += 4, k += 1)
-			upload_data[k] = pixels[i];
-		pixels = upload_data.data();
-		break;
-	case reshadefx::texture_format::rg8:
-		upload_pitch = texture.width * 2;
 		upload_data.resize(upload_pitch * texture.height);
-		for (uint32_t i = 0, k = 0; i < texture.width * texture.height * 4; i += 4, k += 2)
-			upload_data[k + 0] = pixels[i + 0],
-			upload_data[k + 1] = pixels[i + 1];
+		convert_pixels(pixel_format::rgba8_unorm, pixels, texture.width * 4, format, upload_data.data(), upload_pitch, texture.width, texture.height);
 		pixels = upload_data.data();
-		break;
-	case reshadefx::texture_format::rgba8:
-		upload_pitch = texture.width * 4;
-		break;
-	default:
-		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
-		return;
 	}
 
 	_device->UpdateSubresource(impl->texture.get(), 0, nullptr, pixels, upload_pitch, upload_pitch * texture.height);
@@ -932,18 +904,19 @@ void reshade::d3d10::runtime_d3d10::render_technique(technique &technique)
 	if (const auto constant_buffer = _effect_constant_buffers[technique.effect_index].get();
 		constant_buffer != nullptr)
 	{
-		void *mapped;
-		if (HRESULT hr = constant_buffer->Map(D3D10_MAP_WRITE_DISCARD, 0, &mapped); SUCCEEDED(hr))
-		{
-			D3D10_BUFFER_DESC desc = {};
-			constant_buffer->GetDesc(&desc);
-
-			std::memcpy(mapped, _effects[technique.effect_index].uniform_data_storage.data(), desc.ByteWidth);
-			constant_buffer->Unmap();
-		}
-		else
+		// Discarding the buffer loses its previous contents, so the entire data has to be written whenever anything changed
+		if (size_t offset, size; consume_uniform_data_changes(technique.effect_index, offset, size, true))
 		{
-			LOG(ERROR) << "Failed to map constant buffer! HRESULT is " << hr << '.';
+			void *mapped;
+			if (HRESULT hr = constant_buffer->Map(D3D10_MAP_WRITE_DISCARD, 0, &mapped); SUCCEEDED(hr))
+			{
+				std::memcpy(mapped, _effects[technique.effect_index].uniform_data_storage.data(), size);
+				constant_buffer->Unmap();
+			}
+			else
+			{
+				LOG(ERROR) << "Failed to map constant buffer! HRESULT is " << hr << '.';
+			}
 		}
 
 		_device->VSSetConstantBuffers(0, 1, &constant_buffer);
@@ -221,6 +221,9 @@ void reshade::d3d11::runtime_d3d11::on_reset()
 	_depth_texture.reset();
 	_depth_texture_srv.reset();
 
+	for (com_ptr<ID3D11Texture2D> &intermediate : _readback_textures)
+		intermediate.reset();
+
 	_copy_vertex_shader.reset();
 	_copy_pixel_shader.reset();
 	_copy_sampler_state.reset();
@@ -310,6 +313,13 @@ void reshade::d3d11::runtime_d3d11::on_present(buffer_detection_context &tracker
 	_app_state.apply_and_release();
 }
 
+static void copy_screenshot_data(DXGI_FORMAT format, uint32_t width, uint32_t height, const uint8_t *mapped_data, uint32_t mapped_pitch, uint8_t *buffer)
+{
+	// Screenshots are always RGBA without transparency, regardless of the back buffer format
+	const reshade::pixel_format src_format = pixel_format_from_dxgi(format);
+	reshade::convert_pixels(src_format, mapped_data, mapped_pitch, reshade::pixel_format_for_screenshot(src_format), buffer, width * 4, width, height, true);
+}
+
 bool reshade::d3d11::runtime_d3d11::capture_screenshot(uint8_t *buffer) const
 {
 	// Create a texture in system memory, copy back buffer data into it and map it for reading
@@ -335,37 +345,52 @@ bool reshade::d3d11::runtime_d3d11::capture_screenshot(uint8_t *buffer) const
 	D3D11_MAPPED_SUBRESOURCE mapped;
 	if (FAILED(_immediate_context->Map(intermediate.get(), 0, D3D11_MAP_READ, 0, &mapped)))
 		return false;
-	auto mapped_data = static_cast<const uint8_t *>(mapped.pData);
 
-	for (uint32_t y = 0, pitch = _width * 4; y < _height; y++, buffer += pitch, mapped_data += mapped.RowPitch)
+	copy_screenshot_data(_backbuffer_format, _width, _height, static_cast<const uint8_t *>(mapped.pData), mapped.RowPitch, buffer);
+
+	_immediate_context->Unmap(intermediate.get(), 0);
+
+	return true;
+}
+
+bool reshade::d3d11::runtime_d3d11::begin_readback(unsigned int slot)
+{
+	// The staging textures are kept around until the next reset, so that continuous captures do not have to create new ones every time
+	com_ptr<ID3D11Texture2D> &intermediate = _readback_textures[slot];
+	if (intermediate == nullptr)
 	{
-		if (_backbuffer_format == DXGI_FORMAT_R10G10B10A2_UNORM ||
-			_backbuffer_format == DXGI_FORMAT_R10G10B10A2_UINT)
+		D3D11_TEXTURE2D_DESC desc = {};
+		desc.Width = _width;
+		desc.Height = _height;
+		desc.MipLevels = 1;
+		desc.ArraySize = 1;
+		desc.Format = _backbuffer_format;
+		desc.SampleDesc = { 1, 0 };
+		desc.Usage = D3D11_USAGE_STAGING;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+		if (FAILED(_device->CreateTexture2D(&desc, nullptr, &intermediate)))
 		{
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ((rgba & 0x3FF) / 4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0xFFC00) >> 10) / 4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) / 4) & 0xFF;
-				buffer[x + 3] = 0xFF;
-			}
-		}
-		else
-		{
-			std::memcpy(buffer, mapped_data, pitch);
-
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				buffer[x + 3] = 0xFF; // Clear alpha channel
-				if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
-					_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
-					std::swap(buffer[x + 0], buffer[x + 2]); // Format is BGRA, but output should be RGBA, so flip channels
-			}
+			LOG(ERROR) << "Failed to create system memory texture for deferred screenshot capture!";
+			return false;
 		}
 	}
 
+	_immediate_context->CopyResource(intermediate.get(), _backbuffer_resolved.get());
+
+	return true;
+}
+bool reshade::d3d11::runtime_d3d11::finish_readback(unsigned int slot, uint8_t *buffer)
+{
+	const com_ptr<ID3D11Texture2D> &intermediate = _readback_textures[slot];
+
+	// The copy was queued a few frames ago, so it has usually finished by now and this does not stall
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(_immediate_context->Map(intermediate.get(), 0, D3D11_MAP_READ, 0, &mapped)))
+		return false;
+
+	copy_screenshot_data(_backbuffer_format, _width, _height, static_cast<const uint8_t *>(mapped.pData), mapped.RowPitch, buffer);
+
 	_immediate_context->Unmap(intermediate.get(), 0);
 
 	return true;
@@ -392,9 +417,12 @@ bool reshade::d3d11::runtime_d3d11::init_effect(size_t index)
 	const std::string hlsl = effect.preamble + effect.module.hlsl;
 	std::unordered_map<std::string, com_ptr<IUnknown>> entry_points;
 
-	// Compile the generated HLSL source code to DX byte code
+	// Compile the generated HLSL source code to DX byte code (only for the techniques that are initialized now, the others are compiled once they get enabled)
 	for (const auto &entry_point : effect.module.entry_points)
 	{
+		if (!is_entry_point_pending(index, entry_point.name))
+			continue;
+
 		com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
 		std::string profile = entry_point.is_pixel_shader ? "ps" : "vs";
 
@@ -454,7 +482,8 @@ bool reshade::d3d11::runtime_d3d11::init_effect(size_t index)
 	if (index >= _effect_constant_buffers.size())
 		_effect_constant_buffers.resize(index + 1);
 
-	if (!effect.uniform_data_storage.empty())
+	// The constant buffer is shared by all techniques, so it already exists if this effect was initialized for other techniques before
+	if (!effect.uniform_data_storage.empty() && _effect_constant_buffers[index] == nullptr)
 	{
 		const D3D11_BUFFER_DESC desc = { static_cast<UINT>(effect.uniform_data_storage.size()), D3D11_USAGE_DYNAMIC, D3D11_BIND_CONSTANT_BUFFER, D3D11_CPU_ACCESS_WRITE };
 		const D3D11_SUBRESOURCE_DATA init_data = { effect.uniform_data_storage.data(), desc.ByteWidth };
@@ -484,10 +513,13 @@ bool reshade::d3d11::runtime_d3d11::init_effect(size_t index)
 
 		const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
 			[&texture_name = info.texture_name](const auto &item) {
-			return item.unique_name == texture_name && item.impl != nullptr;
+			return item.unique_name == texture_name;
 		});
 		if (existing_texture == _textures.end())
 			return false;
+		// Textures only used by techniques that are not enabled yet were not created, so there is nothing to bind
+		if (existing_texture->impl == nullptr)
+			continue;
 
 		D3D11_SAMPLER_DESC desc = {};
 		desc.Filter = static_cast<D3D11_FILTER>(info.filter);
@@ -536,7 +568,7 @@ bool reshade::d3d11::runtime_d3d11::init_effect(size_t index)
 
 	for (technique &technique : _techniques)
 	{
-		if (technique.impl != nullptr || technique.effect_index != index)
+		if (!is_technique_pending(technique, index))
 			continue;
 
 		// Copy construct new technique implementation instead of move because effect may contain multiple techniques
@@ -861,32 +893,22 @@ void reshade::d3d11::runtime_d3d11::upload_texture(texture &texture, const uint8
 	const auto impl = texture.impl->as<d3d11_tex_data>();
 	assert(impl != nullptr && texture.impl_reference == texture_reference::none && pixels != nullptr);
 
-	unsigned int upload_pitch;
+	// Images are always loaded as RGBA, so convert them to the layout of the texture first
+	const pixel_format format = pixel_format_from_texture_format(texture.format);
+	if (format == pixel_format::unknown)
+	{
+		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
+		return;
+	}
+
+	const unsigned int upload_pitch = texture.width * static_cast<unsigned int>(pixel_format_size(format));
 	std::vector<uint8_t> upload_data;
 
-	switch (texture.format)
+	if (format != pixel_format::rgba8_unorm)
 	{
-	case reshadefx::texture_format::r8:
-		upload_pitch = texture.width;
-		upload_data.resize(upload_pitch * texture.height);
-		for (uint32_t i = 0, k = 0; i < texture.width * texture.height * 4; i += 4, k += 1)
-			upload_data[k] = pixels[i];
-		pixels = upload_data.data();
-		break;
-	case reshadefx::texture_format::rg8:
-		upload_pitch = texture.width * 2;
 		upload_data.resize(upload_pitch * texture.height);
-		for (uint32_t i = 0, k = 0; i < texture.width * texture.height * 4; i += 4, k += 2)
-			upload_data[k + 0] = pixels[i + 0],
-			upload_data[k + 1] = pixels[i + 1];
+		convert_pixels(pixel_format::rgba8_unorm, pixels, texture.width * 4, format, upload_data.data(), upload_pitch, texture.width, texture.height);
 		pixels = upload_data.data();
-		break;
-	case reshadefx::texture_format::rgba8:
-		upload_pitch = texture.width * 4;
-		break;
-	default:
-		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
-		return;
 	}
 
 	_immediate_context->UpdateSubresource(impl->texture.get(), 0, nullptr, pixels, upload_pitch, upload_pitch * texture.height);
@@ -939,15 +961,19 @@ void reshade::d3d11::runtime_d3d11::render_technique(technique &technique)
 	if (const auto constant_buffer = _effect_constant_buffers[technique.effect_index].get();
 		constant_buffer != nullptr)
 	{
-		D3D11_MAPPED_SUBRESOURCE mapped;
-		if (HRESULT hr = _immediate_context->Map(constant_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped); SUCCEEDED(hr))
+		// Discarding the buffer loses its previous contents, so the entire data has to be written whenever anything changed
+		if (size_t offset, size; consume_uniform_data_changes(technique.effect_index, offset, size, true))
 		{
-			std::memcpy(mapped.pData, _effects[technique.effect_index].uniform_data_storage.data(), mapped.RowPitch);
-			_immediate_context->Unmap(constant_buffer, 0);
-		}
-		else
-		{
-			LOG(ERROR) << "Failed to map constant buffer! HRESULT is " << hr << '.';
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			if (HRESULT hr = _immediate_context->Map(constant_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped); SUCCEEDED(hr))
+			{
+				std::memcpy(mapped.pData, _effects[technique.effect_index].uniform_data_storage.data(), size);
+				_immediate_context->Unmap(constant_buffer, 0);
+			}
+			else
+			{
+				LOG(ERROR) << "Failed to map constant buffer! HRESULT is " << hr << '.';
+			}
 		}
 
 		_immediate_context->VSSetConstantBuffers(0, 1, &constant_buffer);
@@ -317,6 +317,11 @@ void reshade::d3d12::runtime_d3d12::on_reset()
 	_fence.clear();
 	_fence_value.clear();
 
+	for (com_ptr<ID3D12Resource> &intermediate : _readback_buffers)
+		intermediate.reset();
+	_readback_fence.reset();
+	_readback_fence_value = 0;
+
 	_backbuffers.clear();
 	_backbuffer_rtvs.reset();
 	_backbuffer_texture.reset();
@@ -383,10 +388,22 @@ void reshade::d3d12::runtime_d3d12::on_present(buffer_detection_context &tracker
 	_commandqueue->Signal(_fence[_swap_index].get(), ++_fence_value[_swap_index]);
 }
 
+static uint32_t calc_download_pitch(DXGI_FORMAT format, uint32_t width)
+{
+	const uint32_t data_pitch = width * static_cast<uint32_t>(std::max<size_t>(reshade::pixel_format_size(pixel_format_from_dxgi(format)), 4));
+	return (data_pitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u);
+}
+
+static void copy_screenshot_data(DXGI_FORMAT format, uint32_t width, uint32_t height, const uint8_t *mapped_data, uint32_t mapped_pitch, uint8_t *buffer)
+{
+	// Screenshots are always RGBA without transparency, regardless of the back buffer format
+	const reshade::pixel_format src_format = pixel_format_from_dxgi(format);
+	reshade::convert_pixels(src_format, mapped_data, mapped_pitch, reshade::pixel_format_for_screenshot(src_format), buffer, width * 4, width, height, true);
+}
+
 bool reshade::d3d12::runtime_d3d12::capture_screenshot(uint8_t *buffer) const
 {
-	const uint32_t data_pitch = _width * 4;
-	const uint32_t download_pitch = (data_pitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u);
+	const uint32_t download_pitch = calc_download_pitch(_backbuffer_format, _width);
 
 	D3D12_RESOURCE_DESC desc = { D3D12_RESOURCE_DIMENSION_BUFFER };
 	desc.Width = _height * download_pitch;
@@ -408,6 +425,27 @@ bool reshade::d3d12::runtime_d3d12::capture_screenshot(uint8_t *buffer) const
 	intermediate->SetName(L"ReShade screenshot texture");
 #endif
 
+	if (!record_backbuffer_copy(intermediate.get(), download_pitch))
+		return false;
+
+	// Execute and wait for completion
+	execute_command_list();
+	wait_for_command_queue();
+
+	// Copy data from system memory texture into output buffer
+	uint8_t *mapped_data;
+	if (FAILED(intermediate->Map(0, nullptr, reinterpret_cast<void **>(&mapped_data))))
+		return false;
+
+	copy_screenshot_data(_backbuffer_format, _width, _height, mapped_data, download_pitch, buffer);
+
+	intermediate->Unmap(0, nullptr);
+
+	return true;
+}
+
+bool reshade::d3d12::runtime_d3d12::record_backbuffer_copy(ID3D12Resource *intermediate, uint32_t download_pitch) const
+{
 	if (!begin_command_list())
 		return false;
 
@@ -417,7 +455,7 @@ bool reshade::d3d12::runtime_d3d12::capture_screenshot(uint8_t *buffer) const
 		src_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
 		src_location.SubresourceIndex = 0;
 
-		D3D12_TEXTURE_COPY_LOCATION dst_location = { intermediate.get() };
+		D3D12_TEXTURE_COPY_LOCATION dst_location = { intermediate };
 		dst_location.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
 		dst_location.PlacedFootprint.Footprint.Width = _width;
 		dst_location.PlacedFootprint.Footprint.Height = _height;
@@ -429,40 +467,74 @@ bool reshade::d3d12::runtime_d3d12::capture_screenshot(uint8_t *buffer) const
 	}
 	transition_state(_cmd_list, _backbuffers[_swap_index], D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PRESENT, 0);
 
-	// Execute and wait for completion
-	execute_command_list();
-	wait_for_command_queue();
+	return true;
+}
 
-	// Copy data from system memory texture into output buffer
-	uint8_t *mapped_data;
-	if (FAILED(intermediate->Map(0, nullptr, reinterpret_cast<void **>(&mapped_data))))
+bool reshade::d3d12::runtime_d3d12::begin_readback(unsigned int slot)
+{
+	const uint32_t download_pitch = calc_download_pitch(_backbuffer_format, _width);
+
+	if (_readback_fence == nullptr &&
+		FAILED(_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&_readback_fence))))
 		return false;
 
-	for (uint32_t y = 0; y < _height; y++, buffer += data_pitch, mapped_data += download_pitch)
+	// The readback buffers are kept around until the next reset, so that continuous captures do not have to create new ones every time
+	com_ptr<ID3D12Resource> &intermediate = _readback_buffers[slot];
+	if (intermediate == nullptr)
 	{
-		if (_backbuffer_format == DXGI_FORMAT_R10G10B10A2_UNORM ||
-			_backbuffer_format == DXGI_FORMAT_R10G10B10A2_UINT)
+		D3D12_RESOURCE_DESC desc = { D3D12_RESOURCE_DIMENSION_BUFFER };
+		desc.Width = _height * download_pitch;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.SampleDesc = { 1, 0 };
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		D3D12_HEAP_PROPERTIES props = { D3D12_HEAP_TYPE_READBACK };
+
+		if (FAILED(_device->CreateCommittedResource(&props, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&intermediate))))
 		{
-			for (uint32_t x = 0; x < data_pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ((rgba & 0x3FF) / 4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0xFFC00) >> 10) / 4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) / 4) & 0xFF;
-				buffer[x + 3] = 0xFF;
-			}
+			LOG(ERROR) << "Failed to create system memory texture for deferred screenshot capture!";
+			return false;
 		}
-		else
-		{
-			std::memcpy(buffer, mapped_data, data_pitch);
 
-			for (uint32_t x = 0; x < data_pitch; x += 4)
-				buffer[x + 3] = 0xFF; // Clear alpha channel
-		}
+#ifdef _DEBUG
+		intermediate->SetName(L"ReShade readback buffer");
+#endif
 	}
 
-	intermediate->Unmap(0, nullptr);
+	if (!record_backbuffer_copy(intermediate.get(), download_pitch))
+		return false;
+
+	// Execute, but do not wait for completion, instead signal a fence that is checked when the data is read back
+	execute_command_list();
+
+	_readback_fence_values[slot] = ++_readback_fence_value;
+	_commandqueue->Signal(_readback_fence.get(), _readback_fence_values[slot]);
+
+	return true;
+}
+bool reshade::d3d12::runtime_d3d12::finish_readback(unsigned int slot, uint8_t *buffer)
+{
+	const uint32_t download_pitch = calc_download_pitch(_backbuffer_format, _width);
+
+	// The copy was queued a few frames ago, so it has usually finished by now and this does not stall
+	if (_readback_fence->GetCompletedValue() < _readback_fence_values[slot])
+	{
+		_readback_fence->SetEventOnCompletion(_readback_fence_values[slot], _fence_event);
+		WaitForSingleObject(_fence_event, INFINITE);
+	}
+
+	const com_ptr<ID3D12Resource> &intermediate = _readback_buffers[slot];
+
+	uint8_t *mapped_data;
+	if (FAILED(intermediate->Map(0, nullptr, reinterpret_cast<void **>(&mapped_data))))
+		return false;
+
+	copy_screenshot_data(_backbuffer_format, _width, _height, mapped_data, download_pitch, buffer);
+
+	// Nothing was written by the CPU, so pass an empty range
+	const D3D12_RANGE write_range = { 0, 0 };
+	intermediate->Unmap(0, &write_range);
 
 	return true;
 }
@@ -486,9 +558,12 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 	const std::string hlsl = effect.preamble + effect.module.hlsl;
 	std::unordered_map<std::string, com_ptr<ID3DBlob>> entry_points;
 
-	// Compile the generated HLSL source code to DX byte code
+	// Compile the generated HLSL source code to DX byte code (only for the techniques that are initialized now, the others are compiled once they get enabled)
 	for (const auto &entry_point : effect.module.entry_points)
 	{
+		if (!is_entry_point_pending(index, entry_point.name))
+			continue;
+
 		com_ptr<ID3DBlob> d3d_errors;
 
 		const HRESULT hr = D3DCompile(
@@ -514,7 +589,10 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 		_effect_data.resize(index + 1);
 
 	d3d12_effect_data &effect_data = _effect_data[index];
+	const bool is_initialized = effect_data.signature != nullptr;
 
+	// The root signature, constant buffer and descriptor heaps are shared by all techniques, so they already exist if this effect was initialized for other techniques before
+	if (effect_data.signature == nullptr)
 	{   D3D12_DESCRIPTOR_RANGE srv_range = {};
 		srv_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 		srv_range.NumDescriptors = effect.module.num_texture_bindings;
@@ -544,7 +622,7 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 		effect_data.signature = create_root_signature(desc);
 	}
 
-	if (!effect.uniform_data_storage.empty())
+	if (!effect.uniform_data_storage.empty() && effect_data.cb == nullptr)
 	{
 		D3D12_RESOURCE_DESC desc = { D3D12_RESOURCE_DIMENSION_BUFFER };
 		desc.Width = effect.uniform_data_storage.size();
@@ -563,6 +641,7 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 		effect_data.cbv_gpu_address = effect_data.cb->GetGPUVirtualAddress();
 	}
 
+	if (effect_data.srv_heap == nullptr)
 	{   D3D12_DESCRIPTOR_HEAP_DESC desc = { D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV };
 		desc.NumDescriptors = effect.module.num_texture_bindings;
 		desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
@@ -574,6 +653,7 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 		effect_data.srv_gpu_base = effect_data.srv_heap->GetGPUDescriptorHandleForHeapStart();
 	}
 
+	if (effect_data.rtv_heap == nullptr)
 	{   D3D12_DESCRIPTOR_HEAP_DESC desc = { D3D12_DESCRIPTOR_HEAP_TYPE_RTV };
 		for (auto &info : effect.module.techniques)
 			desc.NumDescriptors += static_cast<UINT>(8 * info.passes.size());
@@ -584,6 +664,7 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 		effect_data.rtv_cpu_base = effect_data.rtv_heap->GetCPUDescriptorHandleForHeapStart();
 	}
 
+	if (effect_data.sampler_heap == nullptr)
 	{   D3D12_DESCRIPTOR_HEAP_DESC desc = { D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER };
 		desc.NumDescriptors = effect.module.num_sampler_bindings;
 		desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
@@ -595,6 +676,10 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 		effect_data.sampler_gpu_base = effect_data.sampler_heap->GetGPUDescriptorHandleForHeapStart();
 	}
 
+	// Make sure all previous frames have finished before updating descriptors of techniques that were already initialized (since they may be in use otherwise)
+	if (is_initialized)
+		wait_for_command_queue();
+
 	UINT16 sampler_list = 0;
 
 	for (const reshadefx::sampler_info &info : effect.module.samplers)
@@ -612,10 +697,13 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 
 		const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
 			[&texture_name = info.texture_name](const auto &item) {
-			return item.unique_name == texture_name && item.impl != nullptr;
+			return item.unique_name == texture_name;
 		});
 		if (existing_texture == _textures.end())
 			return false;
+		// Textures only used by techniques that are not enabled yet were not created, so there is nothing to bind
+		if (existing_texture->impl == nullptr)
+			continue;
 
 		com_ptr<ID3D12Resource> resource;
 		switch (existing_texture->impl_reference)
@@ -679,7 +767,7 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 
 	for (technique &technique : _techniques)
 	{
-		if (technique.impl != nullptr || technique.effect_index != index)
+		if (!is_technique_pending(technique, index))
 			continue;
 
 		technique.impl = std::make_unique<d3d12_technique_data>();
@@ -986,7 +1074,15 @@ void reshade::d3d12::runtime_d3d12::upload_texture(texture &texture, const uint8
 	const auto impl = texture.impl->as<d3d12_tex_data>();
 	assert(impl != nullptr && pixels != nullptr && texture.impl_reference == texture_reference::none);
 
-	const uint32_t data_pitch = texture.width * 4;
+	// Images are always loaded as RGBA, so they are converted to the layout of the texture while filling the upload buffer
+	const pixel_format format = pixel_format_from_texture_format(texture.format);
+	if (format == pixel_format::unknown)
+	{
+		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
+		return;
+	}
+
+	const uint32_t data_pitch = texture.width * static_cast<uint32_t>(pixel_format_size(format));
 	const uint32_t upload_pitch = (data_pitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u);
 
 	D3D12_RESOURCE_DESC desc = { D3D12_RESOURCE_DIMENSION_BUFFER };
@@ -1014,33 +1110,11 @@ void reshade::d3d12::runtime_d3d12::upload_texture(texture &texture, const uint8
 	if (FAILED(intermediate->Map(0, nullptr, reinterpret_cast<void **>(&mapped_data))))
 		return;
 
-	bool unsupported_format = false;
-	switch (texture.format)
-	{
-	case reshadefx::texture_format::r8:
-		for (uint32_t y = 0; y < texture.height; ++y, mapped_data += upload_pitch, pixels += data_pitch)
-			for (uint32_t x = 0; x < texture.width; ++x)
-				mapped_data[x] = pixels[x * 4];
-		break;
-	case reshadefx::texture_format::rg8:
-		for (uint32_t y = 0; y < texture.height; ++y, mapped_data += upload_pitch, pixels += data_pitch)
-			for (uint32_t x = 0; x < texture.width; ++x)
-				mapped_data[x * 2 + 0] = pixels[x * 4 + 0],
-				mapped_data[x * 2 + 1] = pixels[x * 4 + 1];
-		break;
-	case reshadefx::texture_format::rgba8:
-		for (uint32_t y = 0; y < texture.height; ++y, mapped_data += upload_pitch, pixels += data_pitch)
-			std::memcpy(mapped_data, pixels, data_pitch);
-		break;
-	default:
-		unsupported_format = true;
-		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
-		break;
-	}
+	convert_pixels(pixel_format::rgba8_unorm, pixels, texture.width * 4, format, mapped_data, upload_pitch, texture.width, texture.height);
 
 	intermediate->Unmap(0, nullptr);
 
-	if (unsupported_format || !begin_command_list())
+	if (!begin_command_list())
 		return;
 
 	transition_state(_cmd_list, impl->resource, impl->state, D3D12_RESOURCE_STATE_COPY_DEST, 0);
@@ -1120,15 +1194,21 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 	// Setup shader constants
 	if (effect_data.cb != nullptr)
 	{
-		void *mapped;
-		if (HRESULT hr = effect_data.cb->Map(0, nullptr, &mapped); SUCCEEDED(hr))
-		{
-			std::memcpy(mapped, _effects[technique.effect_index].uniform_data_storage.data(), _effects[technique.effect_index].uniform_data_storage.size());
-			effect_data.cb->Unmap(0, nullptr);
-		}
-		else
+		// The buffer keeps its contents, so only the modified ranges have to be written
+		for (size_t offset, size; consume_uniform_data_changes(technique.effect_index, offset, size);)
 		{
-			LOG(ERROR) << "Failed to map constant buffer! HRESULT is " << hr << '.';
+			void *mapped;
+			const D3D12_RANGE read_range = { 0, 0 };
+			if (HRESULT hr = effect_data.cb->Map(0, &read_range, &mapped); SUCCEEDED(hr))
+			{
+				std::memcpy(static_cast<uint8_t *>(mapped) + offset, _effects[technique.effect_index].uniform_data_storage.data() + offset, size);
+				const D3D12_RANGE write_range = { offset, offset + size };
+				effect_data.cb->Unmap(0, &write_range);
+			}
+			else
+			{
+				LOG(ERROR) << "Failed to map constant buffer! HRESULT is " << hr << '.';
+			}
 		}
 
 		_cmd_list->SetGraphicsRootConstantBufferView(0, effect_data.cbv_gpu_address);
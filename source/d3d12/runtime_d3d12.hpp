@@ -42,6 +42,11 @@ namespace reshade::d3d12
 
 		void render_technique(technique &technique) override;
 
+		bool supports_readback() const override { return true; }
+		bool begin_readback(unsigned int slot) override;
+		bool finish_readback(unsigned int slot, uint8_t *buffer) override;
+		bool record_backbuffer_copy(ID3D12Resource *intermediate, uint32_t download_pitch) const;
+
 		bool begin_command_list(const com_ptr<ID3D12PipelineState> &state = nullptr) const;
 		void execute_command_list() const;
 		void wait_for_command_queue() const;
@@ -70,6 +75,11 @@ namespace reshade::d3d12
 		com_ptr<ID3D12Resource> _depth_texture;
 		com_ptr<ID3D12DescriptorHeap> _depthstencil_dsvs;
 
+		UINT64 _readback_fence_value = 0;
+		UINT64 _readback_fence_values[NUM_READBACK_SLOTS] = {};
+		com_ptr<ID3D12Fence> _readback_fence;
+		com_ptr<ID3D12Resource> _readback_buffers[NUM_READBACK_SLOTS];
+
 		com_ptr<ID3D12PipelineState> _mipmap_pipeline;
 		com_ptr<ID3D12RootSignature> _mipmap_signature;
 
@@ -7,6 +7,7 @@
 #include "runtime_d3d9.hpp"
 #include "runtime_config.hpp"
 #include "runtime_objects.hpp"
+#include "pixel_conversion.hpp"
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <d3dcompiler.h>
@@ -240,6 +241,42 @@ void reshade::d3d9::runtime_d3d9::on_present(buffer_detection &tracker)
 	_device->EndScene();
 }
 
+static reshade::pixel_format pixel_format_from_d3d(D3DFORMAT format)
+{
+	// Packed formats are named from the most to the least significant bits, so 'D3DFMT_A8R8G8B8' has blue in the lowest bits
+	switch (format)
+	{
+	case D3DFMT_A8R8G8B8:
+	case D3DFMT_X8R8G8B8:
+		return reshade::pixel_format::bgra8_unorm;
+	case D3DFMT_A8B8G8R8:
+	case D3DFMT_X8B8G8R8:
+		return reshade::pixel_format::rgba8_unorm;
+	case D3DFMT_A2B10G10R10:
+		return reshade::pixel_format::rgb10a2_unorm;
+	case D3DFMT_A2R10G10B10:
+		return reshade::pixel_format::bgr10a2_unorm;
+	case D3DFMT_G16R16:
+		return reshade::pixel_format::rg16_unorm;
+	case D3DFMT_A16B16G16R16:
+		return reshade::pixel_format::rgba16_unorm;
+	case D3DFMT_R16F:
+		return reshade::pixel_format::r16_float;
+	case D3DFMT_G16R16F:
+		return reshade::pixel_format::rg16_float;
+	case D3DFMT_A16B16G16R16F:
+		return reshade::pixel_format::rgba16_float;
+	case D3DFMT_R32F:
+		return reshade::pixel_format::r32_float;
+	case D3DFMT_G32R32F:
+		return reshade::pixel_format::rg32_float;
+	case D3DFMT_A32B32G32R32F:
+		return reshade::pixel_format::rgba32_float;
+	default:
+		return reshade::pixel_format::unknown;
+	}
+}
+
 bool reshade::d3d9::runtime_d3d9::capture_screenshot(uint8_t *buffer) const
 {
 	// Create a surface in system memory, copy back buffer data into it and lock it for reading
@@ -257,33 +294,9 @@ bool reshade::d3d9::runtime_d3d9::capture_screenshot(uint8_t *buffer) const
 		return false;
 	auto mapped_data = static_cast<const uint8_t *>(mapped.pBits);
 
-	for (uint32_t y = 0, pitch = _width * 4; y < _height; y++, buffer += pitch, mapped_data += mapped.Pitch)
-	{
-		if (_backbuffer_format == D3DFMT_A2R10G10B10 ||
-			_backbuffer_format == D3DFMT_A2B10G10R10)
-		{
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ((rgba & 0x3FF) / 4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0xFFC00) >> 10) / 4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) / 4) & 0xFF;
-				buffer[x + 3] = 0xFF;
-			}
-		}
-		else
-		{
-			std::memcpy(buffer, mapped_data, pitch);
-
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				buffer[x + 3] = 0xFF; // Clear alpha channel
-				if (_backbuffer_format == D3DFMT_A8R8G8B8 || _backbuffer_format == D3DFMT_X8R8G8B8)
-					std::swap(buffer[x + 0], buffer[x + 2]); // Format is BGRA, but output should be RGBA, so flip channels
-			}
-		}
-	}
+	// Screenshots are always RGBA without transparency, regardless of the back buffer format
+	const pixel_format src_format = pixel_format_from_d3d(_backbuffer_format);
+	convert_pixels(src_format, mapped_data, mapped.Pitch, pixel_format_for_screenshot(src_format), buffer, _width * 4, _width, _height, true);
 
 	intermediate->UnlockRect();
 
@@ -308,20 +321,24 @@ bool reshade::d3d9::runtime_d3d9::init_effect(size_t index)
 	const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(_d3d_compiler, "D3DCompile"));
 	const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(_d3d_compiler, "D3DDisassemble"));
 
-	// Add specialization constant defines to source code
-	effect.preamble += "#define COLOR_PIXEL_SIZE 1.0 / " + std::to_string(_width) + ", 1.0 / " + std::to_string(_height) + "\n"
-		"#define DEPTH_PIXEL_SIZE COLOR_PIXEL_SIZE\n"
-		"#define SV_TARGET_PIXEL_SIZE COLOR_PIXEL_SIZE\n"
-		"#define SV_DEPTH_PIXEL_SIZE COLOR_PIXEL_SIZE\n";
+	// Add specialization constant defines to source code (only once, since this is called again when more techniques of the effect are enabled later)
+	if (effect.preamble.find("#define COLOR_PIXEL_SIZE ") == std::string::npos)
+		effect.preamble += "#define COLOR_PIXEL_SIZE 1.0 / " + std::to_string(_width) + ", 1.0 / " + std::to_string(_height) + "\n"
+			"#define DEPTH_PIXEL_SIZE COLOR_PIXEL_SIZE\n"
+			"#define SV_TARGET_PIXEL_SIZE COLOR_PIXEL_SIZE\n"
+			"#define SV_DEPTH_PIXEL_SIZE COLOR_PIXEL_SIZE\n";
 
 	const std::string hlsl_vs = effect.preamble + effect.module.hlsl;
 	const std::string hlsl_ps = effect.preamble + "#define POSITION VPOS\n" + effect.module.hlsl;
 
 	std::unordered_map<std::string, com_ptr<IUnknown>> entry_points;
 
-	// Compile the generated HLSL source code to DX byte code
+	// Compile the generated HLSL source code to DX byte code (only for the techniques that are initialized now, the others are compiled once they get enabled)
 	for (const auto &entry_point : effect.module.entry_points)
 	{
+		if (!is_entry_point_pending(index, entry_point.name))
+			continue;
+
 		com_ptr<ID3DBlob> compiled, d3d_errors;
 		const std::string &hlsl = entry_point.is_pixel_shader ? hlsl_ps : hlsl_vs;
 
@@ -367,10 +384,13 @@ bool reshade::d3d9::runtime_d3d9::init_effect(size_t index)
 
 		const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
 			[&texture_name = info.texture_name](const auto &item) {
-			return item.unique_name == texture_name && item.impl != nullptr;
+			return item.unique_name == texture_name;
 		});
 		if (existing_texture == _textures.end())
 			return false;
+		// Textures only used by techniques that are not enabled yet were not created, so there is nothing to bind
+		if (existing_texture->impl == nullptr)
+			continue;
 
 		// Since textures with auto-generated mipmap levels do not have a mipmap maximum, limit the bias here so this is not as obvious
 		assert(existing_texture->levels > 0);
@@ -395,7 +415,7 @@ bool reshade::d3d9::runtime_d3d9::init_effect(size_t index)
 
 	for (technique &technique : _techniques)
 	{
-		if (technique.impl != nullptr || technique.effect_index != index)
+		if (!is_technique_pending(technique, index))
 			continue;
 
 		// Copy construct new technique implementation instead of move because effect may contain multiple techniques
@@ -708,6 +728,13 @@ void reshade::d3d9::runtime_d3d9::upload_texture(texture &texture, const uint8_t
 	assert(impl != nullptr && texture.impl_reference == texture_reference::none && pixels != nullptr);
 
 	D3DSURFACE_DESC desc; impl->texture->GetLevelDesc(0, &desc); // Get D3D texture format
+	const pixel_format format = pixel_format_from_d3d(desc.Format);
+	if (format == pixel_format::unknown)
+	{
+		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
+		return;
+	}
+
 	com_ptr<IDirect3DTexture9> intermediate;
 	if (FAILED(_device->CreateTexture(texture.width, texture.height, 1, 0, desc.Format, D3DPOOL_SYSTEMMEM, &intermediate, nullptr)))
 	{
@@ -720,35 +747,20 @@ void reshade::d3d9::runtime_d3d9::upload_texture(texture &texture, const uint8_t
 		return;
 	auto mapped_data = static_cast<uint8_t *>(mapped.pBits);
 
-	switch (texture.format)
+	// Images are always loaded as RGBA, so convert them to the layout of the texture
+	if (texture.format == reshadefx::texture_format::r8 || texture.format == reshadefx::texture_format::rg8)
 	{
-	case reshadefx::texture_format::r8: // These are actually D3DFMT_A8R8G8B8, see 'init_texture'
-		for (uint32_t y = 0, pitch = texture.width * 4; y < texture.height; ++y, mapped_data += mapped.Pitch, pixels += pitch)
-			for (uint32_t x = 0; x < pitch; x += 4)
-				mapped_data[x + 0] = 0, // Set green and blue channel to zero
-				mapped_data[x + 1] = 0,
-				mapped_data[x + 2] = pixels[x + 0],
-				mapped_data[x + 3] = 0xFF;
-		break;
-	case reshadefx::texture_format::rg8:
-		for (uint32_t y = 0, pitch = texture.width * 4; y < texture.height; ++y, mapped_data += mapped.Pitch, pixels += pitch)
-			for (uint32_t x = 0; x < pitch; x += 4)
-				mapped_data[x + 0] = 0, // Set blue channel to zero
-				mapped_data[x + 1] = pixels[x + 1],
-				mapped_data[x + 2] = pixels[x + 0],
-				mapped_data[x + 3] = 0xFF;
-		break;
-	case reshadefx::texture_format::rgba8:
-		for (uint32_t y = 0, pitch = texture.width * 4; y < texture.height; ++y, mapped_data += mapped.Pitch, pixels += pitch)
-			for (uint32_t x = 0; x < pitch; x += 4)
-				mapped_data[x + 0] = pixels[x + 2], // Flip RGBA input to BGRA
-				mapped_data[x + 1] = pixels[x + 1],
-				mapped_data[x + 2] = pixels[x + 0],
-				mapped_data[x + 3] = pixels[x + 3];
-		break;
-	default:
-		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
-		break;
+		// These are actually D3DFMT_A8R8G8B8 (see 'init_texture'), so reduce to the used channels first, which sets the others to zero when expanding again
+		const pixel_format reduced_format = pixel_format_from_texture_format(texture.format);
+		const uint32_t reduced_pitch = texture.width * static_cast<uint32_t>(pixel_format_size(reduced_format));
+		std::vector<uint8_t> reduced_data(reduced_pitch * texture.height);
+
+		convert_pixels(pixel_format::rgba8_unorm, pixels, texture.width * 4, reduced_format, reduced_data.data(), reduced_pitch, texture.width, texture.height);
+		convert_pixels(reduced_format, reduced_data.data(), reduced_pitch, format, mapped_data, mapped.Pitch, texture.width, texture.height);
+	}
+	else
+	{
+		convert_pixels(pixel_format::rgba8_unorm, pixels, texture.width * 4, format, mapped_data, mapped.Pitch, texture.width, texture.height);
 	}
 
 	intermediate->UnlockRect(0);
@@ -773,9 +785,12 @@ void reshade::d3d9::runtime_d3d9::render_technique(technique &technique)
 	// Setup shader constants
 	if (technique_data.constant_register_count > 0)
 	{
+		// Constant registers are device state shared with the application, so they have to be set every time, regardless of whether the data changed
 		const auto uniform_storage_data = reinterpret_cast<const float *>(_effects[technique.effect_index].uniform_data_storage.data());
 		_device->SetPixelShaderConstantF(0, uniform_storage_data, technique_data.constant_register_count);
 		_device->SetVertexShaderConstantF(0, uniform_storage_data, technique_data.constant_register_count);
+
+		_uniform_bytes_uploaded += technique_data.constant_register_count * 16;
 	}
 
 	for (size_t i = 0; i < technique.passes.size(); ++i)
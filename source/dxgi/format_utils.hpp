@@ -6,6 +6,7 @@
 #pragma once
 
 #include <dxgi.h>
+#include "pixel_conversion.hpp"
 
 inline UINT dxgi_format_color_depth(DXGI_FORMAT format)
 {
@@ -126,3 +127,50 @@ inline DXGI_FORMAT make_dxgi_format_typeless(DXGI_FORMAT format)
 		return format;
 	}
 }
+
+inline reshade::pixel_format pixel_format_from_dxgi(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R8_UNORM:
+		return reshade::pixel_format::r8_unorm;
+	case DXGI_FORMAT_R8G8_UNORM:
+		return reshade::pixel_format::rg8_unorm;
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+		return reshade::pixel_format::rgba8_unorm;
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		return reshade::pixel_format::rgba8_unorm_srgb;
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+		return reshade::pixel_format::bgra8_unorm;
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		return reshade::pixel_format::bgra8_unorm_srgb;
+	case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+		return reshade::pixel_format::rgb10a2_unorm;
+	case DXGI_FORMAT_R16G16_UNORM:
+		return reshade::pixel_format::rg16_unorm;
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+		return reshade::pixel_format::rgba16_unorm;
+	case DXGI_FORMAT_R16_FLOAT:
+		return reshade::pixel_format::r16_float;
+	case DXGI_FORMAT_R16G16_FLOAT:
+		return reshade::pixel_format::rg16_float;
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		return reshade::pixel_format::rgba16_float;
+	case DXGI_FORMAT_R32_FLOAT:
+		return reshade::pixel_format::r32_float;
+	case DXGI_FORMAT_R32G32_FLOAT:
+		return reshade::pixel_format::rg32_float;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return reshade::pixel_format::rgba32_float;
+	default:
+		return reshade::pixel_format::unknown;
+	}
+}
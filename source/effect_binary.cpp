@@ -0,0 +1,570 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_binary.hpp"
+#include <cstring> // std::memcpy
+#include <unordered_map>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+using namespace reshadefx;
+
+static const size_t record_sizes[binary::num_sections] = {
+	sizeof(char),
+	sizeof(binary::constant_record),
+	sizeof(binary::annotation_record),
+	sizeof(binary::entry_point_record),
+	sizeof(binary::texture_record),
+	sizeof(binary::sampler_record),
+	sizeof(binary::uniform_record),
+	sizeof(binary::uniform_record),
+	sizeof(binary::technique_record),
+	sizeof(binary::pass_record),
+	sizeof(char),
+	sizeof(uint32_t),
+	sizeof(binary::string_ref),
+};
+
+namespace
+{
+	struct binary_writer
+	{
+		std::string strings;
+		std::unordered_map<std::string, binary::string_ref> string_lookup;
+		std::vector<binary::constant_record> constants;
+		std::vector<binary::annotation_record> annotations;
+		std::vector<binary::entry_point_record> entry_points;
+		std::vector<binary::texture_record> textures;
+		std::vector<binary::sampler_record> samplers;
+		std::vector<binary::uniform_record> uniforms;
+		std::vector<binary::uniform_record> spec_constants;
+		std::vector<binary::technique_record> techniques;
+		std::vector<binary::pass_record> passes;
+		std::vector<binary::string_ref> technique_texture_names;
+
+		binary::string_ref add_string(const std::string &value)
+		{
+			if (value.empty())
+				return { 0, 0 };
+
+			// Names repeat a lot across records (texture names in samplers and render targets, entry points in passes, ...), so only store each one once
+			if (const auto it = string_lookup.find(value); it != string_lookup.end())
+				return it->second;
+
+			const binary::string_ref ref = { static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(value.size()) };
+			strings += value;
+			string_lookup.emplace(value, ref);
+			return ref;
+		}
+
+		static binary::type_record convert_type(const reshadefx::type &type)
+		{
+			binary::type_record record = {};
+			record.base = type.base;
+			record.rows = static_cast<uint8_t>(type.rows);
+			record.cols = static_cast<uint8_t>(type.cols);
+			record.qualifiers = type.qualifiers;
+			record.array_length = type.array_length;
+			record.definition = type.definition;
+			return record;
+		}
+
+		uint32_t add_constant(const reshadefx::constant &value)
+		{
+			const auto index = static_cast<uint32_t>(constants.size());
+			constants.emplace_back();
+			fill_constant(index, value);
+			return index;
+		}
+		void fill_constant(uint32_t index, const reshadefx::constant &value)
+		{
+			binary::constant_record record = {};
+			std::memcpy(record.data, value.as_uint, sizeof(record.data));
+			record.string_data = add_string(value.string_data);
+			// Array elements need to be contiguous, so reserve their records before filling in nested data
+			record.array_data = { static_cast<uint32_t>(constants.size()), static_cast<uint32_t>(value.array_data.size()) };
+			constants.resize(constants.size() + value.array_data.size());
+			for (uint32_t i = 0; i < record.array_data.count; ++i)
+				fill_constant(record.array_data.first + i, value.array_data[i]);
+			constants[index] = record; // Vector may have been resized above, so assign at the end
+		}
+
+		binary::range_ref add_annotations(const std::vector<reshadefx::annotation> &list)
+		{
+			const binary::range_ref ref = { static_cast<uint32_t>(annotations.size()), static_cast<uint32_t>(list.size()) };
+			annotations.resize(annotations.size() + list.size());
+			for (uint32_t i = 0; i < ref.count; ++i)
+			{
+				binary::annotation_record record = {};
+				record.type = convert_type(list[i].type);
+				record.name = add_string(list[i].name);
+				record.value = add_constant(list[i].value);
+				annotations[ref.first + i] = record;
+			}
+			return ref;
+		}
+
+		binary::uniform_record convert_uniform(const reshadefx::uniform_info &info)
+		{
+			binary::uniform_record record = {};
+			record.name = add_string(info.name);
+			record.type = convert_type(info.type);
+			record.size = info.size;
+			record.offset = info.offset;
+			record.annotations = add_annotations(info.annotations);
+			record.has_initializer_value = info.has_initializer_value;
+			record.initializer_value = add_constant(info.initializer_value);
+			return record;
+		}
+	};
+
+	struct binary_reader
+	{
+		const module_view &view;
+		bool valid = true;
+
+		std::string string(binary::string_ref ref)
+		{
+			const std::string_view value = view.string(ref);
+			valid &= value.size() == ref.length;
+			return std::string(value);
+		}
+
+		static reshadefx::type convert_type(const binary::type_record &record)
+		{
+			reshadefx::type type;
+			type.base = static_cast<reshadefx::type::datatype>(record.base);
+			type.rows = record.rows;
+			type.cols = record.cols;
+			type.qualifiers = record.qualifiers;
+			type.array_length = record.array_length;
+			type.definition = record.definition;
+			return type;
+		}
+
+		void convert_constant(const binary::constant_record &record, reshadefx::constant &value, unsigned int depth = 0)
+		{
+			std::memcpy(value.as_uint, record.data, sizeof(record.data));
+			value.string_data = string(record.string_data);
+
+			const binary::array_view<binary::constant_record> elements = view.constants(record.array_data);
+			// Limit nesting to guard against reference cycles in corrupted files
+			if (elements.size() != record.array_data.count || depth > 8)
+			{
+				valid = false;
+				return;
+			}
+
+			value.array_data.resize(elements.size());
+			for (size_t i = 0; i < elements.size(); ++i)
+				convert_constant(elements[i], value.array_data[i], depth + 1);
+		}
+		void convert_constant(uint32_t index, reshadefx::constant &value)
+		{
+			if (const binary::constant_record *const record = view.constant(index))
+				convert_constant(*record, value);
+			else
+				valid = false;
+		}
+
+		std::vector<reshadefx::annotation> annotations(binary::range_ref ref)
+		{
+			const binary::array_view<binary::annotation_record> records = view.annotations(ref);
+			valid &= records.size() == ref.count;
+
+			std::vector<reshadefx::annotation> list(records.size());
+			for (size_t i = 0; i < records.size(); ++i)
+			{
+				list[i].type = convert_type(records[i].type);
+				list[i].name = string(records[i].name);
+				convert_constant(records[i].value, list[i].value);
+			}
+			return list;
+		}
+
+		reshadefx::uniform_info convert_uniform(const binary::uniform_record &record)
+		{
+			reshadefx::uniform_info info;
+			info.name = string(record.name);
+			info.type = convert_type(record.type);
+			info.size = record.size;
+			info.offset = record.offset;
+			info.annotations = annotations(record.annotations);
+			info.has_initializer_value = record.has_initializer_value != 0;
+			convert_constant(record.initializer_value, info.initializer_value);
+			return info;
+		}
+	};
+}
+
+template <typename T>
+static void append_section(std::vector<uint8_t> &data, size_t base, binary::section_info &info, const T *records, size_t count)
+{
+	// Keep every section aligned to 4 bytes, so records can be accessed in place
+	data.resize(base + ((data.size() - base + 3) & ~size_t(3)));
+
+	info.offset = static_cast<uint32_t>(data.size() - base);
+	info.count = static_cast<uint32_t>(count);
+
+	data.insert(data.end(), reinterpret_cast<const uint8_t *>(records), reinterpret_cast<const uint8_t *>(records + count));
+}
+
+void reshadefx::write_binary_module(const module &module, std::vector<uint8_t> &data)
+{
+	binary_writer w;
+
+	for (const auto &entry_point : module.entry_points)
+		w.entry_points.push_back({ w.add_string(entry_point.name), entry_point.is_pixel_shader });
+
+	for (const auto &info : module.textures)
+	{
+		binary::texture_record record = {};
+		record.id = info.id;
+		record.binding = info.binding;
+		record.semantic = w.add_string(info.semantic);
+		record.unique_name = w.add_string(info.unique_name);
+		record.annotations = w.add_annotations(info.annotations);
+		record.width = info.width;
+		record.height = info.height;
+		record.levels = info.levels;
+		record.format = static_cast<uint32_t>(info.format);
+		w.textures.push_back(record);
+	}
+
+	for (const auto &info : module.samplers)
+	{
+		binary::sampler_record record = {};
+		record.id = info.id;
+		record.binding = info.binding;
+		record.texture_binding = info.texture_binding;
+		record.unique_name = w.add_string(info.unique_name);
+		record.texture_name = w.add_string(info.texture_name);
+		record.annotations = w.add_annotations(info.annotations);
+		record.filter = static_cast<uint32_t>(info.filter);
+		record.address_u = static_cast<uint32_t>(info.address_u);
+		record.address_v = static_cast<uint32_t>(info.address_v);
+		record.address_w = static_cast<uint32_t>(info.address_w);
+		record.min_lod = info.min_lod;
+		record.max_lod = info.max_lod;
+		record.lod_bias = info.lod_bias;
+		record.srgb = info.srgb;
+		w.samplers.push_back(record);
+	}
+
+	for (const auto &info : module.uniforms)
+		w.uniforms.push_back(w.convert_uniform(info));
+	for (const auto &info : module.spec_constants)
+		w.spec_constants.push_back(w.convert_uniform(info));
+
+	for (const auto &info : module.techniques)
+	{
+		binary::technique_record record = {};
+		record.name = w.add_string(info.name);
+		record.annotations = w.add_annotations(info.annotations);
+		record.passes = { static_cast<uint32_t>(w.passes.size()), static_cast<uint32_t>(info.passes.size()) };
+		record.texture_names = { static_cast<uint32_t>(w.technique_texture_names.size()), static_cast<uint32_t>(info.texture_names.size()) };
+
+		for (const auto &texture_name : info.texture_names)
+			w.technique_texture_names.push_back(w.add_string(texture_name));
+
+		for (const auto &pass : info.passes)
+		{
+			binary::pass_record pass_record = {};
+			for (size_t i = 0; i < 8; ++i)
+				pass_record.render_target_names[i] = w.add_string(pass.render_target_names[i]);
+			pass_record.vs_entry_point = w.add_string(pass.vs_entry_point);
+			pass_record.ps_entry_point = w.add_string(pass.ps_entry_point);
+			pass_record.clear_render_targets = pass.clear_render_targets;
+			pass_record.srgb_write_enable = pass.srgb_write_enable;
+			pass_record.blend_enable = pass.blend_enable;
+			pass_record.stencil_enable = pass.stencil_enable;
+			pass_record.color_write_mask = pass.color_write_mask;
+			pass_record.stencil_read_mask = pass.stencil_read_mask;
+			pass_record.stencil_write_mask = pass.stencil_write_mask;
+			pass_record.blend_op = pass.blend_op;
+			pass_record.blend_op_alpha = pass.blend_op_alpha;
+			pass_record.src_blend = pass.src_blend;
+			pass_record.dest_blend = pass.dest_blend;
+			pass_record.src_blend_alpha = pass.src_blend_alpha;
+			pass_record.dest_blend_alpha = pass.dest_blend_alpha;
+			pass_record.stencil_comparison_func = pass.stencil_comparison_func;
+			pass_record.stencil_reference_value = pass.stencil_reference_value;
+			pass_record.stencil_op_pass = pass.stencil_op_pass;
+			pass_record.stencil_op_fail = pass.stencil_op_fail;
+			pass_record.stencil_op_depth_fail = pass.stencil_op_depth_fail;
+			pass_record.num_vertices = pass.num_vertices;
+			pass_record.viewport_width = pass.viewport_width;
+			pass_record.viewport_height = pass.viewport_height;
+			w.passes.push_back(pass_record);
+		}
+
+		w.techniques.push_back(record);
+	}
+
+	// Align start of the module, in case it is appended to other data
+	data.resize((data.size() + 3) & ~size_t(3));
+	const size_t base = data.size();
+
+	binary::header header = {};
+	header.magic = binary::magic;
+	header.version_major = binary::version_major;
+	header.version_minor = binary::version_minor;
+	header.header_size = sizeof(header);
+	header.total_uniform_size = module.total_uniform_size;
+	header.per_frame_uniform_size = module.per_frame_uniform_size;
+	header.num_sampler_bindings = module.num_sampler_bindings;
+	header.num_texture_bindings = module.num_texture_bindings;
+
+	data.resize(base + sizeof(header)); // Reserve space for the header, it is filled in once all section offsets are known
+
+	append_section(data, base, header.sections[binary::section_strings], w.strings.data(), w.strings.size());
+	append_section(data, base, header.sections[binary::section_constants], w.constants.data(), w.constants.size());
+	append_section(data, base, header.sections[binary::section_annotations], w.annotations.data(), w.annotations.size());
+	append_section(data, base, header.sections[binary::section_entry_points], w.entry_points.data(), w.entry_points.size());
+	append_section(data, base, header.sections[binary::section_textures], w.textures.data(), w.textures.size());
+	append_section(data, base, header.sections[binary::section_samplers], w.samplers.data(), w.samplers.size());
+	append_section(data, base, header.sections[binary::section_uniforms], w.uniforms.data(), w.uniforms.size());
+	append_section(data, base, header.sections[binary::section_spec_constants], w.spec_constants.data(), w.spec_constants.size());
+	append_section(data, base, header.sections[binary::section_techniques], w.techniques.data(), w.techniques.size());
+	append_section(data, base, header.sections[binary::section_passes], w.passes.data(), w.passes.size());
+	append_section(data, base, header.sections[binary::section_hlsl], module.hlsl.data(), module.hlsl.size());
+	append_section(data, base, header.sections[binary::section_spirv], module.spirv.data(), module.spirv.size());
+	append_section(data, base, header.sections[binary::section_technique_texture_names], w.technique_texture_names.data(), w.technique_texture_names.size());
+
+	header.size = static_cast<uint32_t>(data.size() - base);
+
+	std::memcpy(data.data() + base, &header, sizeof(header));
+}
+
+bool reshadefx::module_view::open(const void *data, size_t size)
+{
+	_data = nullptr;
+	_header = nullptr;
+
+	if (data == nullptr || size < sizeof(binary::header) || (reinterpret_cast<uintptr_t>(data) & 3) != 0)
+		return false;
+
+	const auto header = static_cast<const binary::header *>(data);
+	if (header->magic != binary::magic || header->version_major != binary::version_major ||
+		header->size > size || header->header_size < sizeof(binary::header) || header->header_size > header->size ||
+		header->per_frame_uniform_size > header->total_uniform_size)
+		return false;
+
+	for (uint32_t i = 0; i < binary::num_sections; ++i)
+	{
+		const binary::section_info &info = header->sections[i];
+		if ((info.offset & 3) != 0 || info.offset < header->header_size ||
+			info.offset + static_cast<uint64_t>(info.count) * record_sizes[i] > header->size)
+			return false;
+	}
+
+	_data = static_cast<const uint8_t *>(data);
+	_header = header;
+
+	return true;
+}
+
+std::string_view reshadefx::module_view::hlsl() const
+{
+	const binary::array_view<char> chars = section<char>(binary::section_hlsl);
+	return std::string_view(chars.data(), chars.size());
+}
+binary::array_view<uint32_t> reshadefx::module_view::spirv() const
+{
+	return section<uint32_t>(binary::section_spirv);
+}
+
+std::string_view reshadefx::module_view::string(binary::string_ref ref) const
+{
+	const binary::array_view<char> chars = section<char>(binary::section_strings);
+	if (ref.offset > chars.size() || ref.length > chars.size() - ref.offset)
+		return std::string_view();
+	return std::string_view(chars.data() + ref.offset, ref.length);
+}
+
+bool reshadefx::module_view::to_module(module &module) const
+{
+	if (!is_valid())
+		return false;
+
+	binary_reader r { *this };
+
+	module.hlsl = hlsl();
+	module.spirv.assign(spirv().begin(), spirv().end());
+
+	module.entry_points.clear();
+	for (const binary::entry_point_record &record : entry_points())
+		module.entry_points.push_back({ r.string(record.name), record.is_pixel_shader != 0 });
+
+	module.textures.clear();
+	for (const binary::texture_record &record : textures())
+	{
+		texture_info &info = module.textures.emplace_back();
+		info.id = record.id;
+		info.binding = record.binding;
+		info.semantic = r.string(record.semantic);
+		info.unique_name = r.string(record.unique_name);
+		info.annotations = r.annotations(record.annotations);
+		info.width = record.width;
+		info.height = record.height;
+		info.levels = record.levels;
+		info.format = static_cast<texture_format>(record.format);
+	}
+
+	module.samplers.clear();
+	for (const binary::sampler_record &record : samplers())
+	{
+		sampler_info &info = module.samplers.emplace_back();
+		info.id = record.id;
+		info.binding = record.binding;
+		info.texture_binding = record.texture_binding;
+		info.unique_name = r.string(record.unique_name);
+		info.texture_name = r.string(record.texture_name);
+		info.annotations = r.annotations(record.annotations);
+		info.filter = static_cast<texture_filter>(record.filter);
+		info.address_u = static_cast<texture_address_mode>(record.address_u);
+		info.address_v = static_cast<texture_address_mode>(record.address_v);
+		info.address_w = static_cast<texture_address_mode>(record.address_w);
+		info.min_lod = record.min_lod;
+		info.max_lod = record.max_lod;
+		info.lod_bias = record.lod_bias;
+		info.srgb = static_cast<uint8_t>(record.srgb);
+	}
+
+	module.uniforms.clear();
+	for (const binary::uniform_record &record : uniforms())
+		module.uniforms.push_back(r.convert_uniform(record));
+	module.spec_constants.clear();
+	for (const binary::uniform_record &record : spec_constants())
+		module.spec_constants.push_back(r.convert_uniform(record));
+
+	module.techniques.clear();
+	for (const binary::technique_record &record : techniques())
+	{
+		technique_info &info = module.techniques.emplace_back();
+		info.name = r.string(record.name);
+		info.annotations = r.annotations(record.annotations);
+
+		const binary::array_view<binary::pass_record> pass_records = passes(record.passes);
+		r.valid &= pass_records.size() == record.passes.count;
+
+		for (const binary::pass_record &pass_record : pass_records)
+		{
+			pass_info &pass = info.passes.emplace_back();
+			for (size_t i = 0; i < 8; ++i)
+				pass.render_target_names[i] = r.string(pass_record.render_target_names[i]);
+			pass.vs_entry_point = r.string(pass_record.vs_entry_point);
+			pass.ps_entry_point = r.string(pass_record.ps_entry_point);
+			pass.clear_render_targets = pass_record.clear_render_targets;
+			pass.srgb_write_enable = pass_record.srgb_write_enable;
+			pass.blend_enable = pass_record.blend_enable;
+			pass.stencil_enable = pass_record.stencil_enable;
+			pass.color_write_mask = pass_record.color_write_mask;
+			pass.stencil_read_mask = pass_record.stencil_read_mask;
+			pass.stencil_write_mask = pass_record.stencil_write_mask;
+			pass.blend_op = pass_record.blend_op;
+			pass.blend_op_alpha = pass_record.blend_op_alpha;
+			pass.src_blend = pass_record.src_blend;
+			pass.dest_blend = pass_record.dest_blend;
+			pass.src_blend_alpha = pass_record.src_blend_alpha;
+			pass.dest_blend_alpha = pass_record.dest_blend_alpha;
+			pass.stencil_comparison_func = pass_record.stencil_comparison_func;
+			pass.stencil_reference_value = pass_record.stencil_reference_value;
+			pass.stencil_op_pass = pass_record.stencil_op_pass;
+			pass.stencil_op_fail = pass_record.stencil_op_fail;
+			pass.stencil_op_depth_fail = pass_record.stencil_op_depth_fail;
+			pass.num_vertices = pass_record.num_vertices;
+			pass.viewport_width = pass_record.viewport_width;
+			pass.viewport_height = pass_record.viewport_height;
+		}
+
+		const binary::array_view<binary::string_ref> texture_name_records = technique_texture_names(record.texture_names);
+		r.valid &= texture_name_records.size() == record.texture_names.count;
+
+		for (const binary::string_ref &texture_name : texture_name_records)
+			info.texture_names.push_back(r.string(texture_name));
+	}
+
+	module.total_uniform_size = total_uniform_size();
+	module.per_frame_uniform_size = per_frame_uniform_size();
+	module.num_sampler_bindings = num_sampler_bindings();
+	module.num_texture_bindings = num_texture_bindings();
+
+	return r.valid;
+}
+
+bool reshadefx::mapped_file::open(const std::filesystem::path &path)
+{
+	close();
+
+#ifdef _WIN32
+	const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size = {};
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 && static_cast<uint64_t>(file_size.QuadPart) <= SIZE_MAX)
+	{
+		_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (_mapping != nullptr)
+		{
+			_data = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+			_size = static_cast<size_t>(file_size.QuadPart);
+		}
+	}
+
+	// The mapping keeps a reference to the file, so can close the handle here already
+	CloseHandle(file);
+#else
+	const int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat file_info = {};
+	if (fstat(file, &file_info) == 0 && file_info.st_size > 0)
+	{
+		void *const data = mmap(nullptr, static_cast<size_t>(file_info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			_data = data;
+			_size = static_cast<size_t>(file_info.st_size);
+		}
+	}
+
+	::close(file);
+#endif
+
+	if (_data == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+void reshadefx::mapped_file::close()
+{
+#ifdef _WIN32
+	if (_data != nullptr)
+		UnmapViewOfFile(_data);
+	if (_mapping != nullptr)
+		CloseHandle(_mapping);
+	_mapping = nullptr;
+#else
+	if (_data != nullptr)
+		munmap(_data, _size);
+#endif
+
+	_data = nullptr;
+	_size = 0;
+}
@@ -0,0 +1,314 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <string_view>
+#include <filesystem>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// Record layouts of the binary module format.
+	/// All records are plain little-endian data aligned to 4 bytes, so they can be accessed directly in a memory-mapped file.
+	/// Strings are stored in a shared string table and referenced by offset, lists of child records are referenced by an index range into the matching table.
+	/// </summary>
+	namespace binary
+	{
+		/// <summary>
+		/// Magic number at the start of every binary module ('RFXM').
+		/// </summary>
+		const uint32_t magic = 0x4D584652;
+		/// <summary>
+		/// Version of the format. Readers reject files with a different major version, a newer minor version only appends data.
+		/// </summary>
+		const uint16_t version_major = 5;
+		const uint16_t version_minor = 0;
+
+		enum section : uint32_t
+		{
+			section_strings,
+			section_constants,
+			section_annotations,
+			section_entry_points,
+			section_textures,
+			section_samplers,
+			section_uniforms,
+			section_spec_constants,
+			section_techniques,
+			section_passes,
+			section_hlsl,
+			section_spirv,
+			section_technique_texture_names,
+			num_sections
+		};
+
+		struct string_ref
+		{
+			uint32_t offset;
+			uint32_t length;
+		};
+		struct range_ref
+		{
+			uint32_t first;
+			uint32_t count;
+		};
+
+		struct section_info
+		{
+			uint32_t offset; // Offset in bytes from the start of the file
+			uint32_t count; // Number of records (bytes for strings and HLSL, words for SPIR-V)
+		};
+
+		struct header
+		{
+			uint32_t magic;
+			uint16_t version_major;
+			uint16_t version_minor;
+			uint32_t size; // Total size of the file in bytes
+			uint32_t header_size; // Size of this header, so that newer minor versions can extend it
+			uint32_t total_uniform_size;
+			uint32_t per_frame_uniform_size;
+			uint32_t num_sampler_bindings;
+			uint32_t num_texture_bindings;
+			section_info sections[num_sections];
+		};
+
+		struct type_record
+		{
+			uint8_t base;
+			uint8_t rows;
+			uint8_t cols;
+			uint8_t reserved;
+			uint32_t qualifiers;
+			int32_t array_length;
+			uint32_t definition;
+		};
+		struct constant_record
+		{
+			uint32_t data[16];
+			string_ref string_data;
+			range_ref array_data; // Range in the constant table
+		};
+		struct annotation_record
+		{
+			type_record type;
+			string_ref name;
+			uint32_t value; // Index in the constant table
+		};
+		struct entry_point_record
+		{
+			string_ref name;
+			uint32_t is_pixel_shader;
+		};
+		struct texture_record
+		{
+			uint32_t id;
+			uint32_t binding;
+			string_ref semantic;
+			string_ref unique_name;
+			range_ref annotations;
+			uint32_t width;
+			uint32_t height;
+			uint32_t levels;
+			uint32_t format;
+		};
+		struct sampler_record
+		{
+			uint32_t id;
+			uint32_t binding;
+			uint32_t texture_binding;
+			string_ref unique_name;
+			string_ref texture_name;
+			range_ref annotations;
+			uint32_t filter;
+			uint32_t address_u;
+			uint32_t address_v;
+			uint32_t address_w;
+			float min_lod;
+			float max_lod;
+			float lod_bias;
+			uint32_t srgb;
+		};
+		struct uniform_record
+		{
+			string_ref name;
+			type_record type;
+			uint32_t size;
+			uint32_t offset;
+			range_ref annotations;
+			uint32_t has_initializer_value;
+			uint32_t initializer_value; // Index in the constant table
+		};
+		struct pass_record
+		{
+			string_ref render_target_names[8];
+			string_ref vs_entry_point;
+			string_ref ps_entry_point;
+			uint8_t clear_render_targets;
+			uint8_t srgb_write_enable;
+			uint8_t blend_enable;
+			uint8_t stencil_enable;
+			uint8_t color_write_mask;
+			uint8_t stencil_read_mask;
+			uint8_t stencil_write_mask;
+			uint8_t reserved;
+			uint32_t blend_op;
+			uint32_t blend_op_alpha;
+			uint32_t src_blend;
+			uint32_t dest_blend;
+			uint32_t src_blend_alpha;
+			uint32_t dest_blend_alpha;
+			uint32_t stencil_comparison_func;
+			uint32_t stencil_reference_value;
+			uint32_t stencil_op_pass;
+			uint32_t stencil_op_fail;
+			uint32_t stencil_op_depth_fail;
+			uint32_t num_vertices;
+			uint32_t viewport_width;
+			uint32_t viewport_height;
+		};
+		struct technique_record
+		{
+			string_ref name;
+			range_ref passes; // Range in the pass table
+			range_ref annotations;
+			range_ref texture_names; // Range in the technique texture name table
+		};
+
+		/// <summary>
+		/// A non-owning view of a contiguous array of records.
+		/// </summary>
+		template <typename T>
+		class array_view
+		{
+		public:
+			array_view() = default;
+			array_view(const T *data, size_t size) : _data(data), _size(size) {}
+
+			const T *data() const { return _data; }
+			size_t size() const { return _size; }
+			bool empty() const { return _size == 0; }
+
+			const T *begin() const { return _data; }
+			const T *end() const { return _data + _size; }
+			const T &operator[](size_t index) const { return _data[index]; }
+
+		private:
+			const T *_data = nullptr;
+			size_t _size = 0;
+		};
+	}
+
+	/// <summary>
+	/// Serialize a module into the binary module format.
+	/// </summary>
+	/// <param name="module">The module to serialize.</param>
+	/// <param name="data">The target buffer the binary data is appended to.</param>
+	void write_binary_module(const module &module, std::vector<uint8_t> &data);
+
+	/// <summary>
+	/// A zero-copy reader for modules in the binary format. All accessors return views into the underlying memory, which has to outlive this object.
+	/// </summary>
+	class module_view
+	{
+	public:
+		/// <summary>
+		/// Open a binary module in memory. The header and all sections are validated, so that the accessors never read outside the buffer.
+		/// </summary>
+		/// <param name="data">Pointer to the binary data (has to be aligned to 4 bytes).</param>
+		/// <param name="size">The size of the binary data in bytes.</param>
+		/// <returns><c>true</c> if the data is a valid binary module, <c>false</c> otherwise.</returns>
+		bool open(const void *data, size_t size);
+
+		/// <summary>
+		/// Check whether a valid binary module was opened.
+		/// </summary>
+		bool is_valid() const { return _header != nullptr; }
+
+		std::string_view hlsl() const;
+		binary::array_view<uint32_t> spirv() const;
+
+		binary::array_view<binary::entry_point_record> entry_points() const { return section<binary::entry_point_record>(binary::section_entry_points); }
+		binary::array_view<binary::texture_record> textures() const { return section<binary::texture_record>(binary::section_textures); }
+		binary::array_view<binary::sampler_record> samplers() const { return section<binary::sampler_record>(binary::section_samplers); }
+		binary::array_view<binary::uniform_record> uniforms() const { return section<binary::uniform_record>(binary::section_uniforms); }
+		binary::array_view<binary::uniform_record> spec_constants() const { return section<binary::uniform_record>(binary::section_spec_constants); }
+		binary::array_view<binary::technique_record> techniques() const { return section<binary::technique_record>(binary::section_techniques); }
+
+		uint32_t total_uniform_size() const { return _header->total_uniform_size; }
+		uint32_t per_frame_uniform_size() const { return _header->per_frame_uniform_size; }
+		uint32_t num_sampler_bindings() const { return _header->num_sampler_bindings; }
+		uint32_t num_texture_bindings() const { return _header->num_texture_bindings; }
+
+		/// <summary>
+		/// Resolve references inside records. Out of range references return an empty view.
+		/// </summary>
+		std::string_view string(binary::string_ref ref) const;
+		binary::array_view<binary::pass_record> passes(binary::range_ref ref) const { return range<binary::pass_record>(binary::section_passes, ref); }
+		binary::array_view<binary::annotation_record> annotations(binary::range_ref ref) const { return range<binary::annotation_record>(binary::section_annotations, ref); }
+		binary::array_view<binary::constant_record> constants(binary::range_ref ref) const { return range<binary::constant_record>(binary::section_constants, ref); }
+		binary::array_view<binary::string_ref> technique_texture_names(binary::range_ref ref) const { return range<binary::string_ref>(binary::section_technique_texture_names, ref); }
+		const binary::constant_record *constant(uint32_t index) const { return constants({ index, 1 }).data(); }
+
+		/// <summary>
+		/// Copy all data of the binary module into a regular in-memory module.
+		/// </summary>
+		/// <param name="module">The target module to fill.</param>
+		/// <returns><c>true</c> on success, <c>false</c> if the binary module contains invalid references.</returns>
+		bool to_module(module &module) const;
+
+	private:
+		template <typename T>
+		binary::array_view<T> section(binary::section index) const
+		{
+			const binary::section_info &info = _header->sections[index];
+			return { reinterpret_cast<const T *>(_data + info.offset), info.count };
+		}
+		template <typename T>
+		binary::array_view<T> range(binary::section index, binary::range_ref ref) const
+		{
+			const binary::array_view<T> records = section<T>(index);
+			if (ref.first > records.size() || ref.count > records.size() - ref.first)
+				return {};
+			return { records.data() + ref.first, ref.count };
+		}
+
+		const uint8_t *_data = nullptr;
+		const binary::header *_header = nullptr;
+	};
+
+	/// <summary>
+	/// A read-only memory-mapped file.
+	/// </summary>
+	class mapped_file
+	{
+	public:
+		mapped_file() = default;
+		mapped_file(const mapped_file &) = delete;
+		mapped_file &operator=(const mapped_file &) = delete;
+		~mapped_file() { close(); }
+
+		/// <summary>
+		/// Map the file at the specified <paramref name="path"/> into memory.
+		/// </summary>
+		bool open(const std::filesystem::path &path);
+		/// <summary>
+		/// Unmap the file again.
+		/// </summary>
+		void close();
+
+		const void *data() const { return _data; }
+		size_t size() const { return _size; }
+
+	private:
+		void *_data = nullptr;
+		size_t _size = 0;
+#ifdef _WIN32
+		void *_mapping = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,163 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_cache.hpp"
+#include "effect_binary.hpp"
+#include <thread>
+#include <cstdio>
+#include <cstring> // std::memcpy
+
+// Increment this whenever the layout of the entry header changes, so that old entries are ignored (the module itself is versioned separately)
+static const uint32_t cache_magic = 0x43584652; // 'RFXC'
+static const uint32_t cache_version = 2;
+
+static uint64_t fnv1a(const void *data, size_t size, uint64_t hash)
+{
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ static_cast<const uint8_t *>(data)[i]) * 0x100000001b3;
+	return hash;
+}
+
+static FILE *open_file(const std::filesystem::path &path)
+{
+#ifdef _WIN32
+	FILE *file = nullptr;
+	if (_wfopen_s(&file, path.c_str(), L"wb") != 0)
+		return nullptr;
+	return file;
+#else
+	return fopen(path.c_str(), "wb");
+#endif
+}
+
+static void write_string(std::vector<uint8_t> &data, const std::string &value)
+{
+	const auto size = static_cast<uint32_t>(value.size());
+	data.insert(data.end(), reinterpret_cast<const uint8_t *>(&size), reinterpret_cast<const uint8_t *>(&size + 1));
+	data.insert(data.end(), value.begin(), value.end());
+}
+static bool read_string(const uint8_t *&it, const uint8_t *end, std::string_view &value)
+{
+	uint32_t size = 0;
+	if (end - it < static_cast<ptrdiff_t>(sizeof(size)))
+		return false;
+	std::memcpy(&size, it, sizeof(size));
+	it += sizeof(size);
+	if (static_cast<size_t>(end - it) < size)
+		return false;
+	value = std::string_view(reinterpret_cast<const char *>(it), size);
+	it += size;
+	return true;
+}
+
+reshadefx::module_cache::module_cache(std::filesystem::path directory) :
+	_directory(std::move(directory))
+{
+}
+
+uint64_t reshadefx::module_cache::compute_key(const std::string &source, const std::string &settings)
+{
+	uint64_t hash = 0xcbf29ce484222325; // FNV-1a offset basis
+	hash = fnv1a(settings.data(), settings.size(), hash);
+	hash = fnv1a("\0", 1, hash); // Separate settings from source, so that different splits cannot produce the same key
+	hash = fnv1a(source.data(), source.size(), hash);
+	return hash;
+}
+
+std::filesystem::path reshadefx::module_cache::entry_path(uint64_t key) const
+{
+	char name[21];
+	snprintf(name, sizeof(name), "%016llx.rfx", static_cast<unsigned long long>(key));
+	return _directory / name;
+}
+
+bool reshadefx::module_cache::load(const std::string &source, const std::string &settings, module &module, std::string &warnings) const
+{
+	if (_directory.empty())
+		return false;
+
+	mapped_file file;
+	if (!file.open(entry_path(compute_key(source, settings))))
+		return false;
+
+	const uint8_t *it = static_cast<const uint8_t *>(file.data());
+	const uint8_t *const end = it + file.size();
+
+	uint32_t header[2] = {};
+	uint64_t source_size = 0;
+	if (file.size() < sizeof(header) + sizeof(source_size))
+		return false;
+	std::memcpy(header, it, sizeof(header));
+	it += sizeof(header);
+	std::memcpy(&source_size, it, sizeof(source_size));
+	it += sizeof(source_size);
+
+	if (header[0] != cache_magic || header[1] != cache_version)
+		return false;
+
+	// The key is only 64 bits, so also compare the source size and settings to rule out a collision
+	std::string_view entry_settings, entry_warnings;
+	if (source_size != source.size() || !read_string(it, end, entry_settings) || entry_settings != settings || !read_string(it, end, entry_warnings))
+		return false;
+
+	// Module data starts at the next 4 byte boundary
+	const size_t module_offset = (it - static_cast<const uint8_t *>(file.data()) + 3) & ~size_t(3);
+	if (module_offset > file.size())
+		return false;
+
+	module_view view;
+	if (!view.open(static_cast<const uint8_t *>(file.data()) + module_offset, file.size() - module_offset))
+		return false;
+
+	module = {};
+	if (!view.to_module(module))
+	{
+		module = {};
+		return false;
+	}
+
+	warnings = entry_warnings;
+	return true;
+}
+
+bool reshadefx::module_cache::save(const std::string &source, const std::string &settings, const module &module, const std::string &warnings) const
+{
+	if (_directory.empty())
+		return false;
+
+	std::vector<uint8_t> data;
+	const uint32_t header[2] = { cache_magic, cache_version };
+	const uint64_t source_size = source.size();
+	data.insert(data.end(), reinterpret_cast<const uint8_t *>(header), reinterpret_cast<const uint8_t *>(header + 2));
+	data.insert(data.end(), reinterpret_cast<const uint8_t *>(&source_size), reinterpret_cast<const uint8_t *>(&source_size + 1));
+	write_string(data, settings);
+	write_string(data, warnings);
+	write_binary_module(module, data);
+
+	std::error_code ec;
+	std::filesystem::create_directories(_directory, ec);
+
+	const std::filesystem::path path = entry_path(compute_key(source, settings));
+	// Write to a temporary file first and rename afterwards, so that other threads or processes never see a partially written entry
+	std::filesystem::path temp_path = path;
+	temp_path += '.' + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	FILE *const file = open_file(temp_path);
+	if (file == nullptr)
+		return false;
+
+	const bool success = fwrite(data.data(), 1, data.size(), file) == data.size();
+	fclose(file);
+
+	if (success)
+		std::filesystem::rename(temp_path, path, ec);
+	if (!success || ec)
+	{
+		std::filesystem::remove(temp_path, ec);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,62 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <filesystem>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// A content-addressed on-disk cache of compiled effect modules.
+	/// Entries are keyed by a hash of the pre-processed source code combined with the code generation settings, so a hit can skip parsing and code generation entirely.
+	/// </summary>
+	class module_cache
+	{
+	public:
+		/// <summary>
+		/// Open the cache in the specified directory. The directory is created on the first write.
+		/// </summary>
+		/// <param name="directory">The path to the cache directory.</param>
+		explicit module_cache(std::filesystem::path directory);
+
+		/// <summary>
+		/// Calculate the key of a cache entry.
+		/// </summary>
+		/// <param name="source">The pre-processed source code.</param>
+		/// <param name="settings">A string describing all code generation settings (renderer, shader model, debug info, ...).</param>
+		static uint64_t compute_key(const std::string &source, const std::string &settings);
+
+		/// <summary>
+		/// Try to load a previously compiled module from the cache.
+		/// </summary>
+		/// <param name="source">The pre-processed source code.</param>
+		/// <param name="settings">A string describing all code generation settings.</param>
+		/// <param name="module">The target module to fill.</param>
+		/// <param name="warnings">The warnings the compiler reported when the entry was created.</param>
+		/// <returns><c>true</c> on a cache hit, <c>false</c> otherwise.</returns>
+		bool load(const std::string &source, const std::string &settings, module &module, std::string &warnings) const;
+		/// <summary>
+		/// Store a compiled module in the cache.
+		/// </summary>
+		/// <param name="source">The pre-processed source code.</param>
+		/// <param name="settings">A string describing all code generation settings.</param>
+		/// <param name="module">The module to store.</param>
+		/// <param name="warnings">The warnings the compiler reported for this module.</param>
+		/// <returns><c>true</c> if the entry was written successfully, <c>false</c> otherwise.</returns>
+		bool save(const std::string &source, const std::string &settings, const module &module, const std::string &warnings) const;
+
+		/// <summary>
+		/// Get the path to the cache directory.
+		/// </summary>
+		const std::filesystem::path &directory() const { return _directory; }
+
+	private:
+		std::filesystem::path entry_path(uint64_t key) const;
+
+		std::filesystem::path _directory;
+	};
+}
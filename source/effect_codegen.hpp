@@ -7,7 +7,11 @@
 
 #include "effect_module.hpp"
 #include <memory> // std::unique_ptr
-#include <algorithm> // std::find_if
+#include <memory_resource> // std::pmr::monotonic_buffer_resource
+#include <limits>
+#include <numeric> // std::iota
+#include <algorithm> // std::find_if, std::remove_if, std::stable_partition
+#include <unordered_set>
 
 namespace reshadefx
 {
@@ -83,9 +87,24 @@ namespace reshadefx
 		/// <summary>
 		/// Define a new effect technique.
 		/// </summary>
-		/// <param name="loc">Source location matching this definition (for debugging).</param>
 		/// <param name="info">The technique description.</param>
-		void define_technique(technique_info &info) { _module.techniques.push_back(info); }
+		/// <param name="referenced">The SSA IDs of all functions, samplers, textures and uniforms reachable from the entry points of the technique.</param>
+		void define_technique(technique_info &info, const std::unordered_set<id> &referenced)
+		{
+			const auto add_texture_name = [&info](const std::string &name) {
+				if (!name.empty() && std::find(info.texture_names.begin(), info.texture_names.end(), name) == info.texture_names.end())
+					info.texture_names.push_back(name);
+			};
+
+			for (const sampler_info &sampler : _module.samplers)
+				if (referenced.find(sampler.id) != referenced.end())
+					add_texture_name(sampler.texture_name);
+			for (const pass_info &pass : info.passes)
+				for (const std::string &target_name : pass.render_target_names)
+					add_texture_name(target_name);
+
+			_module.techniques.push_back(info);
+		}
 		/// <summary>
 		/// Make a function a shader entry point.
 		/// </summary>
@@ -93,6 +112,23 @@ namespace reshadefx
 		/// <param name="is_ps"><c>true</c> if this is a pixel shader, <c>false</c> if it is a vertex shader.</param>
 		virtual void define_entry_point(const function_info &function, bool is_ps) = 0;
 
+		/// <summary>
+		/// Leave all functions, samplers and textures that are not referenced out of the result written in <see cref="write_result"/>.
+		/// </summary>
+		/// <param name="referenced">The SSA IDs of all functions, samplers, textures and uniforms reachable from the entry points and render targets of any technique.</param>
+		void strip_unused(const std::unordered_set<id> &referenced)
+		{
+			_strip_unused = true;
+			_referenced.insert(referenced.begin(), referenced.end());
+		}
+		/// <summary>
+		/// Reorder the uniforms in the global uniform buffer in <see cref="write_result"/>, to group the ones updated every frame at the start and leave as little padding between them as possible.
+		/// </summary>
+		void optimize_uniform_layout()
+		{
+			_optimize_uniform_layout = true;
+		}
+
 		/// <summary>
 		/// Resolve the access chain and add a load operation to the output.
 		/// </summary>
@@ -294,12 +330,102 @@ namespace reshadefx
 	protected:
 		id make_id() { return _next_id++; }
 
+		/// <summary>
+		/// Check whether the function, sampler or texture with the specified <paramref name="id"/> has to be kept in the result.
+		/// </summary>
+		bool is_referenced(id id) const { return !_strip_unused || _referenced.find(id) != _referenced.end(); }
+
+		/// <summary>
+		/// Remove samplers that are not referenced and textures that are neither sampled from by the remaining samplers nor rendered to from the module.
+		/// </summary>
+		void strip_unused_resources()
+		{
+			if (!_strip_unused)
+				return;
+
+			_module.samplers.erase(std::remove_if(_module.samplers.begin(), _module.samplers.end(),
+				[this](const sampler_info &info) { return !is_referenced(info.id); }), _module.samplers.end());
+			_module.textures.erase(std::remove_if(_module.textures.begin(), _module.textures.end(),
+				[this](const texture_info &info) { return !is_referenced(info.id) && std::none_of(_module.samplers.begin(), _module.samplers.end(),
+					[&info](const sampler_info &sampler) { return sampler.texture_name == info.unique_name; }); }), _module.textures.end());
+		}
+
+		/// <summary>
+		/// Assign offsets in the global uniform buffer to all uniforms and update the total buffer size accordingly.
+		/// Uniforms are laid out in declaration order, unless the layout optimization is enabled, in which case the uniforms with a "source" annotation are moved to the start and each of the two groups is packed greedily.
+		/// </summary>
+		/// <param name="align">Function that returns the offset a uniform is placed at when appended to a buffer of the specified size, according to the packing rules of the back-end.</param>
+		/// <returns>Indices into the uniform list, in the order the uniforms have to be declared in to end up at their offsets.</returns>
+		template <typename F>
+		std::vector<size_t> layout_uniforms(F align)
+		{
+			std::vector<size_t> order(_module.uniforms.size());
+			std::iota(order.begin(), order.end(), size_t(0));
+
+			uint32_t offset = 0;
+			const auto place = [this, &align, &offset](size_t index) {
+				uniform_info &info = _module.uniforms[index];
+				info.offset = align(offset, info);
+				offset = info.offset + info.size;
+			};
+
+			if (!_optimize_uniform_layout)
+			{
+				for (size_t index : order)
+					place(index);
+			}
+			else
+			{
+				const auto per_frame_end = std::stable_partition(order.begin(), order.end(), [this](size_t index) {
+					const std::vector<annotation> &annotations = _module.uniforms[index].annotations;
+					return std::any_of(annotations.begin(), annotations.end(), [](const annotation &annotation) { return annotation.name == "source"; });
+				});
+
+				// Always pick the uniform that adds the least padding next, preferring larger ones on ties, so that smaller ones are left over to fill gaps later
+				const auto pack = [this, &align, &offset, &place](std::vector<size_t>::iterator first, std::vector<size_t>::iterator last) {
+					for (; first != last; ++first)
+					{
+						auto best = first;
+						uint32_t best_padding = std::numeric_limits<uint32_t>::max();
+						for (auto it = first; it != last; ++it)
+						{
+							const uniform_info &info = _module.uniforms[*it];
+							const uint32_t padding = align(offset, info) - offset;
+							if (padding < best_padding || (padding == best_padding && info.size > _module.uniforms[*best].size))
+								best = it, best_padding = padding;
+						}
+
+						// Rotate instead of swap, so that the remaining uniforms stay in declaration order
+						std::rotate(first, best, best + 1);
+						place(*first);
+					}
+				};
+
+				// Keeping the uniforms updated every frame together at the start means the range modified each frame stays small and contiguous
+				pack(order.begin(), per_frame_end);
+				_module.per_frame_uniform_size = offset;
+				pack(per_frame_end, order.end());
+			}
+
+			_module.total_uniform_size = offset;
+
+			return order;
+		}
+
+		// Backs the short-lived bookkeeping containers of the back-ends, which all die together with the code generator after 'write_result'
+		// Declared first, so that it outlives every container allocating from it
+		std::pmr::monotonic_buffer_resource _arena { 64 * 1024 };
+
 		module _module;
 		std::vector<struct_info> _structs;
 		std::vector<std::unique_ptr<function_info>> _functions;
 		id _next_id = 1;
 		id _last_block = 0;
 		id _current_block = 0;
+		bool _strip_unused = false;
+		bool _optimize_uniform_layout = false;
+		// Everything that is kept when stripping unused code (back-ends add the entry point functions they generate themselves here too)
+		std::unordered_set<id> _referenced;
 	};
 
 	/// <summary>
@@ -322,5 +448,14 @@ namespace reshadefx
 	/// <param name="debug_info">Whether to append debug information like line directives to the generated code.</param>
 	/// <param name="uniforms_to_spec_constants">Whether to convert uniform variables to specialization constants.</param>
 	/// <param name="invert_y">Insert code to invert the Y component of the output position in vertex shaders.</param>
-	codegen *create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool invert_y = false);
+	/// <param name="optimize">Run the built-in optimization passes on the generated SPIR-V module (see <see cref="optimize_spirv"/>).</param>
+	codegen *create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool invert_y = false, bool optimize = false);
+
+	/// <summary>
+	/// Optimize a SPIR-V module generated by the SPIR-V back-end in place.
+	/// This removes functions and variables that are not used by any entry point, forwards stores to loads of function-local variables, folds constant expressions and merges duplicate types and constants.
+	/// </summary>
+	/// <param name="spirv">The SPIR-V module to optimize.</param>
+	/// <returns><c>true</c> if the module was optimized, <c>false</c> if it contains instructions the optimizer does not support, in which case it is left unchanged.</returns>
+	bool optimize_spirv(std::vector<uint32_t> &spirv);
 }
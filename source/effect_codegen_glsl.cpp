@@ -5,11 +5,15 @@
 
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include "effect_string_pool.hpp"
+#include "effect_output_builder.hpp"
 #include <cmath> // signbit, isinf, isnan
 #include <cstdio> // snprintf
 #include <cassert>
 #include <algorithm> // std::max
 #include <unordered_set>
+#include <tuple>
+#include <unordered_map>
 
 using namespace reshadefx;
 
@@ -37,9 +41,14 @@ private:
 		expression,
 	};
 
-	std::string _ubo_block;
-	std::unordered_map<id, std::string> _names;
-	std::unordered_map<id, std::string> _blocks;
+	std::vector<std::string> _uniform_declarations; // Declaration of each uniform, in the same order as the uniform list in the module
+	string_pool _used_names; // Every name in '_names', so that clashes can be found without searching through all of them
+	std::pmr::unordered_map<id, std::string_view> _names { &_arena }; // Views into '_used_names'
+	std::pmr::unordered_map<id, std::string> _blocks { &_arena };
+	output_builder _output; // Code that is complete already, which 'leave_function' moves the global block and function bodies into
+	std::vector<std::tuple<id, size_t, size_t>> _function_ranges; // Function definition and range of its code in '_output'
+	id _current_function = 0;
+	size_t _current_function_offset = 0; // Offset of the function declaration in the global block
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 	std::unordered_map<id, id> _remapped_sampler_variables;
@@ -52,6 +61,26 @@ private:
 
 	void write_result(module &module) override
 	{
+		// Samplers are only declared now, so that their bindings stay contiguous after removing the unused ones
+		strip_unused_resources();
+
+		std::string samplers;
+		for (sampler_info &info : _module.samplers)
+		{
+			info.binding = _module.num_sampler_bindings++;
+
+			samplers += "layout(binding = " + std::to_string(info.binding) + ") uniform sampler2D " + id_to_name(info.id) + ";\n";
+		}
+
+		// Uniforms are only laid out now too, so that they can be reordered
+		std::string ubo_block;
+		for (size_t index : layout_uniforms([](uint32_t offset, const uniform_info &info) {
+				// Adjust offset according to the alignment rules from 'define_uniform'
+				const uint32_t alignment = (info.type.is_array() || info.type.is_matrix() ? 16u : (info.type.rows == 3 ? 4 : info.type.rows) * 4) - 1;
+				return (offset + alignment) & ~alignment;
+			}))
+			ubo_block += _uniform_declarations[index];
+
 		module = std::move(_module);
 
 		if (_uses_fmod)
@@ -78,9 +107,26 @@ private:
 				"vec3 compCond(bvec3 cond, vec3 a, vec3 b) { return vec3(cond.x ? a.x : b.x, cond.y ? a.y : b.y, cond.z ? a.z : b.z); }\n"
 				"vec4 compCond(bvec4 cond, vec4 a, vec4 b) { return vec4(cond.x ? a.x : b.x, cond.y ? a.y : b.y, cond.z ? a.z : b.z, cond.w ? a.w : b.w); }\n";
 
-		if (!_ubo_block.empty())
-			module.hlsl += "layout(std140, column_major, binding = 0) uniform _Globals {\n" + _ubo_block + "};\n";
-		module.hlsl += _blocks.at(0);
+		if (!ubo_block.empty())
+			module.hlsl += "layout(std140, column_major, binding = 0) uniform _Globals {\n" + ubo_block + "};\n";
+		module.hlsl += samplers;
+
+		const std::string &global_block = _blocks.at(0);
+		module.hlsl.reserve(module.hlsl.size() + _output.size() + global_block.size());
+
+		// Skip over the code of all functions that are not referenced
+		size_t offset = 0;
+		for (const auto &[function, begin, end] : _function_ranges)
+		{
+			if (is_referenced(function))
+				continue;
+
+			_output.write_to(module.hlsl, offset, begin - offset);
+			offset = end;
+		}
+
+		_output.write_to(module.hlsl, offset, _output.size() - offset);
+		module.hlsl += global_block;
 	}
 
 	template <bool is_param = false, bool is_decl = true, bool is_interface = false>
@@ -197,10 +243,11 @@ private:
 				s += data.as_uint[i] ? "true" : "false";
 				break;
 			case type::t_int:
-				s += std::to_string(data.as_int[i]);
+				append_integer(s, data.as_int[i]);
 				break;
 			case type::t_uint:
-				s += std::to_string(data.as_uint[i]) + 'u';
+				append_integer(s, data.as_uint[i]);
+				s += 'u';
 				break;
 			case type::t_float:
 				if (std::isnan(data.as_float[i])) {
@@ -238,8 +285,10 @@ private:
 			id = it->second;
 		assert(id != 0);
 		if (const auto it = _names.find(id); it != _names.end())
-			return it->second;
-		return '_' + std::to_string(id);
+			return std::string(it->second);
+		std::string name(1, '_');
+		append_integer(name, id);
+		return name;
 	}
 
 	template <naming naming_type = naming::general>
@@ -252,9 +301,9 @@ private:
 		if constexpr (naming_type != naming::reserved)
 			name = escape_name(std::move(name));
 		if constexpr (naming_type == naming::general)
-			if (std::find_if(_names.begin(), _names.end(), [&name](const auto &it) { return it.second == name; }) != _names.end())
+			if (_used_names.find(name) != string_pool::invalid_handle)
 				name += '_' + std::to_string(id); // Append a numbered suffix if the name already exists
-		_names[id] = std::move(name);
+		_names[id] = _used_names[_used_names.intern(name)];
 	}
 
 	static std::string escape_name(std::string name)
@@ -287,10 +336,25 @@ private:
 		if (block.empty())
 			return;
 
-		for (size_t pos = 0; (pos = block.find("\n\t", pos)) != std::string::npos; pos += 3)
-			block.replace(pos, 2, "\n\t\t");
+		// Build the result in one pass, since replacing in place would move the rest of the block for every line
+		std::string result;
+		result.reserve(block.size() + block.size() / 16);
+		result += '\t';
+
+		for (size_t pos = 0, next; pos < block.size(); pos = next)
+		{
+			next = block.find("\n\t", pos);
+			if (next == std::string::npos)
+				next = block.size();
+			else
+				next += 1;
+
+			result.append(block, pos, next - pos);
+			if (next < block.size())
+				result += '\t';
+		}
 
-		block.insert(block.begin(), '\t');
+		block = std::move(result);
 	}
 
 	id   define_struct(const location &loc, struct_info &info) override
@@ -332,21 +396,15 @@ private:
 
 		return info.id;
 	}
-	id   define_sampler(const location &loc, sampler_info &info) override
+	id   define_sampler(const location &, sampler_info &info) override
 	{
 		info.id = make_id();
-		info.binding = _module.num_sampler_bindings++;
 
 		define_name<naming::unique>(info.id, info.unique_name);
 
+		// Bindings are assigned in 'write_result'
 		_module.samplers.push_back(info);
 
-		std::string &code = _blocks.at(_current_block);
-
-		write_location(code, loc);
-
-		code += "layout(binding = " + std::to_string(info.binding) + ") uniform sampler2D " + id_to_name(info.id) + ";\n";
-
 		return info.id;
 	}
 	id   define_uniform(const location &loc, uniform_info &info) override
@@ -359,7 +417,7 @@ private:
 		//    according to rules (1), (2), and (3), and rounded up to the base alignment of a four-component vector.
 		// 5. If the member is a column-major matrix with C columns and R rows, the matrix is stored identically to an array of C column vectors with R components each, according to rule (4).
 		// 7. If the member is a row-major matrix with C columns and R rows, the matrix is stored identically to an array of R row vectors with C components each, according to rule (4).
-		uint32_t alignment = info.type.is_array() || info.type.is_matrix() ? 16u : (info.type.rows == 3 ? 4 : info.type.rows) * 4;
+		const uint32_t alignment = info.type.is_array() || info.type.is_matrix() ? 16u : (info.type.rows == 3 ? 4 : info.type.rows) * 4;
 		info.size = info.type.is_matrix() ? alignment * info.type.rows /* column major layout, with row major layout this would be columns */ : info.type.rows * 4;
 		if (info.type.is_array())
 			info.size = std::max(16u, info.size) * info.type.array_length;
@@ -385,17 +443,15 @@ private:
 		}
 		else
 		{
-			// Adjust offset according to alignment rules from above
-			alignment -= 1;
-			info.offset = (_module.total_uniform_size + alignment) & ~alignment;
-			_module.total_uniform_size = info.offset + info.size;
+			// The offset is only assigned once all uniforms are known (see 'write_result')
+			std::string &code = _uniform_declarations.emplace_back();
 
-			write_location(_ubo_block, loc);
+			write_location(code, loc);
 
-			_ubo_block += '\t';
+			code += '\t';
 			// Note: All matrices are floating-point, even if the uniform type says different!!
-			write_type(_ubo_block, info.type);
-			_ubo_block += ' ' + id_to_name(res) + ";\n";
+			write_type(code, info.type);
+			code += ' ' + id_to_name(res) + ";\n";
 
 			_module.uniforms.push_back(info);
 		}
@@ -451,6 +507,9 @@ private:
 
 		std::string &code = _blocks.at(_current_block);
 
+		_current_function = info.definition;
+		_current_function_offset = code.size();
+
 		write_location(code, loc);
 
 		write_type(code, info.return_type);
@@ -571,6 +630,9 @@ private:
 		define_function({}, entry_point, true);
 		enter_block(create_block());
 
+		// This function is generated for a technique, so always keep it
+		_referenced.insert(entry_point.definition);
+
 		std::string &code = _blocks.at(_current_block);
 
 		// Handle input parameters
@@ -1507,7 +1569,19 @@ private:
 	{
 		assert(_last_block != 0);
 
-		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
+		// Everything in the global block so far precedes this function, so move it to the output together with the function body
+		std::string &global_block = _blocks.at(0);
+		const size_t function_begin = _output.size() + _current_function_offset;
+		_output += global_block;
+		global_block.clear();
+
+		_output += "{\n";
+		_output += _blocks.at(_last_block);
+		_output += "}\n";
+
+		_function_ranges.emplace_back(_current_function, function_begin, _output.size());
+
+		_blocks.erase(_last_block);
 	}
 };
 
@@ -5,11 +5,15 @@
 
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include "effect_string_pool.hpp"
+#include "effect_output_builder.hpp"
 #include <cmath> // signbit, isinf, isnan
 #include <cstdio> // snprintf
 #include <cassert>
 #include <cstring> // stricmp
 #include <algorithm> // std::max
+#include <tuple>
+#include <unordered_map>
 
 using namespace reshadefx;
 
@@ -35,37 +39,162 @@ private:
 		expression,
 	};
 
-	std::string _cbuffer_block;
+	std::vector<std::string> _uniform_declarations; // Declaration of each uniform without the terminating semicolon, in the same order as the uniform list in the module
 	std::string _current_location;
-	std::unordered_map<id, std::string> _names;
-	std::unordered_map<id, std::string> _blocks;
+	string_pool _used_names; // Every name in '_names', so that clashes can be found without searching through all of them
+	std::pmr::unordered_map<id, std::string_view> _names { &_arena }; // Views into '_used_names'
+	std::pmr::unordered_map<id, std::string> _blocks { &_arena };
+	output_builder _output; // Code that is complete already, which 'leave_function' moves the global block and function bodies into
+	std::vector<std::tuple<id, size_t, size_t>> _function_ranges; // Function definition and range of its code in '_output'
+	id _current_function = 0;
+	size_t _current_function_offset = 0; // Offset of the function declaration in the global block
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 	unsigned int _shader_model = 0;
 
 	void write_result(module &module) override
 	{
+		// Resources are only declared now, so that their bindings stay contiguous after removing the unused ones
+		strip_unused_resources();
+
+		std::string resources;
+		write_resources(resources);
+
+		// Uniforms are only laid out now too, so that they can be reordered
+		std::string cbuffer_block;
+		write_uniforms(cbuffer_block);
+
 		module = std::move(_module);
 
 		if (_shader_model >= 40)
 		{
 			module.hlsl += "struct __sampler2D { Texture2D t; SamplerState s; };\n";
 
-			if (!_cbuffer_block.empty())
-				module.hlsl += "cbuffer _Globals {\n" + _cbuffer_block + "};\n";
+			if (!cbuffer_block.empty())
+				module.hlsl += "cbuffer _Globals {\n" + cbuffer_block + "};\n";
 		}
 		else
 		{
 			module.hlsl += "struct __sampler2D { sampler2D s; float2 pixelsize; };\nuniform float2 __TEXEL_SIZE__ : register(c255);\n";
 
-			if (!_cbuffer_block.empty())
-				module.hlsl += _cbuffer_block;
+			if (!cbuffer_block.empty())
+				module.hlsl += cbuffer_block;
 
-			// Offsets were multiplied in 'define_uniform', so adjust total size here accordingly
+			// Offsets were multiplied in 'write_uniforms', so adjust total size here accordingly
 			module.total_uniform_size *= 4;
+			module.per_frame_uniform_size *= 4;
+		}
+
+		module.hlsl += resources;
+
+		const std::string &global_block = _blocks.at(0);
+		module.hlsl.reserve(module.hlsl.size() + _output.size() + global_block.size());
+
+		// Skip over the code of all functions that are not referenced
+		size_t offset = 0;
+		for (const auto &[function, begin, end] : _function_ranges)
+		{
+			if (is_referenced(function))
+				continue;
+
+			_output.write_to(module.hlsl, offset, begin - offset);
+			offset = end;
+		}
+
+		_output.write_to(module.hlsl, offset, _output.size() - offset);
+		module.hlsl += global_block;
+	}
+
+	void write_uniforms(std::string &code)
+	{
+		const std::vector<size_t> order = layout_uniforms([](uint32_t offset, const uniform_info &info) {
+			// Data is packed into 4-byte boundaries (see https://docs.microsoft.com/en-us/windows/win32/direct3dhlsl/dx-graphics-hlsl-packing-rules)
+			// This is already guaranteed, since all types are at least 4-byte in size
+			// Additionally HLSL packs data so that it does not cross a 16-byte boundary
+			const uint32_t remaining = 16 - (offset & 15);
+			if (remaining != 16 && info.size > remaining)
+				offset += remaining;
+			return offset;
+		});
+
+		for (size_t index : order)
+		{
+			uniform_info &info = _module.uniforms[index];
+
+			code += _uniform_declarations[index];
+
+			if (_shader_model < 40)
+			{
+				// Simply put each uniform into a separate constant register in shader model 3 for now
+				info.offset *= 4;
+
+				// Every constant register is 16 bytes wide, so divide memory offset by 16 to get the constant register index
+				code += " : register(c" + std::to_string(info.offset / 16) + ')';
+			}
+
+			code += ";\n";
 		}
+	}
+
+	void write_resources(std::string &code)
+	{
+		for (texture_info &info : _module.textures)
+		{
+			info.binding = _module.num_texture_bindings;
+
+			if (_shader_model >= 40)
+			{
+				code += "Texture2D "       + info.unique_name + " : register(t" + std::to_string(info.binding + 0) + ");\n";
+				code += "Texture2D __srgb" + info.unique_name + " : register(t" + std::to_string(info.binding + 1) + ");\n";
+
+				_module.num_texture_bindings += 2;
+			}
+		}
+
+		for (sampler_info &info : _module.samplers)
+		{
+			const auto texture = std::find_if(_module.textures.begin(), _module.textures.end(),
+				[&info](const auto &it) { return it.unique_name == info.texture_name; });
+			assert(texture != _module.textures.end());
+
+			if (_shader_model >= 40)
+			{
+				// Try and reuse a sampler binding with the same sampler description
+				const auto existing_sampler = std::find_if(_module.samplers.data(), &info,
+					[&info](const auto &it) { return it.filter == info.filter && it.address_u == info.address_u && it.address_v == info.address_v && it.address_w == info.address_w && it.min_lod == info.min_lod && it.max_lod == info.max_lod && it.lod_bias == info.lod_bias; });
+
+				if (existing_sampler != &info)
+				{
+					info.binding = existing_sampler->binding;
+				}
+				else
+				{
+					info.binding = _module.num_sampler_bindings++;
+
+					code += "SamplerState __s" + std::to_string(info.binding) + " : register(s" + std::to_string(info.binding) + ");\n";
+				}
+
+				assert(info.srgb == 0 || info.srgb == 1);
+				info.texture_binding = texture->binding + info.srgb; // Offset binding by one to choose the SRGB variant
+
+				code += "static const __sampler2D " + id_to_name(info.id) + " = { " + (info.srgb ? "__srgb" : "") + info.texture_name + ", __s" + std::to_string(info.binding) + " };\n";
+			}
+			else
+			{
+				info.binding = _module.num_sampler_bindings++;
+
+				code += "sampler2D __" + info.unique_name + "_s : register(s" + std::to_string(info.binding) + ");\n";
+
+				code += "static const __sampler2D " + id_to_name(info.id) + " = { __" + info.unique_name + "_s, float2(";
+
+				if (texture->semantic.empty())
+					code += "1.0 / " + std::to_string(texture->width) + ", 1.0 / " + std::to_string(texture->height);
+				else
+					code += texture->semantic + "_PIXEL_SIZE"; // Expect application to set inverse texture size via a define if it is not known here
 
-		module.hlsl += _blocks.at(0);
+				code += ") }; \n";
+			}
+		}
 	}
 
 	template <bool is_param = false, bool is_decl = true>
@@ -172,10 +301,10 @@ private:
 				s += data.as_uint[i] ? "true" : "false";
 				break;
 			case type::t_int:
-				s += std::to_string(data.as_int[i]);
+				append_integer(s, data.as_int[i]);
 				break;
 			case type::t_uint:
-				s += std::to_string(data.as_uint[i]);
+				append_integer(s, data.as_uint[i]);
 				break;
 			case type::t_float:
 				if (std::isnan(data.as_float[i])) {
@@ -225,8 +354,10 @@ private:
 	std::string id_to_name(id id) const
 	{
 		if (const auto it = _names.find(id); it != _names.end())
-			return it->second;
-		return '_' + std::to_string(id);
+			return std::string(it->second);
+		std::string name(1, '_');
+		append_integer(name, id);
+		return name;
 	}
 
 	template <naming naming_type = naming::general>
@@ -238,9 +369,9 @@ private:
 				return; // Filter out names that may clash with automatic ones
 		name = escape_name(std::move(name));
 		if constexpr (naming_type == naming::general)
-			if (std::find_if(_names.begin(), _names.end(), [&name](const auto &it) { return it.second == name; }) != _names.end())
+			if (_used_names.find(name) != string_pool::invalid_handle)
 				name += '_' + std::to_string(id); // Append a numbered suffix if the name already exists
-		_names[id] = std::move(name);
+		_names[id] = _used_names[_used_names.intern(name)];
 	}
 
 	std::string convert_semantic(const std::string &semantic) const
@@ -294,10 +425,25 @@ private:
 		if (block.empty())
 			return;
 
-		for (size_t pos = 0; (pos = block.find("\n\t", pos)) != std::string::npos; pos += 3)
-			block.replace(pos, 2, "\n\t\t");
+		// Build the result in one pass, since replacing in place would move the rest of the block for every line
+		std::string result;
+		result.reserve(block.size() + block.size() / 16);
+		result += '\t';
+
+		for (size_t pos = 0, next; pos < block.size(); pos = next)
+		{
+			next = block.find("\n\t", pos);
+			if (next == std::string::npos)
+				next = block.size();
+			else
+				next += 1;
+
+			result.append(block, pos, next - pos);
+			if (next < block.size())
+				result += '\t';
+		}
 
-		block.insert(block.begin(), '\t');
+		block = std::move(result);
 	}
 
 	id   define_struct(const location &loc, struct_info &info) override
@@ -329,81 +475,22 @@ private:
 
 		return info.definition;
 	}
-	id   define_texture(const location &loc, texture_info &info) override
+	id   define_texture(const location &, texture_info &info) override
 	{
 		info.id = make_id();
-		info.binding = _module.num_texture_bindings;
 
+		// Bindings are assigned in 'write_result'
 		_module.textures.push_back(info);
 
-		std::string &code = _blocks.at(_current_block);
-
-		if (_shader_model >= 40)
-		{
-			write_location(code, loc);
-
-			code += "Texture2D "       + info.unique_name + " : register(t" + std::to_string(info.binding + 0) + ");\n";
-			code += "Texture2D __srgb" + info.unique_name + " : register(t" + std::to_string(info.binding + 1) + ");\n";
-
-			_module.num_texture_bindings += 2;
-		}
-
 		return info.id;
 	}
-	id   define_sampler(const location &loc, sampler_info &info) override
+	id   define_sampler(const location &, sampler_info &info) override
 	{
 		info.id = make_id();
 
 		define_name<naming::unique>(info.id, info.unique_name);
 
-		const auto texture = std::find_if(_module.textures.begin(), _module.textures.end(),
-			[&info](const auto &it) { return it.unique_name == info.texture_name; });
-		assert(texture != _module.textures.end());
-
-		std::string &code = _blocks.at(_current_block);
-
-		if (_shader_model >= 40)
-		{
-			// Try and reuse a sampler binding with the same sampler description
-			const auto existing_sampler = std::find_if(_module.samplers.begin(), _module.samplers.end(),
-				[&info](const auto &it) { return it.filter == info.filter && it.address_u == info.address_u && it.address_v == info.address_v && it.address_w == info.address_w && it.min_lod == info.min_lod && it.max_lod == info.max_lod && it.lod_bias == info.lod_bias; });
-
-			if (existing_sampler != _module.samplers.end())
-			{
-				info.binding = existing_sampler->binding;
-			}
-			else
-			{
-				info.binding = _module.num_sampler_bindings++;
-
-				code += "SamplerState __s" + std::to_string(info.binding) + " : register(s" + std::to_string(info.binding) + ");\n";
-			}
-
-			assert(info.srgb == 0 || info.srgb == 1);
-			info.texture_binding = texture->binding + info.srgb; // Offset binding by one to choose the SRGB variant
-
-			write_location(code, loc);
-
-			code += "static const __sampler2D " + id_to_name(info.id) + " = { " + (info.srgb ? "__srgb" : "") + info.texture_name + ", __s" + std::to_string(info.binding) + " };\n";
-		}
-		else
-		{
-			info.binding = _module.num_sampler_bindings++;
-
-			code += "sampler2D __" + info.unique_name + "_s : register(s" + std::to_string(info.binding) + ");\n";
-
-			write_location(code, loc);
-
-			code += "static const __sampler2D " + id_to_name(info.id) + " = { __" + info.unique_name + "_s, float2(";
-
-			if (texture->semantic.empty())
-				code += "1.0 / " + std::to_string(texture->width) + ", 1.0 / " + std::to_string(texture->height);
-			else
-				code += texture->semantic + "_PIXEL_SIZE"; // Expect application to set inverse texture size via a define if it is not known here
-
-			code += ") }; \n";
-		}
-
+		// Bindings are assigned in 'write_result'
 		_module.samplers.push_back(info);
 
 		return info.id;
@@ -436,21 +523,15 @@ private:
 		}
 		else
 		{
-			// Data is packed into 4-byte boundaries (see https://docs.microsoft.com/en-us/windows/win32/direct3dhlsl/dx-graphics-hlsl-packing-rules)
-			// This is already guaranteed, since all types are at least 4-byte in size
-			info.offset = _module.total_uniform_size;
-			// Additionally HLSL packs data so that it does not cross a 16-byte boundary
-			const uint32_t remaining = 16 - (info.offset & 15);
-			if (remaining != 16 && info.size > remaining)
-				info.offset += remaining;
-			_module.total_uniform_size = info.offset + info.size;
+			// The offset is only assigned once all uniforms are known (see 'write_uniforms')
+			std::string &code = _uniform_declarations.emplace_back();
 
-			write_location<true>(_cbuffer_block, loc);
+			write_location<true>(code, loc);
 
 			if (_shader_model >= 40)
-				_cbuffer_block += '\t';
+				code += '\t';
 			if (info.type.is_matrix()) // Force row major matrices
-				_cbuffer_block += "row_major ";
+				code += "row_major ";
 
 			if (_shader_model < 40)
 			{
@@ -459,20 +540,16 @@ private:
 				if (type.is_boolean())
 					type.base = type::t_float;
 
-				// Simply put each uniform into a separate constant register in shader model 3 for now
-				info.offset *= 4;
-
-				// Every constant register is 16 bytes wide, so divide memory offset by 16 to get the constant register index
 				// Note: All uniforms are floating-point in shader model 3, even if the uniform type says different!!
-				write_type(_cbuffer_block, type);
-				_cbuffer_block += ' ' + id_to_name(res) + " : register(c" + std::to_string(info.offset / 16) + ");\n";
+				write_type(code, type);
 			}
 			else
 			{
-				write_type(_cbuffer_block, info.type);
-				_cbuffer_block += ' ' + id_to_name(res) + ";\n";
+				write_type(code, info.type);
 			}
 
+			code += ' ' + id_to_name(res);
+
 			_module.uniforms.push_back(info);
 		}
 
@@ -520,6 +597,9 @@ private:
 
 		std::string &code = _blocks.at(_current_block);
 
+		_current_function = info.definition;
+		_current_function_offset = code.size();
+
 		write_location(code, loc);
 
 		write_type(code, info.return_type);
@@ -605,6 +685,9 @@ private:
 		define_function({}, entry_point, true);
 		enter_block(create_block());
 
+		// This function is generated for a technique, so always keep it
+		_referenced.insert(entry_point.definition);
+
 		std::string &code = _blocks.at(_current_block);
 
 		// Clear all color output parameters so no component is left uninitialized
@@ -1422,7 +1505,19 @@ private:
 	{
 		assert(_last_block != 0);
 
-		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
+		// Everything in the global block so far precedes this function, so move it to the output together with the function body
+		std::string &global_block = _blocks.at(0);
+		const size_t function_begin = _output.size() + _current_function_offset;
+		_output += global_block;
+		global_block.clear();
+
+		_output += "{\n";
+		_output += _blocks.at(_last_block);
+		_output += "}\n";
+
+		_function_ranges.emplace_back(_current_function, function_begin, _output.size());
+
+		_blocks.erase(_last_block);
 	}
 };
 
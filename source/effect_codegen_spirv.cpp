@@ -7,8 +7,9 @@
 #include "effect_codegen.hpp"
 #include <cassert>
 #include <cstring> // memcmp
-#include <algorithm> // std::find_if, std::max
+#include <algorithm> // std::find_if, std::max, std::remove_if
 #include <unordered_set>
+#include <unordered_map>
 
 // Use the C++ variant of the SPIR-V headers
 #include <spirv.hpp>
@@ -23,14 +24,25 @@ using namespace reshadefx;
 /// </summary>
 struct spirv_instruction
 {
+	// Instructions stored in a basic block allocate their operands from the same memory resource as the block
+	using allocator_type = std::pmr::polymorphic_allocator<spv::Id>;
+
 	spv::Op op;
 	spv::Id type;
 	spv::Id result;
-	std::vector<spv::Id> operands;
+	std::pmr::vector<spv::Id> operands;
 
 	explicit spirv_instruction(spv::Op op = spv::OpNop) : op(op), type(0), result(0) { }
 	spirv_instruction(spv::Op op, spv::Id result) : op(op), type(result), result(0) { }
 	spirv_instruction(spv::Op op, spv::Id type, spv::Id result) : op(op), type(type), result(result) { }
+	spirv_instruction(const spirv_instruction &) = default;
+	spirv_instruction(spirv_instruction &&) = default;
+	spirv_instruction(std::allocator_arg_t, const allocator_type &alloc, spv::Op op = spv::OpNop) : op(op), type(0), result(0), operands(alloc) { }
+	spirv_instruction(std::allocator_arg_t, const allocator_type &alloc, const spirv_instruction &other) : op(other.op), type(other.type), result(other.result), operands(other.operands, alloc) { }
+	spirv_instruction(std::allocator_arg_t, const allocator_type &alloc, spirv_instruction &&other) : op(other.op), type(other.type), result(other.result), operands(std::move(other.operands), alloc) { }
+
+	spirv_instruction &operator=(const spirv_instruction &) = default;
+	spirv_instruction &operator=(spirv_instruction &&) = default;
 
 	/// <summary>
 	/// Add a single operand to the instruction.
@@ -100,7 +112,19 @@ struct spirv_instruction
 /// </summary>
 struct spirv_basic_block
 {
-	std::vector<spirv_instruction> instructions;
+	using allocator_type = std::pmr::polymorphic_allocator<spirv_instruction>;
+
+	std::pmr::vector<spirv_instruction> instructions;
+
+	spirv_basic_block() = default;
+	spirv_basic_block(const spirv_basic_block &) = default;
+	spirv_basic_block(spirv_basic_block &&) = default;
+	explicit spirv_basic_block(const allocator_type &alloc) : instructions(alloc) { }
+	spirv_basic_block(const spirv_basic_block &other, const allocator_type &alloc) : instructions(other.instructions, alloc) { }
+	spirv_basic_block(spirv_basic_block &&other, const allocator_type &alloc) : instructions(std::move(other.instructions), alloc) { }
+
+	spirv_basic_block &operator=(const spirv_basic_block &) = default;
+	spirv_basic_block &operator=(spirv_basic_block &&) = default;
 
 	/// <summary>
 	/// Append another basic block the end of this one.
@@ -114,8 +138,8 @@ struct spirv_basic_block
 class codegen_spirv final : public codegen
 {
 public:
-	codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool invert_y)
-		: _invert_y(invert_y), _debug_info(debug_info), _vulkan_semantics(vulkan_semantics), _uniforms_to_spec_constants(uniforms_to_spec_constants)
+	codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool invert_y, bool optimize)
+		: _invert_y(invert_y), _optimize(optimize), _debug_info(debug_info), _vulkan_semantics(vulkan_semantics), _uniforms_to_spec_constants(uniforms_to_spec_constants)
 	{
 		_glsl_ext = make_id();
 	}
@@ -147,13 +171,13 @@ private:
 		}
 	};
 
-	spirv_basic_block _entries;
-	spirv_basic_block _execution_modes;
-	spirv_basic_block _debug_a;
-	spirv_basic_block _debug_b;
-	spirv_basic_block _annotations;
-	spirv_basic_block _types_and_constants;
-	spirv_basic_block _variables;
+	spirv_basic_block _entries { &_arena };
+	spirv_basic_block _execution_modes { &_arena };
+	spirv_basic_block _debug_a { &_arena };
+	spirv_basic_block _debug_b { &_arena };
+	spirv_basic_block _annotations { &_arena };
+	spirv_basic_block _types_and_constants { &_arena };
+	spirv_basic_block _variables { &_arena };
 
 	std::unordered_set<spv::Capability> _capabilities;
 	std::vector<type_lookup> _type_lookup;
@@ -166,16 +190,19 @@ private:
 	std::unordered_set<spv::Id> _spec_constants;
 
 	std::vector<function_blocks> _functions_blocks;
-	std::unordered_map<id, spirv_basic_block> _block_data;
+	std::pmr::unordered_map<id, spirv_basic_block> _block_data { &_arena };
 	spirv_basic_block *_current_block_data = nullptr;
 
 	bool _invert_y = false;
+	bool _optimize = false;
 	bool _debug_info = false;
 	bool _vulkan_semantics = false;
 	bool _uniforms_to_spec_constants = false;
 	id _glsl_ext = 0;
 	id _global_ubo_variable = 0;
 	struct_info _global_ubo_type;
+	// Constants holding the member index of each uniform in the global UBO type, which are only defined once the member order is known (see 'write_result')
+	std::vector<spv::Id> _global_ubo_member_indices;
 	function_blocks *_current_function = nullptr;
 
 	inline void add_location(const location &loc, spirv_basic_block &block)
@@ -225,11 +252,54 @@ private:
 		// The name for both the type and variable were initialized in 'define_uniform' earlier already
 		if (_global_ubo_type.definition != 0)
 		{
+			// Members are declared in offset order, since many tools assume that offsets increase with the member index
+			const std::vector<size_t> order = layout_uniforms([](uint32_t offset, const uniform_info &info) {
+				// Make sure member does not have an improper straddle
+				const uint32_t remaining = 16 - (offset & 15);
+				if (remaining != 16 && info.size > remaining)
+					offset += remaining;
+				return offset;
+			});
+
+			std::vector<uint32_t> member_indices(order.size());
+			std::vector<struct_member_info> member_list;
+			member_list.reserve(order.size());
+			for (size_t index : order)
+			{
+				member_indices[index] = static_cast<uint32_t>(member_list.size());
+				member_list.push_back(std::move(_global_ubo_type.member_list[index]));
+			}
+			_global_ubo_type.member_list = std::move(member_list);
+
+			// Member decorations added in 'define_uniform' still use the declaration order, so remap them to the new member indices
+			for (spirv_instruction &node : _annotations.instructions)
+				if (node.op == spv::OpMemberDecorate && node.operands[0] == _global_ubo_type.definition)
+					node.operands[1] = member_indices[node.operands[1]];
+
+			const spv::Id member_index_type = convert_type({ type::t_uint, 1, 1 });
+
+			for (size_t index = 0; index < member_indices.size(); ++index)
+			{
+				add_member_decoration(_global_ubo_type.definition, member_indices[index], spv::DecorationOffset, { _module.uniforms[index].offset });
+
+				// Access chains referenced the member index through a constant that is only defined here
+				if (const spv::Id member_index_constant = _global_ubo_member_indices[index]; member_index_constant != 0)
+				{
+					spirv_instruction &instruction = add_instruction_without_result(spv::OpConstant, _types_and_constants);
+					instruction.type = member_index_type;
+					instruction.result = member_index_constant;
+					instruction.add(member_indices[index]);
+				}
+			}
+
 			define_struct({}, _global_ubo_type);
 
 			define_variable(_global_ubo_variable, {}, { type::t_struct, 0, 0, type::q_uniform, 0, _global_ubo_type.definition }, "$Globals", spv::StorageClassUniform);
 		}
 
+		if (_strip_unused)
+			strip_unused_code();
+
 		module = std::move(_module);
 
 		// Write SPIRV header info
@@ -297,7 +367,7 @@ private:
 		// All function definitions
 		for (const auto &function : _functions_blocks)
 		{
-			if (function.definition.instructions.empty())
+			if (function.definition.instructions.empty() || function.declaration.instructions.empty())
 				continue;
 
 			for (const auto &node : function.declaration.instructions)
@@ -312,6 +382,63 @@ private:
 			for (auto it = function.definition.instructions.begin() + 1; it != function.definition.instructions.end(); ++it)
 				it->write(module.spirv);
 		}
+
+		if (_optimize)
+			optimize_spirv(module.spirv);
+	}
+
+	void strip_unused_code()
+	{
+		std::unordered_set<spv::Id> removed_ids;
+		for (const sampler_info &info : _module.samplers)
+			removed_ids.insert(info.id);
+
+		strip_unused_resources();
+
+		// Compact the bindings of the samplers that are left
+		uint32_t next_binding = 0;
+		for (sampler_info &info : _module.samplers)
+		{
+			removed_ids.erase(info.id);
+
+			info.binding = next_binding++;
+
+			for (spirv_instruction &node : _annotations.instructions)
+				if (node.op == spv::OpDecorate && node.operands.size() == 3 && node.operands[0] == info.id && node.operands[1] == spv::DecorationBinding)
+					node.operands[2] = info.binding;
+		}
+		_module.num_sampler_bindings = next_binding;
+
+		// Remove the variables of the samplers that were stripped
+		_variables.instructions.erase(std::remove_if(_variables.instructions.begin(), _variables.instructions.end(),
+			[&removed_ids](const spirv_instruction &node) { return node.op == spv::OpVariable && removed_ids.count(node.result) != 0; }), _variables.instructions.end());
+
+		// Remove functions that are not referenced, together with all IDs defined inside them
+		for (function_blocks &function : _functions_blocks)
+		{
+			if (function.declaration.instructions.empty())
+				continue;
+
+			const auto it = std::find_if(function.declaration.instructions.begin(), function.declaration.instructions.end(),
+				[](const spirv_instruction &node) { return node.op == spv::OpFunction; });
+			if (it == function.declaration.instructions.end() || is_referenced(it->result))
+				continue;
+
+			for (const spirv_basic_block *block : { &function.declaration, &function.variables, &function.definition })
+				for (const spirv_instruction &node : block->instructions)
+					if (node.result != 0)
+						removed_ids.insert(node.result);
+
+			function.declaration.instructions.clear();
+		}
+
+		// Finally remove all debug names and decorations that target removed IDs
+		const auto targets_removed_id = [&removed_ids](const spirv_instruction &node) {
+			return !node.operands.empty() && removed_ids.count(node.operands[0]) != 0;
+		};
+
+		_debug_b.instructions.erase(std::remove_if(_debug_b.instructions.begin(), _debug_b.instructions.end(), targets_removed_id), _debug_b.instructions.end());
+		_annotations.instructions.erase(std::remove_if(_annotations.instructions.begin(), _annotations.instructions.end(), targets_removed_id), _annotations.instructions.end());
 	}
 
 	spv::Id convert_type(const type &info, bool is_ptr = false, spv::StorageClass storage = spv::StorageClassFunction)
@@ -702,17 +829,12 @@ private:
 				add_decoration(_global_ubo_variable, spv::DecorationDescriptorSet, { 0 });
 			}
 
-			info.offset = _module.total_uniform_size;
-			// Make sure member does not have an improper straddle
-			const uint32_t remaining = 16 - (info.offset & 15);
-			if (remaining != 16 && info.size > remaining)
-				info.offset += remaining;
-			_module.total_uniform_size = info.offset + info.size;
-
+			// The offset is only assigned once all uniforms are known (see 'write_result')
 			_module.uniforms.push_back(info);
 
 			auto &member_list = _global_ubo_type.member_list;
 			member_list.push_back({ info.type, info.name });
+			_global_ubo_member_indices.push_back(0);
 
 			// Convert boolean uniform variables to integer type so that they have a defined size
 			if (info.type.is_boolean())
@@ -720,8 +842,6 @@ private:
 
 			const uint32_t member_index = static_cast<uint32_t>(member_list.size() - 1);
 
-			add_member_decoration(_global_ubo_type.definition, member_index, spv::DecorationOffset, { info.offset });
-
 			if (info.type.is_array())
 			{
 				add_member_decoration(_global_ubo_type.definition, member_index, spv::DecorationArrayStride, { array_stride });
@@ -779,7 +899,7 @@ private:
 	{
 		assert(!is_in_function());
 
-		auto &function = _functions_blocks.emplace_back();
+		auto &function = _functions_blocks.emplace_back(function_blocks { spirv_basic_block(&_arena), spirv_basic_block(&_arena), spirv_basic_block(&_arena) });
 		function.return_type = info.return_type;
 
 		_current_function = &function;
@@ -829,6 +949,9 @@ private:
 		define_function({}, entry_point);
 		enter_block(create_block());
 
+		// This function is generated for a technique, so always keep it
+		_referenced.insert(entry_point.definition);
+
 		const auto semantic_to_builtin = [this, is_ps](const std::string &semantic, spv::BuiltIn &builtin) {
 			builtin = spv::BuiltInMax;
 			if (semantic == "SV_POSITION")
@@ -1142,9 +1265,14 @@ private:
 				if (is_uniform_bool)
 					base_type.base = type::t_uint;
 
+				// The final member index is only known after the uniform buffer layout was assigned, so reference it through a constant that is defined later
+				spv::Id &member_index_constant = _global_ubo_member_indices[member_index];
+				if (member_index_constant == 0)
+					member_index_constant = make_id();
+
 				result = add_instruction(spv::OpAccessChain, convert_type(base_type, true, spv::StorageClassUniform))
 					.add(_global_ubo_variable)
-					.add(emit_constant(member_index))
+					.add(member_index_constant)
 					.result;
 
 				storage = spv::StorageClassUniform;
@@ -2030,7 +2158,7 @@ private:
 	}
 };
 
-codegen *reshadefx::create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool invert_y)
+codegen *reshadefx::create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool invert_y, bool optimize)
 {
-	return new codegen_spirv(vulkan_semantics, debug_info, uniforms_to_spec_constants, invert_y);
+	return new codegen_spirv(vulkan_semantics, debug_info, uniforms_to_spec_constants, invert_y, optimize);
 }
@@ -470,3 +470,33 @@ bool reshadefx::expression::evaluate_constant_expression(reshadefx::tokenid op,
 
 	return true;
 }
+bool reshadefx::expression::evaluate_constant_intrinsic(const reshadefx::location &loc, uint32_t intrinsic, const reshadefx::type &res_type, const std::vector<expression> &args)
+{
+	// Intrinsics without a return value only have side effects through their output parameters, so never fold those
+	if (!res_type.is_numeric())
+		return false;
+
+	for (const expression &arg : args)
+		if (!arg.is_constant || !arg.type.is_numeric() || arg.type.is_array())
+			return false;
+
+	enum
+	{
+#define IMPLEMENT_INTRINSIC_SPIRV(name, i, code) name##i,
+#include "effect_symbol_table_intrinsics.inl"
+	};
+
+	reshadefx::constant res = {};
+
+	switch (intrinsic)
+	{
+#define IMPLEMENT_INTRINSIC_CONSTANT(name, i, code) case name##i: code break;
+#include "effect_symbol_table_intrinsics.inl"
+	default:
+		return false; // Intrinsics that depend on runtime state (e.g. derivatives across pixels or texture lookups) have no constant implementation
+	}
+
+	reset_to_rvalue_constant(loc, std::move(res), res_type);
+
+	return true;
+}
@@ -203,5 +203,14 @@ namespace reshadefx
 		/// <param name="op">The binary operator to apply.</param>
 		/// <param name="rhs">The constant to use as right-hand side of the binary operation.</param>
 		bool evaluate_constant_expression(reshadefx::tokenid op, const reshadefx::constant &rhs);
+		/// <summary>
+		/// Evaluate an intrinsic function call with constant arguments and initialize the expression to the constant result.
+		/// </summary>
+		/// <param name="loc">The code location of the call expression.</param>
+		/// <param name="intrinsic">The ID of the intrinsic function overload to evaluate.</param>
+		/// <param name="res_type">The return type of the intrinsic function.</param>
+		/// <param name="args">The argument expressions, already cast to the parameter types.</param>
+		/// <returns><c>true</c> if the call was folded into a constant, <c>false</c> if it has to be evaluated at runtime.</returns>
+		bool evaluate_constant_intrinsic(const reshadefx::location &loc, uint32_t intrinsic, const reshadefx::type &res_type, const std::vector<expression> &args);
 	};
 }
@@ -4,6 +4,10 @@
  */
 
 #include "effect_lexer.hpp"
+#include "effect_string_pool.hpp"
+#include <cstring> // memchr
+#include <algorithm> // std::max
+#include <string_view>
 #include <unordered_map> // Used for static lookup tables
 
 using namespace reshadefx;
@@ -32,6 +36,68 @@ static const unsigned type_lookup[256] = {
 	IDENT, IDENT, IDENT,   '{',   '|',   '}',   '~',  0x00,  0x00,  0x00,
 };
 
+// Lookup table which marks all characters that can continue an identifier
+static const bool ident_char_lookup[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+};
+
+/// <summary>
+/// A fixed-size open addressing hash table that maps keywords to tokens.
+/// This is looked up with a view into the input string, so identifiers do not need to be copied into a temporary key first.
+/// </summary>
+template <size_t SIZE>
+class keyword_table
+{
+	static_assert((SIZE & (SIZE - 1)) == 0, "size has to be a power of two");
+
+public:
+	keyword_table(std::initializer_list<std::pair<std::string_view, tokenid>> keywords)
+	{
+		for (const auto &keyword : keywords)
+		{
+			size_t index = hash(keyword.first) & (SIZE - 1);
+			while (!_entries[index].first.empty())
+				index = (index + 1) & (SIZE - 1);
+
+			_entries[index] = keyword;
+			_max_length = std::max(_max_length, keyword.first.size());
+		}
+	}
+
+	bool find(std::string_view name, tokenid &id) const
+	{
+		if (name.size() > _max_length)
+			return false;
+
+		for (size_t index = hash(name) & (SIZE - 1); !_entries[index].first.empty(); index = (index + 1) & (SIZE - 1))
+		{
+			if (_entries[index].first == name)
+			{
+				id = _entries[index].second;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+private:
+	static size_t hash(std::string_view name)
+	{
+		// FNV-1a, which distributes the short keyword strings well enough to keep probe sequences at one or two entries
+		uint32_t hash = 2166136261u;
+		for (const char c : name)
+			hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+		return hash;
+	}
+
+	size_t _max_length = 0;
+	std::pair<std::string_view, tokenid> _entries[SIZE] = {};
+};
+
 // Lookup tables which translate a given string literal to a token and backwards
 static const std::unordered_map<tokenid, std::string> token_lookup = {
 	{ tokenid::end_of_file, "end of file" },
@@ -159,7 +225,7 @@ static const std::unordered_map<tokenid, std::string> token_lookup = {
 	{ tokenid::texture, "texture" },
 	{ tokenid::sampler, "sampler" },
 };
-static const std::unordered_map<std::string, tokenid> keyword_lookup = {
+static const keyword_table<512> keyword_lookup = {
 	{ "asm", tokenid::reserved },
 	{ "asm_fragment", tokenid::reserved },
 	{ "auto", tokenid::reserved },
@@ -322,7 +388,7 @@ static const std::unordered_map<std::string, tokenid> keyword_lookup = {
 	{ "volatile", tokenid::volatile_ },
 	{ "while", tokenid::while_ }
 };
-static const std::unordered_map<std::string, tokenid> pp_directive_lookup = {
+static const keyword_table<32> pp_directive_lookup = {
 	{ "define", tokenid::hash_def },
 	{ "undef", tokenid::hash_undef },
 	{ "if", tokenid::hash_if },
@@ -401,10 +467,11 @@ reshadefx::token reshadefx::lexer::lex()
 next_token:
 	// Reset token data
 	tok.location = _cur_location;
-	tok.offset = _cur - _input.data();
+	tok.offset = _cur - _input->data();
 	tok.length = 1;
 	tok.literal_as_double = 0;
 	tok.literal_as_string.clear();
+	tok.literal_as_handle = 0;
 
 	// Do a character type lookup for the current character
 	switch (type_lookup[static_cast<uint8_t>(*_cur)])
@@ -417,7 +484,7 @@ next_token:
 		if (_ignore_whitespace || is_at_line_begin || *_cur == '\n')
 			goto next_token;
 		tok.id = tokenid::space;
-		tok.length = _cur - _input.data() - tok.offset;
+		tok.length = _cur - _input->data() - tok.offset;
 		return tok;
 	case '\n':
 		_cur++;
@@ -516,7 +583,7 @@ next_token:
 			tok.id = tokenid::minus;
 		break;
 	case '.':
-		if (type_lookup[_cur[1]] == DIGIT)
+		if (type_lookup[static_cast<uint8_t>(_cur[1])] == DIGIT)
 			parse_numeric_literal(tok);
 		else if (_cur[1] == '.' && _cur[2] == '.')
 			tok.id = tokenid::ellipsis,
@@ -531,29 +598,28 @@ next_token:
 			if (_ignore_comments)
 				goto next_token;
 			tok.id = tokenid::single_line_comment;
-			tok.length = _cur - _input.data() - tok.offset;
+			tok.length = _cur - _input->data() - tok.offset;
 			return tok;
 		}
 		else if (_cur[1] == '*')
 		{
-			while (_cur < _end)
+			// Search for the end of the comment first and only then go through the skipped characters to update the location
+			const std::string_view remaining(_cur + 1, _end - _cur - 1);
+			const size_t comment_end = remaining.find("*/");
+			const char *const end = comment_end != std::string_view::npos ? _cur + 1 + comment_end + 2 : _end;
+
+			for (const char *line_begin = _cur; (line_begin = static_cast<const char *>(std::memchr(line_begin, '\n', end - line_begin))) != nullptr;)
 			{
-				if (*_cur == '\n')
-				{
-					_cur_location.line++;
-					_cur_location.column = 1;
-				}
-				else if (_cur[0] == '*' && _cur[1] == '/')
-				{
-					skip(2);
-					break;
-				}
-				skip(1);
+				_cur_location.line++;
+				_cur_location.column = 1;
+				_cur = ++line_begin;
 			}
+
+			skip(end - _cur);
 			if (_ignore_comments)
 				goto next_token;
 			tok.id = tokenid::multi_line_comment;
-			tok.length = _cur - _input.data() - tok.offset;
+			tok.length = _cur - _input->data() - tok.offset;
 			return tok;
 		}
 		else if (_cur[1] == '=')
@@ -665,15 +731,17 @@ void reshadefx::lexer::skip(size_t length)
 }
 void reshadefx::lexer::skip_space()
 {
-	// Skip each character until a space is found
-	while (type_lookup[*_cur] == SPACE && _cur < _end)
-		skip(1);
+	// Skip each character until something other than a space is found
+	auto *end = _cur;
+	while (type_lookup[static_cast<uint8_t>(*end)] == SPACE && end < _end)
+		end++;
+	skip(end - _cur);
 }
 void reshadefx::lexer::skip_to_next_line()
 {
-	// Skip each character until a new line feed is found
-	while (*_cur != '\n' && _cur < _end)
-		skip(1);
+	// Skip each character until a new line feed is found (using 'memchr', since it is vectorized by the runtime library)
+	const auto end = static_cast<const char *>(std::memchr(_cur, '\n', _end - _cur));
+	skip((end != nullptr ? end : _end) - _cur);
 }
 
 void reshadefx::lexer::parse_identifier(token &tok) const
@@ -681,19 +749,18 @@ void reshadefx::lexer::parse_identifier(token &tok) const
 	auto *const begin = _cur, *end = begin;
 
 	// Skip to the end of the identifier sequence
-	do end++; while (type_lookup[*end] == IDENT || type_lookup[*end] == DIGIT);
+	do end++; while (ident_char_lookup[static_cast<uint8_t>(*end)]);
 
 	tok.id = tokenid::identifier;
-	tok.offset = begin - _input.data();
+	tok.offset = begin - _input->data();
 	tok.length = end - begin;
 	tok.literal_as_string.assign(begin, end);
 
-	if (_ignore_keywords)
+	if (!_ignore_keywords && keyword_lookup.find(std::string_view(begin, end - begin), tok.id))
 		return;
 
-	const auto it = keyword_lookup.find(tok.literal_as_string);
-	if (it != keyword_lookup.end())
-		tok.id = it->second;
+	if (_string_pool != nullptr)
+		tok.literal_as_handle = _string_pool->intern(std::string_view(begin, end - begin));
 }
 bool reshadefx::lexer::parse_pp_directive(token &tok)
 {
@@ -701,12 +768,8 @@ bool reshadefx::lexer::parse_pp_directive(token &tok)
 	skip_space(); // Skip any space between the '#' and directive
 	parse_identifier(tok);
 
-	const auto it = pp_directive_lookup.find(tok.literal_as_string);
-	if (it != pp_directive_lookup.end())
-	{
-		tok.id = it->second;
+	if (pp_directive_lookup.find(tok.literal_as_string, tok.id))
 		return true;
-	}
 	else if (!_ignore_line_directives && tok.literal_as_string == "line") // The #line directive needs special handling
 	{
 		skip(tok.length); // The 'parse_identifier' does not update the pointer to the current character, so do that now
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "effect_token.hpp"
+#include <memory> // std::shared_ptr
 
 namespace reshadefx
 {
@@ -23,6 +24,17 @@ namespace reshadefx
 			bool ignore_line_directives = false,
 			bool ignore_keywords = false,
 			bool escape_string_literals = true) :
+			lexer(std::make_shared<const std::string>(std::move(input)), ignore_comments, ignore_whitespace, ignore_pp_directives, ignore_line_directives, ignore_keywords, escape_string_literals)
+		{
+		}
+		explicit lexer(
+			std::shared_ptr<const std::string> input,
+			bool ignore_comments = true,
+			bool ignore_whitespace = true,
+			bool ignore_pp_directives = true,
+			bool ignore_line_directives = false,
+			bool ignore_keywords = false,
+			bool escape_string_literals = true) :
 			_input(std::move(input)),
 			_ignore_comments(ignore_comments),
 			_ignore_whitespace(ignore_whitespace),
@@ -31,32 +43,25 @@ namespace reshadefx
 			_ignore_keywords(ignore_keywords),
 			_escape_string_literals(escape_string_literals)
 		{
-			_cur = _input.data();
-			_end = _cur + _input.size();
+			_cur = _input->data();
+			_end = _cur + _input->size();
 		}
 
-		lexer(const lexer &lexer) { operator=(lexer); }
-		lexer &operator=(const lexer &lexer)
-		{
-			_input = lexer._input;
-			_cur_location = lexer._cur_location;
-			_cur = _input.data() + (lexer._cur - lexer._input.data());
-			_end = _input.data() + _input.size();
-			_ignore_comments = lexer._ignore_comments;
-			_ignore_whitespace = lexer._ignore_whitespace;
-			_ignore_pp_directives = lexer._ignore_pp_directives;
-			_ignore_keywords = lexer._ignore_keywords;
-			_escape_string_literals = lexer._escape_string_literals;
-			_ignore_line_directives = lexer._ignore_line_directives;
-
-			return *this;
-		}
+		// The input string is immutable and shared between copies, so copying a lexer only copies its current position (which makes backtracking cheap)
+		lexer(const lexer &lexer) = default;
+		lexer &operator=(const lexer &lexer) = default;
 
 		/// <summary>
 		/// Get the input string this lexical analyzer works on.
 		/// </summary>
 		/// <returns>A constant reference to the input string.</returns>
-		const std::string &input_string() const { return _input; }
+		const std::string &input_string() const { return *_input; }
+
+		/// <summary>
+		/// Add the names of all identifier tokens to the specified string pool and store their handle in the token.
+		/// </summary>
+		/// <param name="pool">The string pool to add names to, or <c>nullptr</c> to disable this.</param>
+		void set_string_pool(class string_pool *pool) { _string_pool = pool; }
 
 		/// <summary>
 		/// Perform lexical analysis on the input string and return the next token in sequence.
@@ -85,7 +90,7 @@ namespace reshadefx
 		void parse_string_literal(token &tok, bool escape) const;
 		void parse_numeric_literal(token &tok) const;
 
-		std::string _input;
+		std::shared_ptr<const std::string> _input;
 		location _cur_location;
 		const std::string::value_type *_cur, *_end;
 		bool _ignore_comments;
@@ -94,5 +99,6 @@ namespace reshadefx
 		bool _ignore_line_directives;
 		bool _ignore_keywords;
 		bool _escape_string_literals;
+		class string_pool *_string_pool = nullptr;
 	};
 }
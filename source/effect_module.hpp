@@ -201,6 +201,8 @@ namespace reshadefx
 		std::string name;
 		std::vector<pass_info> passes;
 		std::vector<annotation> annotations;
+		// Unique names of all textures sampled from or rendered to by any pass, which are the only ones that have to exist to render this technique
+		std::vector<std::string> texture_names;
 	};
 
 	/// <summary>
@@ -218,6 +220,8 @@ namespace reshadefx
 		std::vector<technique_info> techniques;
 
 		uint32_t total_uniform_size = 0;
+		// Size of the range at the start of the uniform buffer holding all uniforms with a "source" annotation, which are updated every frame (zero unless the layout was optimized)
+		uint32_t per_frame_uniform_size = 0;
 		uint32_t num_sampler_bindings = 0;
 		uint32_t num_texture_bindings = 0;
 	};
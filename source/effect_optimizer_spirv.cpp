@@ -0,0 +1,1030 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_codegen.hpp"
+#include <map>
+#include <cmath> // std::isnan
+#include <limits>
+#include <cstring> // std::memcpy
+#include <algorithm> // std::all_of, std::find_if, std::sort
+#include <unordered_map>
+#include <unordered_set>
+
+// Use the C++ variant of the SPIR-V headers
+#include <spirv.hpp>
+
+/// <summary>
+/// A single instruction in a SPIR-V module, with the result type and result ID split off from the other operands.
+/// </summary>
+struct spirv_opt_instruction
+{
+	spv::Op op;
+	spv::Id type;
+	spv::Id result;
+	std::vector<uint32_t> operands;
+};
+
+/// <summary>
+/// Get whether instructions with the specified opcode have a result type and result ID.
+/// </summary>
+/// <returns><c>false</c> if this is an opcode the optimizer does not know about, <c>true</c> otherwise.</returns>
+static bool get_instruction_layout(spv::Op op, bool &has_type, bool &has_result)
+{
+	has_type = false;
+	has_result = false;
+
+	switch (op)
+	{
+	case spv::OpNop:
+	case spv::OpCapability:
+	case spv::OpExtension:
+	case spv::OpMemoryModel:
+	case spv::OpEntryPoint:
+	case spv::OpExecutionMode:
+	case spv::OpSource:
+	case spv::OpName:
+	case spv::OpMemberName:
+	case spv::OpLine:
+	case spv::OpDecorate:
+	case spv::OpMemberDecorate:
+	case spv::OpDecorateStringGOOGLE:
+	case spv::OpMemberDecorateStringGOOGLE:
+	case spv::OpStore:
+	case spv::OpFunctionEnd:
+	case spv::OpSelectionMerge:
+	case spv::OpLoopMerge:
+	case spv::OpBranch:
+	case spv::OpBranchConditional:
+	case spv::OpSwitch:
+	case spv::OpKill:
+	case spv::OpReturn:
+	case spv::OpReturnValue:
+		return true;
+	case spv::OpString:
+	case spv::OpExtInstImport:
+	case spv::OpTypeVoid:
+	case spv::OpTypeBool:
+	case spv::OpTypeInt:
+	case spv::OpTypeFloat:
+	case spv::OpTypeVector:
+	case spv::OpTypeMatrix:
+	case spv::OpTypeImage:
+	case spv::OpTypeSampledImage:
+	case spv::OpTypeArray:
+	case spv::OpTypeStruct:
+	case spv::OpTypePointer:
+	case spv::OpTypeFunction:
+	case spv::OpLabel:
+		has_result = true;
+		return true;
+	case spv::OpUndef:
+	case spv::OpExtInst:
+	case spv::OpConstantTrue:
+	case spv::OpConstantFalse:
+	case spv::OpConstant:
+	case spv::OpConstantComposite:
+	case spv::OpConstantNull:
+	case spv::OpSpecConstantTrue:
+	case spv::OpSpecConstantFalse:
+	case spv::OpSpecConstant:
+	case spv::OpSpecConstantComposite:
+	case spv::OpFunction:
+	case spv::OpFunctionParameter:
+	case spv::OpFunctionCall:
+	case spv::OpVariable:
+	case spv::OpLoad:
+	case spv::OpAccessChain:
+	case spv::OpVectorExtractDynamic:
+	case spv::OpVectorShuffle:
+	case spv::OpCompositeConstruct:
+	case spv::OpCompositeExtract:
+	case spv::OpCompositeInsert:
+	case spv::OpTranspose:
+	case spv::OpImageSampleImplicitLod:
+	case spv::OpImageSampleExplicitLod:
+	case spv::OpImageFetch:
+	case spv::OpImageGather:
+	case spv::OpImage:
+	case spv::OpImageQuerySizeLod:
+	case spv::OpImageQuerySize:
+	case spv::OpConvertFToU:
+	case spv::OpConvertFToS:
+	case spv::OpConvertSToF:
+	case spv::OpConvertUToF:
+	case spv::OpBitcast:
+	case spv::OpSNegate:
+	case spv::OpFNegate:
+	case spv::OpIAdd:
+	case spv::OpFAdd:
+	case spv::OpISub:
+	case spv::OpFSub:
+	case spv::OpIMul:
+	case spv::OpFMul:
+	case spv::OpUDiv:
+	case spv::OpSDiv:
+	case spv::OpFDiv:
+	case spv::OpUMod:
+	case spv::OpSRem:
+	case spv::OpFRem:
+	case spv::OpVectorTimesScalar:
+	case spv::OpMatrixTimesScalar:
+	case spv::OpVectorTimesMatrix:
+	case spv::OpMatrixTimesVector:
+	case spv::OpMatrixTimesMatrix:
+	case spv::OpDot:
+	case spv::OpAny:
+	case spv::OpAll:
+	case spv::OpIsNan:
+	case spv::OpIsInf:
+	case spv::OpLogicalEqual:
+	case spv::OpLogicalNotEqual:
+	case spv::OpLogicalOr:
+	case spv::OpLogicalAnd:
+	case spv::OpLogicalNot:
+	case spv::OpSelect:
+	case spv::OpIEqual:
+	case spv::OpINotEqual:
+	case spv::OpUGreaterThan:
+	case spv::OpSGreaterThan:
+	case spv::OpUGreaterThanEqual:
+	case spv::OpSGreaterThanEqual:
+	case spv::OpULessThan:
+	case spv::OpSLessThan:
+	case spv::OpULessThanEqual:
+	case spv::OpSLessThanEqual:
+	case spv::OpFOrdEqual:
+	case spv::OpFOrdNotEqual:
+	case spv::OpFOrdLessThan:
+	case spv::OpFOrdGreaterThan:
+	case spv::OpFOrdLessThanEqual:
+	case spv::OpFOrdGreaterThanEqual:
+	case spv::OpShiftRightLogical:
+	case spv::OpShiftRightArithmetic:
+	case spv::OpShiftLeftLogical:
+	case spv::OpBitwiseOr:
+	case spv::OpBitwiseXor:
+	case spv::OpBitwiseAnd:
+	case spv::OpNot:
+	case spv::OpDPdx:
+	case spv::OpDPdy:
+	case spv::OpFwidth:
+	case spv::OpPhi:
+		has_type = true;
+		has_result = true;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/// <summary>
+/// Get whether an instruction only computes its result and has no other side effects, so that it can be removed when that result is not used.
+/// </summary>
+static bool is_pure(spv::Op op)
+{
+	switch (op)
+	{
+	case spv::OpUndef:
+	case spv::OpExtInst:
+	case spv::OpLoad:
+	case spv::OpAccessChain:
+	case spv::OpVectorExtractDynamic:
+	case spv::OpVectorShuffle:
+	case spv::OpCompositeConstruct:
+	case spv::OpCompositeExtract:
+	case spv::OpCompositeInsert:
+	case spv::OpTranspose:
+	case spv::OpImageSampleImplicitLod:
+	case spv::OpImageSampleExplicitLod:
+	case spv::OpImageFetch:
+	case spv::OpImageGather:
+	case spv::OpImage:
+	case spv::OpImageQuerySizeLod:
+	case spv::OpImageQuerySize:
+	case spv::OpPhi:
+		return true;
+	case spv::OpFunctionCall:
+	case spv::OpVariable:
+	case spv::OpFunction:
+	case spv::OpFunctionParameter:
+		return false;
+	default:
+		// All arithmetic, conversion, logical and relational instructions are pure
+		bool has_type, has_result;
+		return get_instruction_layout(op, has_type, has_result) && has_type;
+	}
+}
+
+/// <summary>
+/// Get whether this is a debug or annotation instruction, which only refers to its target ID, but does not count as a use of it.
+/// </summary>
+static bool is_debug_or_annotation(spv::Op op)
+{
+	switch (op)
+	{
+	case spv::OpName:
+	case spv::OpMemberName:
+	case spv::OpDecorate:
+	case spv::OpMemberDecorate:
+	case spv::OpDecorateStringGOOGLE:
+	case spv::OpMemberDecorateStringGOOGLE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/// <summary>
+/// Call the specified function on every ID operand of an instruction (including the result type, but not the result ID).
+/// </summary>
+template <typename F>
+static void for_each_id(spirv_opt_instruction &inst, F func)
+{
+	std::vector<uint32_t> &ops = inst.operands;
+
+	if (inst.type != 0)
+		func(inst.type);
+
+	const auto ids_from = [&ops, &func](size_t first) {
+		for (size_t i = first; i < ops.size(); ++i)
+			func(ops[i]);
+	};
+
+	switch (inst.op)
+	{
+	case spv::OpNop:
+	case spv::OpCapability:
+	case spv::OpExtension:
+	case spv::OpMemoryModel:
+	case spv::OpSource:
+	case spv::OpString:
+	case spv::OpExtInstImport:
+	case spv::OpTypeVoid:
+	case spv::OpTypeBool:
+	case spv::OpTypeInt:
+	case spv::OpTypeFloat:
+	case spv::OpConstantTrue:
+	case spv::OpConstantFalse:
+	case spv::OpConstant:
+	case spv::OpConstantNull:
+	case spv::OpSpecConstantTrue:
+	case spv::OpSpecConstantFalse:
+	case spv::OpSpecConstant:
+	case spv::OpUndef:
+	case spv::OpFunctionParameter:
+	case spv::OpFunctionEnd:
+	case spv::OpLabel:
+	case spv::OpKill:
+	case spv::OpReturn:
+		break;
+	case spv::OpEntryPoint:
+	{
+		// Execution model, entry point function, literal name string and then the interface variables
+		func(ops[1]);
+		size_t i = 2;
+		while (i < ops.size() && (ops[i] & 0xFF000000) != 0)
+			++i;
+		ids_from(i + 1);
+		break;
+	}
+	case spv::OpExecutionMode:
+	case spv::OpName:
+	case spv::OpMemberName:
+	case spv::OpDecorate:
+	case spv::OpMemberDecorate:
+	case spv::OpDecorateStringGOOGLE:
+	case spv::OpMemberDecorateStringGOOGLE:
+	case spv::OpLine:
+	case spv::OpTypeVector:
+	case spv::OpTypeMatrix:
+	case spv::OpTypeImage:
+	case spv::OpCompositeExtract:
+	case spv::OpSelectionMerge:
+	case spv::OpLoad:
+		func(ops[0]);
+		break;
+	case spv::OpTypePointer:
+	case spv::OpFunction:
+		func(ops[1]);
+		break;
+	case spv::OpVariable:
+		ids_from(1); // Storage class followed by the optional initializer
+		break;
+	case spv::OpExtInst:
+		func(ops[0]);
+		ids_from(2);
+		break;
+	case spv::OpCompositeInsert:
+	case spv::OpVectorShuffle:
+	case spv::OpLoopMerge:
+	case spv::OpStore:
+		func(ops[0]);
+		func(ops[1]);
+		break;
+	case spv::OpBranchConditional:
+		func(ops[0]);
+		func(ops[1]);
+		func(ops[2]);
+		break;
+	case spv::OpSwitch:
+		// Selector and default label, followed by pairs of literal value and target label
+		func(ops[0]);
+		func(ops[1]);
+		for (size_t i = 3; i < ops.size(); i += 2)
+			func(ops[i]);
+		break;
+	case spv::OpImageSampleImplicitLod:
+	case spv::OpImageSampleExplicitLod:
+	case spv::OpImageFetch:
+		// Image and coordinate, followed by the optional image operands mask and its arguments
+		func(ops[0]);
+		func(ops[1]);
+		ids_from(3);
+		break;
+	case spv::OpImageGather:
+		func(ops[0]);
+		func(ops[1]);
+		func(ops[2]);
+		ids_from(4);
+		break;
+	default:
+		ids_from(0);
+		break;
+	}
+}
+
+/// <summary>
+/// Optimization passes working on a parsed SPIR-V module.
+/// </summary>
+class spirv_optimizer
+{
+public:
+	bool parse(const std::vector<uint32_t> &spirv)
+	{
+		if (spirv.size() < 5 || spirv[0] != spv::MagicNumber)
+			return false;
+
+		_header.assign(spirv.begin(), spirv.begin() + 5);
+		_bound = spirv[3];
+
+		for (size_t i = 5; i < spirv.size();)
+		{
+			const uint32_t num_words = spirv[i] >> spv::WordCountShift;
+			if (num_words == 0 || i + num_words > spirv.size())
+				return false;
+
+			spirv_opt_instruction &inst = _insts.emplace_back();
+			inst.op = static_cast<spv::Op>(spirv[i] & spv::OpCodeMask);
+			inst.type = 0;
+			inst.result = 0;
+
+			bool has_type, has_result;
+			if (!get_instruction_layout(inst.op, has_type, has_result))
+				return false; // Cannot optimize modules with unknown instructions, since it is not known which operands are IDs
+
+			size_t k = i + 1;
+			if (has_type && k < i + num_words)
+				inst.type = spirv[k++];
+			if (has_result && k < i + num_words)
+				inst.result = spirv[k++];
+			inst.operands.assign(spirv.begin() + k, spirv.begin() + i + num_words);
+
+			i += num_words;
+		}
+
+		return true;
+	}
+
+	void write(std::vector<uint32_t> &spirv) const
+	{
+		spirv = _header;
+		spirv[3] = _bound;
+
+		for (const spirv_opt_instruction &inst : _insts)
+		{
+			if (inst.op == spv::OpNop)
+				continue; // Skip removed instructions
+
+			const uint32_t num_words = 1 + (inst.type != 0) + (inst.result != 0) + static_cast<uint32_t>(inst.operands.size());
+			spirv.push_back((num_words << spv::WordCountShift) | inst.op);
+			if (inst.type != 0)
+				spirv.push_back(inst.type);
+			if (inst.result != 0)
+				spirv.push_back(inst.result);
+			spirv.insert(spirv.end(), inst.operands.begin(), inst.operands.end());
+		}
+	}
+
+	void run()
+	{
+		remove_dead_functions();
+		promote_local_variables();
+		fold_constants();
+		deduplicate_types_and_constants();
+		remove_dead_code();
+		apply_replacements();
+		remove_dangling_debug_info();
+	}
+
+private:
+	struct scalar_type
+	{
+		enum { t_bool, t_int, t_uint, t_float } kind;
+		uint32_t width;
+	};
+
+	static void remove(spirv_opt_instruction &inst)
+	{
+		inst.op = spv::OpNop;
+		inst.type = 0;
+		inst.result = 0;
+		inst.operands.clear();
+	}
+
+	/// <summary>
+	/// Find the ID an ID was replaced with, following chains of replacements.
+	/// </summary>
+	spv::Id resolve(spv::Id id) const
+	{
+		for (auto it = _replacements.find(id); it != _replacements.end(); it = _replacements.find(id))
+			id = it->second;
+		return id;
+	}
+	void resolve_operands(spirv_opt_instruction &inst)
+	{
+		if (is_debug_or_annotation(inst.op))
+			return; // Do not move names or decorations of replaced IDs to the ID that replaced them
+		for_each_id(inst, [this](uint32_t &id) { id = resolve(id); });
+	}
+	void apply_replacements()
+	{
+		for (spirv_opt_instruction &inst : _insts)
+			resolve_operands(inst);
+	}
+
+	size_t first_function_index() const
+	{
+		for (size_t i = 0; i < _insts.size(); ++i)
+			if (_insts[i].op == spv::OpFunction)
+				return i;
+		return _insts.size();
+	}
+
+	/// <summary>
+	/// Remove all functions that are not reachable from any entry point.
+	/// </summary>
+	void remove_dead_functions()
+	{
+		std::unordered_map<spv::Id, std::pair<size_t, size_t>> function_ranges;
+		for (size_t i = 0, begin = 0; i < _insts.size(); ++i)
+		{
+			if (_insts[i].op == spv::OpFunction)
+				begin = i;
+			else if (_insts[i].op == spv::OpFunctionEnd)
+				function_ranges[_insts[begin].result] = { begin, i };
+		}
+
+		std::vector<spv::Id> worklist;
+		std::unordered_set<spv::Id> reachable;
+		for (const spirv_opt_instruction &inst : _insts)
+			if (inst.op == spv::OpEntryPoint && reachable.insert(inst.operands[1]).second)
+				worklist.push_back(inst.operands[1]);
+
+		while (!worklist.empty())
+		{
+			const auto range = function_ranges.find(worklist.back());
+			worklist.pop_back();
+			if (range == function_ranges.end())
+				continue;
+
+			for (size_t i = range->second.first; i <= range->second.second; ++i)
+				if (_insts[i].op == spv::OpFunctionCall && reachable.insert(_insts[i].operands[0]).second)
+					worklist.push_back(_insts[i].operands[0]);
+		}
+
+		for (const auto &function : function_ranges)
+			if (reachable.find(function.first) == reachable.end())
+				for (size_t i = function.second.first; i <= function.second.second; ++i)
+					remove(_insts[i]);
+	}
+
+	/// <summary>
+	/// Replace loads from function-local variables with the value that was last stored to them where that value is known (a simple form of mem2reg).
+	/// Only variables whose address is used by nothing but direct loads and stores are considered, so that no other instruction can modify them in between.
+	/// </summary>
+	void promote_local_variables()
+	{
+		struct variable_info
+		{
+			size_t index;
+			bool escaped = false;
+			std::vector<size_t> loads;
+			std::vector<size_t> stores;
+		};
+
+		// Block number of each instruction in its function, so that loads can be matched with stores in the same block
+		std::vector<size_t> blocks(_insts.size());
+
+		for (size_t function_begin = 0; function_begin < _insts.size(); ++function_begin)
+		{
+			if (_insts[function_begin].op != spv::OpFunction)
+				continue;
+
+			std::unordered_map<spv::Id, variable_info> variables;
+			size_t function_end = function_begin, block = 0;
+			for (; function_end < _insts.size() && _insts[function_end].op != spv::OpFunctionEnd; ++function_end)
+			{
+				spirv_opt_instruction &inst = _insts[function_end];
+
+				if (inst.op == spv::OpLabel)
+					++block;
+				blocks[function_end] = block;
+
+				if (inst.op == spv::OpVariable && inst.operands[0] == spv::StorageClassFunction)
+				{
+					variables[inst.result].index = function_end;
+
+					// Variables with an initializer are not touched, they are stored to explicitly by the code generator
+					if (inst.operands.size() > 1)
+						variables[inst.result].escaped = true;
+					continue;
+				}
+
+				if (inst.op == spv::OpLoad)
+				{
+					if (const auto it = variables.find(inst.operands[0]); it != variables.end())
+					{
+						it->second.loads.push_back(function_end);
+						continue;
+					}
+				}
+				if (inst.op == spv::OpStore)
+				{
+					if (const auto it = variables.find(inst.operands[1]); it != variables.end())
+						it->second.escaped = true; // Storing the pointer itself somewhere
+					if (const auto it = variables.find(inst.operands[0]); it != variables.end())
+					{
+						it->second.stores.push_back(function_end);
+						continue;
+					}
+				}
+
+				// Any other use (access chains, function call arguments, ...) means the variable may be accessed in ways not tracked here
+				for_each_id(inst, [&variables](uint32_t &id) {
+					if (const auto it = variables.find(id); it != variables.end())
+						it->second.escaped = true;
+				});
+			}
+
+			for (auto &pair : variables)
+			{
+				variable_info &var = pair.second;
+				if (var.escaped)
+					continue;
+
+				// A single store in the entry block dominates all blocks, so every load that comes after it can use the stored value directly
+				// The entry block is block one, since it starts at the first label in the function
+				if (var.stores.size() == 1 && blocks[var.stores[0]] == 1 &&
+					std::find_if(var.loads.begin(), var.loads.end(), [&](size_t load) { return load < var.stores[0]; }) == var.loads.end())
+				{
+					const spv::Id value = _insts[var.stores[0]].operands[1];
+					for (const size_t load : var.loads)
+					{
+						_replacements[_insts[load].result] = value;
+						remove(_insts[load]);
+					}
+					var.loads.clear();
+				}
+				else
+				{
+					// Otherwise forward stores to loads in the same block and remove stores that are overwritten before being loaded
+					std::vector<size_t> accesses = var.loads;
+					accesses.insert(accesses.end(), var.stores.begin(), var.stores.end());
+					std::sort(accesses.begin(), accesses.end());
+
+					size_t last_store = std::numeric_limits<size_t>::max();
+					bool last_store_loaded = false;
+					std::vector<size_t> remaining_loads;
+
+					for (const size_t access : accesses)
+					{
+						const bool same_block = last_store != std::numeric_limits<size_t>::max() && blocks[last_store] == blocks[access];
+
+						if (_insts[access].op == spv::OpStore)
+						{
+							if (same_block && !last_store_loaded)
+								remove(_insts[last_store]);
+
+							last_store = access;
+							last_store_loaded = false;
+						}
+						else if (same_block)
+						{
+							_replacements[_insts[access].result] = _insts[last_store].operands[1];
+							remove(_insts[access]);
+						}
+						else
+						{
+							last_store_loaded = true;
+							remaining_loads.push_back(access);
+						}
+					}
+
+					var.loads = std::move(remaining_loads);
+				}
+
+				// Variables that are never loaded from are not needed at all
+				if (var.loads.empty())
+				{
+					for (const size_t store : var.stores)
+						remove(_insts[store]);
+					remove(_insts[var.index]);
+				}
+			}
+
+			function_begin = function_end;
+		}
+	}
+
+	/// <summary>
+	/// Evaluate instructions whose operands are all constants at compile-time and replace them with the resulting constant.
+	/// </summary>
+	void fold_constants()
+	{
+		std::unordered_map<spv::Id, scalar_type> scalar_types;
+		std::unordered_map<spv::Id, uint32_t> vector_sizes;
+		std::unordered_map<spv::Id, size_t> constants;
+
+		const size_t globals_end = first_function_index();
+		for (size_t i = 0; i < globals_end; ++i)
+		{
+			const spirv_opt_instruction &inst = _insts[i];
+
+			switch (inst.op)
+			{
+			case spv::OpTypeBool:
+				scalar_types[inst.result] = { scalar_type::t_bool, 32 };
+				break;
+			case spv::OpTypeInt:
+				scalar_types[inst.result] = { inst.operands[1] ? scalar_type::t_int : scalar_type::t_uint, inst.operands[0] };
+				break;
+			case spv::OpTypeFloat:
+				scalar_types[inst.result] = { scalar_type::t_float, inst.operands[0] };
+				break;
+			case spv::OpTypeVector:
+				vector_sizes[inst.result] = inst.operands[1];
+				break;
+			case spv::OpConstant:
+			case spv::OpConstantTrue:
+			case spv::OpConstantFalse:
+			case spv::OpConstantComposite:
+				constants[inst.result] = i;
+				_constant_lookup.emplace(make_key(inst), inst.result);
+				break;
+			default:
+				break;
+			}
+		}
+
+		// Get the value of a 32-bit scalar constant
+		const auto scalar_value = [this, &constants, &scalar_types](spv::Id id, scalar_type &type, uint32_t &value) {
+			const auto it = constants.find(id);
+			if (it == constants.end())
+				return false;
+			const spirv_opt_instruction &constant = it->second < _insts.size() ? _insts[it->second] : _new_constants[it->second - _insts.size()];
+			const auto type_it = scalar_types.find(constant.type);
+			if (type_it == scalar_types.end() || type_it->second.width != 32)
+				return false;
+			type = type_it->second;
+			value = constant.op == spv::OpConstant ? constant.operands[0] : constant.op == spv::OpConstantTrue ? 1 : 0;
+			return constant.op == spv::OpConstant || constant.op == spv::OpConstantTrue || constant.op == spv::OpConstantFalse;
+		};
+		const auto add_constant = [this, &constants](spirv_opt_instruction &&inst) {
+			const auto it = _constant_lookup.find(make_key(inst));
+			if (it != _constant_lookup.end())
+				return it->second;
+			inst.result = _bound++;
+			constants[inst.result] = _insts.size() + _new_constants.size();
+			_constant_lookup.emplace(make_key(inst), inst.result);
+			return _new_constants.emplace_back(std::move(inst)).result;
+		};
+
+		for (size_t i = globals_end; i < _insts.size(); ++i)
+		{
+			spirv_opt_instruction &inst = _insts[i];
+			if (inst.op == spv::OpNop)
+				continue;
+
+			resolve_operands(inst);
+
+			if (inst.op == spv::OpCompositeExtract)
+			{
+				// Walk down the constant composite using the literal indices
+				spv::Id id = inst.operands[0];
+				for (size_t k = 1; k < inst.operands.size() && id != 0; ++k)
+				{
+					const auto it = constants.find(id);
+					const spirv_opt_instruction *composite = it == constants.end() ? nullptr :
+						it->second < _insts.size() ? &_insts[it->second] : &_new_constants[it->second - _insts.size()];
+					id = composite != nullptr && composite->op == spv::OpConstantComposite && inst.operands[k] < composite->operands.size() ? composite->operands[inst.operands[k]] : 0;
+				}
+
+				if (id != 0)
+				{
+					_replacements[inst.result] = id;
+					remove(inst);
+				}
+				continue;
+			}
+			if (inst.op == spv::OpCompositeConstruct)
+			{
+				// Constant vectors need exactly one scalar per component, whereas constructing a vector may also concatenate smaller vectors
+				if (const auto it = vector_sizes.find(inst.type); it != vector_sizes.end() && it->second != inst.operands.size())
+					continue;
+
+				if (std::all_of(inst.operands.begin(), inst.operands.end(), [&constants](spv::Id id) { return constants.find(id) != constants.end(); }))
+				{
+					spirv_opt_instruction constant { spv::OpConstantComposite, inst.type, 0, inst.operands };
+					_replacements[inst.result] = add_constant(std::move(constant));
+					remove(inst);
+				}
+				continue;
+			}
+			if (inst.op == spv::OpSelect)
+			{
+				scalar_type type; uint32_t condition;
+				if (scalar_value(inst.operands[0], type, condition) && type.kind == scalar_type::t_bool)
+				{
+					_replacements[inst.result] = inst.operands[condition ? 1 : 2];
+					remove(inst);
+				}
+				continue;
+			}
+
+			const auto result_type_it = scalar_types.find(inst.type);
+			if (result_type_it == scalar_types.end() || result_type_it->second.width != 32 || inst.operands.empty() || inst.operands.size() > 2)
+				continue;
+			const scalar_type result_type = result_type_it->second;
+
+			scalar_type a_type, b_type = {};
+			uint32_t a = 0, b = 0;
+			if (!scalar_value(inst.operands[0], a_type, a) || (inst.operands.size() == 2 && !scalar_value(inst.operands[1], b_type, b)))
+				continue;
+
+			uint32_t result = 0;
+			if (!evaluate(inst.op, a, b, a_type, result))
+				continue;
+
+			spirv_opt_instruction constant { spv::OpConstant, inst.type, 0, { result } };
+			if (result_type.kind == scalar_type::t_bool)
+				constant = { result ? spv::OpConstantTrue : spv::OpConstantFalse, inst.type, 0, {} };
+
+			_replacements[inst.result] = add_constant(std::move(constant));
+			remove(inst);
+		}
+
+		// Add new constants to the end of the global section, after all types and constants they can depend on
+		_insts.insert(_insts.begin() + globals_end, std::make_move_iterator(_new_constants.begin()), std::make_move_iterator(_new_constants.end()));
+		_new_constants.clear();
+	}
+
+	/// <summary>
+	/// Evaluate a single arithmetic, logical or conversion instruction on 32-bit scalar operands.
+	/// </summary>
+	/// <returns><c>true</c> if the result could be computed, <c>false</c> if the instruction is not supported or the result is undefined.</returns>
+	static bool evaluate(spv::Op op, uint32_t a, uint32_t b, scalar_type type, uint32_t &result)
+	{
+		float fa, fb, fresult;
+		std::memcpy(&fa, &a, sizeof(float));
+		std::memcpy(&fb, &b, sizeof(float));
+		const int32_t sa = static_cast<int32_t>(a), sb = static_cast<int32_t>(b);
+
+		switch (op)
+		{
+		case spv::OpIAdd: result = a + b; return true;
+		case spv::OpISub: result = a - b; return true;
+		case spv::OpIMul: result = a * b; return true;
+		case spv::OpUDiv: if (b == 0) return false; result = a / b; return true;
+		case spv::OpUMod: if (b == 0) return false; result = a % b; return true;
+		case spv::OpSDiv: if (sb == 0 || (sa == INT32_MIN && sb == -1)) return false; result = static_cast<uint32_t>(sa / sb); return true;
+		case spv::OpSRem: if (sb == 0 || (sa == INT32_MIN && sb == -1)) return false; result = static_cast<uint32_t>(sa % sb); return true;
+		case spv::OpSNegate: result = 0 - a; return true;
+		case spv::OpNot: result = ~a; return true;
+		case spv::OpBitwiseAnd: result = a & b; return true;
+		case spv::OpBitwiseOr: result = a | b; return true;
+		case spv::OpBitwiseXor: result = a ^ b; return true;
+		case spv::OpShiftLeftLogical: if (b >= 32) return false; result = a << b; return true;
+		case spv::OpShiftRightLogical: if (b >= 32) return false; result = a >> b; return true;
+		case spv::OpShiftRightArithmetic: if (b >= 32) return false; result = static_cast<uint32_t>(sa >> b); return true;
+		case spv::OpIEqual: result = a == b; return true;
+		case spv::OpINotEqual: result = a != b; return true;
+		case spv::OpSLessThan: result = sa < sb; return true;
+		case spv::OpSLessThanEqual: result = sa <= sb; return true;
+		case spv::OpSGreaterThan: result = sa > sb; return true;
+		case spv::OpSGreaterThanEqual: result = sa >= sb; return true;
+		case spv::OpULessThan: result = a < b; return true;
+		case spv::OpULessThanEqual: result = a <= b; return true;
+		case spv::OpUGreaterThan: result = a > b; return true;
+		case spv::OpUGreaterThanEqual: result = a >= b; return true;
+		case spv::OpLogicalAnd: result = a && b; return true;
+		case spv::OpLogicalOr: result = a || b; return true;
+		case spv::OpLogicalNot: result = !a; return true;
+		case spv::OpLogicalEqual: result = (a != 0) == (b != 0); return true;
+		case spv::OpLogicalNotEqual: result = (a != 0) != (b != 0); return true;
+		// Ordered comparisons are false if either operand is NaN, which the C++ operators already do, except for not-equal
+		case spv::OpFOrdEqual: result = fa == fb; return true;
+		case spv::OpFOrdNotEqual: result = fa < fb || fa > fb; return true;
+		case spv::OpFOrdLessThan: result = fa < fb; return true;
+		case spv::OpFOrdLessThanEqual: result = fa <= fb; return true;
+		case spv::OpFOrdGreaterThan: result = fa > fb; return true;
+		case spv::OpFOrdGreaterThanEqual: result = fa >= fb; return true;
+		case spv::OpFAdd: fresult = fa + fb; break;
+		case spv::OpFSub: fresult = fa - fb; break;
+		case spv::OpFMul: fresult = fa * fb; break;
+		case spv::OpFDiv: fresult = fa / fb; break;
+		case spv::OpFNegate: fresult = -fa; break;
+		case spv::OpConvertSToF: fresult = static_cast<float>(sa); break;
+		case spv::OpConvertUToF: fresult = static_cast<float>(a); break;
+		case spv::OpConvertFToS:
+			// Conversion of values that do not fit into the integer type is undefined
+			if (std::isnan(fa) || fa <= -2147483904.0f || fa >= 2147483648.0f) return false;
+			result = static_cast<uint32_t>(static_cast<int32_t>(fa)); return true;
+		case spv::OpConvertFToU:
+			if (std::isnan(fa) || fa <= -1.0f || fa >= 4294967296.0f) return false;
+			result = static_cast<uint32_t>(fa); return true;
+		case spv::OpBitcast: result = a; return true;
+		default:
+			return false;
+		}
+
+		// Only reached by floating-point arithmetic, so check that the operands were floating-point too
+		if (type.kind != scalar_type::t_float && op != spv::OpConvertSToF && op != spv::OpConvertUToF)
+			return false;
+
+		std::memcpy(&result, &fresult, sizeof(float));
+		return true;
+	}
+
+	static std::vector<uint32_t> make_key(const spirv_opt_instruction &inst)
+	{
+		std::vector<uint32_t> key;
+		key.reserve(2 + inst.operands.size());
+		key.push_back(inst.op);
+		key.push_back(inst.type);
+		key.insert(key.end(), inst.operands.begin(), inst.operands.end());
+		return key;
+	}
+
+	/// <summary>
+	/// Merge identical type and constant declarations, so that only one of each remains.
+	/// Declarations with decorations (like struct layouts or array strides) are left alone, since they are only identical if their decorations are too.
+	/// </summary>
+	void deduplicate_types_and_constants()
+	{
+		std::unordered_set<spv::Id> decorated;
+		for (const spirv_opt_instruction &inst : _insts)
+			if (inst.op == spv::OpDecorate || inst.op == spv::OpMemberDecorate || inst.op == spv::OpDecorateStringGOOGLE || inst.op == spv::OpMemberDecorateStringGOOGLE)
+				decorated.insert(inst.operands[0]);
+
+		std::map<std::vector<uint32_t>, spv::Id> declarations;
+
+		const size_t globals_end = first_function_index();
+		for (size_t i = 0; i < globals_end; ++i)
+		{
+			spirv_opt_instruction &inst = _insts[i];
+			resolve_operands(inst);
+
+			switch (inst.op)
+			{
+			case spv::OpTypeVoid:
+			case spv::OpTypeBool:
+			case spv::OpTypeInt:
+			case spv::OpTypeFloat:
+			case spv::OpTypeVector:
+			case spv::OpTypeMatrix:
+			case spv::OpTypeImage:
+			case spv::OpTypeSampledImage:
+			case spv::OpTypeArray:
+			case spv::OpTypePointer:
+			case spv::OpTypeFunction:
+			case spv::OpConstant:
+			case spv::OpConstantTrue:
+			case spv::OpConstantFalse:
+			case spv::OpConstantComposite:
+			case spv::OpConstantNull:
+				break;
+			default:
+				continue;
+			}
+
+			if (decorated.find(inst.result) != decorated.end())
+				continue;
+
+			if (const auto it = declarations.emplace(make_key(inst), inst.result); !it.second)
+			{
+				_replacements[inst.result] = it.first->second;
+				remove(inst);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Remove instructions and declarations whose result is never used and which have no side effects.
+	/// </summary>
+	void remove_dead_code()
+	{
+		std::unordered_map<spv::Id, size_t> use_counts;
+		for (spirv_opt_instruction &inst : _insts)
+			if (!is_debug_or_annotation(inst.op))
+				for_each_id(inst, [this, &use_counts](uint32_t &id) { use_counts[resolve(id)]++; });
+
+		// Walk backwards, so that removing an instruction makes the instructions it used dead in the same pass already
+		// Only uses across loop back edges (phi operands) can require another pass
+		for (bool changed = true; changed;)
+		{
+			changed = false;
+
+			const size_t globals_end = first_function_index();
+			for (size_t i = _insts.size(); i-- > 0;)
+			{
+				spirv_opt_instruction &inst = _insts[i];
+				if (inst.result == 0 || use_counts[inst.result] != 0)
+					continue;
+
+				bool is_dead = false;
+				switch (inst.op)
+				{
+				case spv::OpVariable:
+					// Interface variables are always referenced by the entry point, so this only affects private, uniform and function-local variables
+					is_dead = true;
+					break;
+				case spv::OpString:
+				case spv::OpTypeVoid:
+				case spv::OpTypeBool:
+				case spv::OpTypeInt:
+				case spv::OpTypeFloat:
+				case spv::OpTypeVector:
+				case spv::OpTypeMatrix:
+				case spv::OpTypeImage:
+				case spv::OpTypeSampledImage:
+				case spv::OpTypeArray:
+				case spv::OpTypeStruct:
+				case spv::OpTypePointer:
+				case spv::OpTypeFunction:
+				case spv::OpConstant:
+				case spv::OpConstantTrue:
+				case spv::OpConstantFalse:
+				case spv::OpConstantComposite:
+				case spv::OpConstantNull:
+					is_dead = i < globals_end;
+					break;
+				default:
+					is_dead = i >= globals_end && is_pure(inst.op);
+					break;
+				}
+
+				if (!is_dead)
+					continue;
+
+				for_each_id(inst, [this, &use_counts](uint32_t &id) { use_counts[resolve(id)]--; });
+				remove(inst);
+				changed = true;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Remove names and decorations of IDs that no longer exist.
+	/// </summary>
+	void remove_dangling_debug_info()
+	{
+		std::unordered_set<spv::Id> defined;
+		for (const spirv_opt_instruction &inst : _insts)
+			if (inst.result != 0)
+				defined.insert(inst.result);
+
+		for (spirv_opt_instruction &inst : _insts)
+			if (is_debug_or_annotation(inst.op) && defined.find(inst.operands[0]) == defined.end())
+				remove(inst);
+	}
+
+	uint32_t _bound = 0;
+	std::vector<uint32_t> _header;
+	std::vector<spirv_opt_instruction> _insts;
+	std::vector<spirv_opt_instruction> _new_constants;
+	std::unordered_map<spv::Id, spv::Id> _replacements;
+	std::map<std::vector<uint32_t>, spv::Id> _constant_lookup;
+};
+
+bool reshadefx::optimize_spirv(std::vector<uint32_t> &spirv)
+{
+	spirv_optimizer optimizer;
+	if (!optimizer.parse(spirv))
+		return false;
+
+	optimizer.run();
+	optimizer.write(spirv);
+	return true;
+}
@@ -0,0 +1,43 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_output_builder.hpp"
+#include <cstring> // memcpy
+#include <algorithm> // std::min
+
+void reshadefx::output_builder::write_to(std::string &output, size_t offset, size_t length) const
+{
+	// All segments except for the last one are filled completely, so the segment containing an offset can be calculated directly
+	while (length != 0)
+	{
+		const size_t segment_offset = offset % segment_size;
+		const size_t count = std::min(length, segment_size - segment_offset);
+		output.append(_segments[offset / segment_size].get() + segment_offset, count);
+
+		offset += count;
+		length -= count;
+	}
+}
+
+void reshadefx::output_builder::append(const char *data, size_t size)
+{
+	_size += size;
+
+	while (size != 0)
+	{
+		if (_segment_offset == segment_size)
+		{
+			_segments.push_back(std::make_unique<char[]>(segment_size));
+			_segment_offset = 0;
+		}
+
+		const size_t count = std::min(size, segment_size - _segment_offset);
+		std::memcpy(_segments.back().get() + _segment_offset, data, count);
+		_segment_offset += count;
+
+		data += count;
+		size -= count;
+	}
+}
@@ -0,0 +1,73 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <charconv> // std::to_chars
+
+namespace reshadefx
+{
+	/// <summary>
+	/// A text buffer that appends into a chain of fixed-size segments and only joins them together once at the end.
+	/// Unlike a single string it never has to move the text written so far when it grows, which matters for the multi-megabyte output of large effects.
+	/// </summary>
+	class output_builder
+	{
+	public:
+		output_builder() = default;
+
+		output_builder(output_builder &&) = default;
+		output_builder &operator=(output_builder &&) = default;
+
+		output_builder &operator+=(std::string_view str) { append(str.data(), str.size()); return *this; }
+		output_builder &operator+=(char c) { append(&c, 1); return *this; }
+
+		/// <summary>
+		/// Get the total number of characters written so far.
+		/// </summary>
+		size_t size() const { return _size; }
+		/// <summary>
+		/// Get the number of segments allocated so far.
+		/// </summary>
+		size_t num_segments() const { return _segments.size(); }
+
+		/// <summary>
+		/// Append the whole text to the end of a string, with a single allocation for the string.
+		/// </summary>
+		/// <param name="output">The string to append to.</param>
+		void write_to(std::string &output) const { output.reserve(output.size() + _size); write_to(output, 0, _size); }
+		/// <summary>
+		/// Append part of the text to the end of a string.
+		/// This does not reserve memory in the string, so when appending multiple parts it is best to reserve space for all of them beforehand.
+		/// </summary>
+		/// <param name="output">The string to append to.</param>
+		/// <param name="offset">The index of the first character to append.</param>
+		/// <param name="length">The number of characters to append.</param>
+		void write_to(std::string &output, size_t offset, size_t length) const;
+
+	private:
+		static constexpr size_t segment_size = 64 * 1024;
+
+		void append(const char *data, size_t size);
+
+		std::vector<std::unique_ptr<char[]>> _segments;
+		size_t _segment_offset = segment_size;
+		size_t _size = 0;
+	};
+
+	/// <summary>
+	/// Append the decimal representation of an integer to a string, without the temporary string that <c>std::to_string</c> would create.
+	/// </summary>
+	template <typename T>
+	inline void append_integer(std::string &s, T value)
+	{
+		char temp[24];
+		s.append(temp, std::to_chars(temp, temp + sizeof(temp), value).ptr);
+	}
+}
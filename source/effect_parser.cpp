@@ -9,6 +9,8 @@
 #include <cassert>
 #include <algorithm>
 #include <functional>
+#include <unordered_map>
+#include <unordered_set>
 
 struct on_scope_exit
 {
@@ -18,6 +20,49 @@ struct on_scope_exit
 	std::function<void()> leave;
 };
 
+static bool is_identity_constant(reshadefx::tokenid op, const reshadefx::expression &exp, bool is_rhs)
+{
+	using namespace reshadefx;
+
+	// Only element-wise numeric operations have an identity element
+	if (!exp.is_constant || exp.type.is_array() || !exp.type.is_numeric())
+		return false;
+
+	uint32_t identity;
+	switch (op)
+	{
+	case tokenid::plus:
+	case tokenid::pipe:
+	case tokenid::caret:
+		identity = 0;
+		break;
+	case tokenid::minus:
+	case tokenid::less_less:
+	case tokenid::greater_greater:
+		if (!is_rhs) // These are not commutative, so zero is only the identity on the right-hand side
+			return false;
+		identity = 0;
+		break;
+	case tokenid::star:
+		identity = exp.type.is_floating_point() ? 0x3f800000 /* 1.0f */ : 1;
+		break;
+	case tokenid::slash:
+		if (!is_rhs)
+			return false;
+		identity = exp.type.is_floating_point() ? 0x3f800000 : 1;
+		break;
+	default:
+		return false;
+	}
+
+	for (unsigned int i = 0; i < exp.type.components(); ++i)
+		// Compare floating-point values by value, so that negative zero is treated as zero too
+		if (exp.type.is_floating_point() ? exp.constant.as_float[i] != (identity == 0 ? 0.0f : 1.0f) : exp.constant.as_uint[i] != identity)
+			return false;
+
+	return true;
+}
+
 reshadefx::parser::parser()
 {
 }
@@ -30,6 +75,9 @@ bool reshadefx::parser::parse(std::string input, codegen *backend)
 	_lexer.reset(new lexer(std::move(input)));
 	_lexer_backup.reset();
 
+	// Let the lexer intern identifiers, so that symbols can be looked up by handle
+	_lexer->set_string_pool(&names());
+
 	// Set backend for subsequent code-generation
 	_codegen = backend;
 
@@ -43,6 +91,15 @@ bool reshadefx::parser::parse(std::string input, codegen *backend)
 			parse_success = false;
 	}
 
+	if (parse_success)
+	{
+		// Walk the references starting at the entry points and render targets of all techniques, so that the code generator can leave out everything else
+		std::unordered_set<uint32_t> referenced;
+		collect_references(_references[0], referenced);
+
+		_codegen->strip_unused(referenced);
+	}
+
 	return parse_success;
 }
 
@@ -69,8 +126,12 @@ void reshadefx::parser::warning(const location &location, unsigned int code, con
 
 void reshadefx::parser::backup()
 {
-	_lexer.swap(_lexer_backup);
-	_lexer.reset(new lexer(*_lexer_backup));
+	// Copying the lexer only copies its position, since the input string is shared
+	// Reuse the backup object if one exists already, to avoid allocating a new one for every speculative parse
+	if (_lexer_backup == nullptr)
+		_lexer_backup.reset(new lexer(*_lexer));
+	else
+		*_lexer_backup = *_lexer;
 	_token_backup = _token_next;
 }
 void reshadefx::parser::restore()
@@ -123,7 +184,7 @@ bool reshadefx::parser::accept_type_class(type &type)
 	{
 		type.base = type::t_struct;
 
-		const symbol symbol = find_symbol(_token_next.literal_as_string);
+		const symbol symbol = find_symbol(_token_next.literal_as_handle);
 
 		if (symbol.id && symbol.op == symbol_type::structure)
 		{
@@ -780,9 +841,11 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 		const bool exclusive = accept(tokenid::colon_colon);
 
 		std::string identifier;
+		uint32_t identifier_handle = 0;
 
 		if (exclusive ? expect(tokenid::identifier) : accept(tokenid::identifier))
-			identifier = std::move(_token.literal_as_string);
+			identifier = std::move(_token.literal_as_string),
+			identifier_handle = _token.literal_as_handle;
 		else
 			// No token should come through here, since all possible prefix expressions should have been handled above, so this is an error in the syntax
 			return error(_token_next.location, 3000, "syntax error: unexpected '" + token::id_to_name(_token_next.id) + '\''), false;
@@ -793,6 +856,8 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 			if (!expect(tokenid::identifier))
 				return false;
 			identifier += "::" + std::move(_token.literal_as_string);
+			// Qualified names are not interned by the lexer, so look them up as a whole
+			identifier_handle = names().find(identifier);
 		}
 
 		// Figure out which scope to start searching in
@@ -800,7 +865,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 		if (!exclusive) scope = current_scope();
 
 		// Lookup name in the symbol table
-		symbol symbol = find_symbol(identifier, scope, exclusive);
+		symbol symbol = find_symbol(identifier_handle, scope, exclusive);
 
 		// Check if this is a function call or variable reference
 		if (accept('('))
@@ -843,9 +908,9 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 
 			assert(symbol.function != nullptr);
 
-			std::vector<expression> parameters(arguments.size());
+			if (symbol.op == symbol_type::function)
+				_references[_current_function].push_back(symbol.id);
 
-			// We need to allocate some temporary variables to pass in and load results from pointer parameters
 			for (size_t i = 0; i < arguments.size(); ++i)
 			{
 				const auto &param_type = symbol.function->parameter_list[i].type;
@@ -857,35 +922,47 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 					warning(arguments[i].location, 3206, "implicit truncation of vector type");
 
 				arguments[i].add_cast_operation(param_type);
+			}
 
-				if (symbol.op == symbol_type::function || param_type.has(type::q_out))
-				{
-					// All user-defined functions actually accept pointers as arguments, same applies to intrinsics with 'out' parameters
-					const auto temp_variable = _codegen->define_variable(arguments[i].location, param_type);
-					parameters[i].reset_to_lvalue(arguments[i].location, temp_variable, param_type);
-				}
-				else
+			// Intrinsic calls with only constant arguments can be evaluated at compile time, everything else is passed on to the code generator
+			if (symbol.op != symbol_type::intrinsic || !exp.evaluate_constant_intrinsic(location, symbol.id, symbol.type, arguments))
+			{
+				std::vector<expression> parameters(arguments.size());
+
+				// We need to allocate some temporary variables to pass in and load results from pointer parameters
+				for (size_t i = 0; i < arguments.size(); ++i)
 				{
-					parameters[i].reset_to_rvalue(arguments[i].location, _codegen->emit_load(arguments[i]), param_type);
+					const auto &param_type = symbol.function->parameter_list[i].type;
+
+					if (symbol.op == symbol_type::function || param_type.has(type::q_out))
+					{
+						// All user-defined functions actually accept pointers as arguments, same applies to intrinsics with 'out' parameters
+						const auto temp_variable = _codegen->define_variable(arguments[i].location, param_type);
+						parameters[i].reset_to_lvalue(arguments[i].location, temp_variable, param_type);
+					}
+					else
+					{
+						parameters[i].reset_to_rvalue(arguments[i].location, _codegen->emit_load(arguments[i]), param_type);
+					}
 				}
-			}
 
-			// Copy in parameters from the argument access chains to parameter variables
-			for (size_t i = 0; i < arguments.size(); ++i)
-				if (parameters[i].is_lvalue && parameters[i].type.has(type::q_in)) // Only do this for pointer parameters as discovered above
-					_codegen->emit_store(parameters[i], _codegen->emit_load(arguments[i]));
+				// Copy in parameters from the argument access chains to parameter variables
+				for (size_t i = 0; i < arguments.size(); ++i)
+					if (parameters[i].is_lvalue && parameters[i].type.has(type::q_in)) // Only do this for pointer parameters as discovered above
+						_codegen->emit_store(parameters[i], _codegen->emit_load(arguments[i]));
 
-			// Check if the call resolving found an intrinsic or function and invoke the corresponding code
-			const auto result = symbol.op == symbol_type::function ?
-				_codegen->emit_call(location, symbol.id, symbol.type, parameters) :
-				_codegen->emit_call_intrinsic(location, symbol.id, symbol.type, parameters);
+				// Check if the call resolving found an intrinsic or function and invoke the corresponding code
+				const auto result = symbol.op == symbol_type::function ?
+					_codegen->emit_call(location, symbol.id, symbol.type, parameters) :
+					_codegen->emit_call_intrinsic(location, symbol.id, symbol.type, parameters);
 
-			exp.reset_to_rvalue(location, result, symbol.type);
+				exp.reset_to_rvalue(location, result, symbol.type);
 
-			// Copy out parameters from parameter variables back to the argument access chains
-			for (size_t i = 0; i < arguments.size(); ++i)
-				if (parameters[i].is_lvalue && parameters[i].type.has(type::q_out)) // Only do this for pointer parameters as discovered above
-					_codegen->emit_store(arguments[i], _codegen->emit_load(parameters[i]));
+				// Copy out parameters from parameter variables back to the argument access chains
+				for (size_t i = 0; i < arguments.size(); ++i)
+					if (parameters[i].is_lvalue && parameters[i].type.has(type::q_out)) // Only do this for pointer parameters as discovered above
+						_codegen->emit_store(arguments[i], _codegen->emit_load(parameters[i]));
+			}
 		}
 		else if (symbol.op == symbol_type::invalid)
 		{
@@ -895,6 +972,11 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 		else if (symbol.op == symbol_type::variable)
 		{
 			assert(symbol.id != 0);
+
+			// Textures named in sampler declarations at global scope are kept through the sampler instead, so only track references from function bodies
+			if (_current_function != 0 && (symbol.type.is_sampler() || symbol.type.is_texture() || symbol.type.has(type::q_uniform)))
+				_references[_current_function].push_back(symbol.id);
+
 			// Simply return the pointer to the variable, dereferencing is done on site where necessary
 			exp.reset_to_lvalue(location, symbol.id, symbol.type);
 		}
@@ -1240,6 +1322,19 @@ bool reshadefx::parser::parse_expression_multary(expression &lhs, unsigned int l
 			if (rhs.is_constant && lhs.evaluate_constant_expression(op, rhs.constant))
 				continue;
 
+			// Operations with the identity element on one side (e.g. 'x * 1' or 'x + 0') simply return the other side, unless the result is marked precise
+			if (!type.has(type::q_precise) && (is_identity_constant(op, rhs, true) || is_identity_constant(op, lhs, false)))
+			{
+				if (lhs.is_constant)
+					lhs = std::move(rhs);
+
+				// The result is a r-value, so the other side cannot be assigned to through it
+				// Force a copy of the current value, since a side effect later in the expression may still modify the variable (e.g. '(x + 0) * (x = 3)')
+				if (lhs.is_lvalue)
+					lhs.reset_to_rvalue(lhs.location, _codegen->emit_load(lhs, true), type);
+				continue;
+			}
+
 			const auto lhs_value = _codegen->emit_load(lhs);
 
 #if RESHADEFX_SHORT_CIRCUIT
@@ -2078,6 +2173,21 @@ bool reshadefx::parser::parse_statement_block(bool scoped)
 	return expect('}');
 }
 
+void reshadefx::parser::collect_references(std::vector<uint32_t> pending, std::unordered_set<uint32_t> &referenced) const
+{
+	while (!pending.empty())
+	{
+		const uint32_t id = pending.back();
+		pending.pop_back();
+
+		if (!referenced.insert(id).second)
+			continue;
+
+		if (const auto it = _references.find(id); it != _references.end())
+			pending.insert(pending.end(), it->second.begin(), it->second.end());
+	}
+}
+
 bool reshadefx::parser::parse_top()
 {
 	if (accept(tokenid::namespace_))
@@ -2387,9 +2497,14 @@ bool reshadefx::parser::parse_function(type type, std::string name)
 	// A function has to start with a new block
 	_codegen->enter_block(_codegen->create_block());
 
+	// Attribute all references in the function body to this function
+	_current_function = id;
+
 	if (!parse_statement_block(false))
 		parse_success = false;
 
+	_current_function = 0;
+
 	// Add implicit return statement to the end of functions
 	if (_codegen->is_in_block())
 		_codegen->leave_block_and_return();
@@ -2710,6 +2825,9 @@ bool reshadefx::parser::parse_technique()
 
 	bool parse_success = parse_annotations(info.annotations);
 
+	// The passes add their entry points and render targets to the end of the root references
+	const size_t first_root = _references[0].size();
+
 	if (!expect('{'))
 		return false;
 
@@ -2724,7 +2842,11 @@ bool reshadefx::parser::parse_technique()
 		}
 	}
 
-	_codegen->define_technique(info);
+	// Everything an entry point references has to be defined before it, so all references of this technique are known already
+	std::unordered_set<uint32_t> referenced;
+	collect_references(std::vector<uint32_t>(_references[0].begin() + first_root, _references[0].end()), referenced);
+
+	_codegen->define_technique(info, referenced);
 
 	return expect('}') && parse_success;
 }
@@ -2812,6 +2934,8 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 						// We potentially need to generate a special entry point function which translates between function parameters and input/output variables
 						_codegen->define_entry_point(function_info, is_ps);
 
+						_references[0].push_back(function_info.definition);
+
 						if (is_vs)
 						{
 							vs_info = function_info;
@@ -2847,6 +2971,8 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 
 						const auto target_index = state.size() > 12 ? (state[12] - '0') : 0;
 						info.render_target_names[target_index] = target_info.unique_name;
+
+						_references[0].push_back(symbol.id);
 					}
 				}
 			}
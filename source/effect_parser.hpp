@@ -7,6 +7,7 @@
 
 #include "effect_symbol_table.hpp"
 #include <memory> // std::unique_ptr
+#include <unordered_set>
 
 namespace reshadefx
 {
@@ -74,6 +75,8 @@ namespace reshadefx
 		bool parse_statement(bool scoped);
 		bool parse_statement_block(bool scoped);
 
+		void collect_references(std::vector<uint32_t> pending, std::unordered_set<uint32_t> &referenced) const;
+
 		codegen *_codegen = nullptr;
 		std::string _errors;
 		token _token, _token_next, _token_backup;
@@ -81,5 +84,8 @@ namespace reshadefx
 		reshadefx::type _current_return_type;
 		std::vector<uint32_t> _loop_break_target_stack;
 		std::vector<uint32_t> _loop_continue_target_stack;
+		uint32_t _current_function = 0;
+		// Functions, samplers, textures and uniforms referenced by each function (with the ones referenced by techniques stored under zero)
+		std::unordered_map<uint32_t, std::vector<uint32_t>> _references;
 	};
 }
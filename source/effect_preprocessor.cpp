@@ -6,6 +6,8 @@
 #include "effect_lexer.hpp"
 #include "effect_preprocessor.hpp"
 #include <cassert>
+#include <mutex>
+#include <shared_mutex>
 
 enum op_type
 {
@@ -120,17 +122,24 @@ bool reshadefx::preprocessor::add_macro_definition(const std::string &name, cons
 
 bool reshadefx::preprocessor::append_file(const std::filesystem::path &path)
 {
+	// Get modification time before reading, so that a change made while reading is not missed
+	std::error_code ec;
+	const std::filesystem::file_time_type modified = std::filesystem::last_write_time(path, ec);
+
 	std::string data;
-	if (!read_file(path, data))
+	if (ec || !read_file(path, data))
 		return false;
 
 	_success = true; // Clear success flag before parsing a new file
 
 #ifdef _WIN32
-	push(std::move(data), path.u8string());
+	const std::string path_string = path.u8string();
 #else
-	push(std::move(data), path.string());
+	const std::string path_string = path.string();
 #endif
+	_file_times[path_string] = modified;
+
+	push(std::move(data), path_string);
 	parse();
 
 	return _success;
@@ -156,6 +165,14 @@ std::vector<std::filesystem::path> reshadefx::preprocessor::included_files() con
 		files.push_back(std::filesystem::u8path(it.first));
 	return files;
 }
+std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> reshadefx::preprocessor::file_times() const
+{
+	std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> files;
+	files.reserve(_file_times.size());
+	for (const auto &it : _file_times)
+		files.emplace_back(std::filesystem::u8path(it.first), it.second);
+	return files;
+}
 std::vector<std::pair<std::string, std::string>> reshadefx::preprocessor::used_macro_definitions() const
 {
 	std::vector<std::pair<std::string, std::string>> defines;
@@ -177,11 +194,11 @@ void reshadefx::preprocessor::warning(const location &location, const std::strin
 	_errors += location.source + '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": preprocessor warning: " + message + '\n';
 }
 
-reshadefx::lexer &reshadefx::preprocessor::current_lexer()
+const std::string &reshadefx::preprocessor::current_input() const
 {
 	assert(!_input_stack.empty());
 
-	return *_input_stack.back().lexer;
+	return *_input_stack.back().data->source;
 }
 std::vector<reshadefx::preprocessor::if_level> &reshadefx::preprocessor::current_if_stack()
 {
@@ -190,11 +207,73 @@ std::vector<reshadefx::preprocessor::if_level> &reshadefx::preprocessor::current
 	return _input_stack.back().if_stack;
 }
 
+std::shared_ptr<const reshadefx::preprocessor::input_data> reshadefx::preprocessor::lex_input(std::string input)
+{
+	const auto data = std::make_shared<input_data>();
+	data->source = std::make_shared<const std::string>(std::move(input));
+
+	// Lex the whole input up front, so that the token stream can be replayed without lexing again when the input is used another time
+	lexer lexer(data->source, true, false, false, false, true, false);
+	do
+		data->tokens.push_back(lexer.lex());
+	while (data->tokens.back() != tokenid::end_of_file);
+
+	return data;
+}
+std::shared_ptr<const reshadefx::preprocessor::input_data> reshadefx::preprocessor::load_file(const std::filesystem::path &path, const std::string &key, std::filesystem::file_time_type &modified)
+{
+	struct file_cache_entry
+	{
+		uintmax_t size;
+		std::filesystem::file_time_type modified;
+		std::shared_ptr<const input_data> data;
+	};
+
+	// Included files are shared by all preprocessor instances in the process, so that common headers are only read and lexed once, instead of once for every effect
+	static std::shared_mutex s_file_cache_mutex;
+	static std::unordered_map<std::string, file_cache_entry> s_file_cache;
+
+	std::error_code ec;
+	const uintmax_t size = std::filesystem::file_size(path, ec);
+	if (ec)
+		return nullptr;
+	modified = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		return nullptr;
+
+	// Reuse the cached contents and tokens if the file was not modified since it was last read
+	{	const std::shared_lock<std::shared_mutex> lock(s_file_cache_mutex);
+
+		if (const auto it = s_file_cache.find(key);
+			it != s_file_cache.end() && it->second.size == size && it->second.modified == modified)
+			return it->second.data;
+	}
+
+	std::string source;
+	if (!read_file(path, source))
+		return nullptr;
+
+	// Lexing happens outside the lock, so that other threads are not blocked meanwhile (if two threads miss the same file at once, both results are equal and the last one wins)
+	const std::shared_ptr<const input_data> data = lex_input(std::move(source));
+
+	{	const std::lock_guard<std::shared_mutex> lock(s_file_cache_mutex);
+
+		s_file_cache[key] = { size, modified, data };
+	}
+
+	return data;
+}
+
 void reshadefx::preprocessor::push(std::string input, const std::string &name)
+{
+	push(lex_input(std::move(input)), name);
+}
+void reshadefx::preprocessor::push(std::shared_ptr<const input_data> data, const std::string &name)
 {
 	input_level level = {};
 	level.name = name;
-	level.lexer.reset(new lexer(std::move(input), true, false, false, false, true, false));
+	level.data = std::move(data);
+	level.next_token_index = 0;
 	level.next_token.id = tokenid::unknown;
 
 	if (!_input_stack.empty())
@@ -231,15 +310,15 @@ void reshadefx::preprocessor::consume()
 	assert(!_input_stack.empty());
 
 	auto &input_level = _input_stack.back();
-	const auto &input_string = input_level.lexer->input_string();
+	const auto &input_string = *input_level.data->source;
 
 	_token = std::move(input_level.next_token);
 	_token.location.source = _output_location.source;
 	_current_token_raw_data = input_string.substr(_token.offset, _token.length);
 
-	// Get the next token
+	// Get the next token from the pre-lexed token stream (the level is popped below once the end of file token was reached, so this never reads past the end)
 	input_level.next_token =
-		input_level.lexer->lex();
+		input_level.data->tokens[input_level.next_token_index++];
 
 	// Pop input level if lexical analysis has reached the end of it
 	while (_input_stack.back().next_token == tokenid::end_of_file)
@@ -290,7 +369,7 @@ bool reshadefx::preprocessor::expect(tokenid token)
 		auto actual_token = _input_stack.back().next_token;
 		actual_token.location.source = _output_location.source;
 
-		error(actual_token.location, "syntax error: unexpected token '" + current_lexer().input_string().substr(actual_token.offset, actual_token.length) + "'");
+		error(actual_token.location, "syntax error: unexpected token '" + current_input().substr(actual_token.offset, actual_token.length) + "'");
 
 		return false;
 	}
@@ -415,7 +494,7 @@ void reshadefx::preprocessor::parse_def()
 	const auto macro_name = std::move(_token.literal_as_string);
 	const auto macro_name_end_offset = _token.offset + _token.length;
 
-	if (current_lexer().input_string()[macro_name_end_offset] == '(')
+	if (current_input()[macro_name_end_offset] == '(')
 	{
 		accept(tokenid::parenthesis_open);
 
@@ -584,8 +663,9 @@ void reshadefx::preprocessor::parse_pragma()
 
 	if (pragma == "once")
 	{
+		// Replace the entry with empty input, so that further includes of this file do not add anything (the shared cache entry is left untouched)
 		if (const auto it = _filecache.find(_output_location.source); it != _filecache.end())
-			it->second.clear();
+			it->second = lex_input(std::string());
 		return;
 	}
 
@@ -617,6 +697,7 @@ void reshadefx::preprocessor::parse_include()
 	std::error_code ec;
 	std::filesystem::path filepath = std::filesystem::u8path(_output_location.source);
 	filepath.replace_filename(filename);
+	const std::filesystem::path local_filepath = filepath;
 
 	if (!std::filesystem::exists(filepath, ec))
 		for (const auto &include_path : _include_paths)
@@ -637,21 +718,30 @@ void reshadefx::preprocessor::parse_include()
 		return;
 	}
 
-	std::string data;
+	std::shared_ptr<const input_data> data;
 	if (auto it = _filecache.find(filepath_string); it != _filecache.end())
 	{
 		data = it->second;
 	}
 	else
 	{
-		if (!read_file(filepath, data))
+		std::filesystem::file_time_type modified;
+		data = load_file(filepath, filepath_string, modified);
+		if (data == nullptr)
 		{
+			// Remember where the file was expected next to the including file, so that creating it there can be detected
+#ifdef _WIN32
+			_file_times.try_emplace(local_filepath.u8string(), std::filesystem::file_time_type::min());
+#else
+			_file_times.try_emplace(local_filepath.string(), std::filesystem::file_time_type::min());
+#endif
 			error(keyword_location, "could not open included file '" + filepath_string + "'");
 			consume_until(tokenid::end_of_line);
 			return;
 		}
 
 		_filecache.emplace(filepath_string, data);
+		_file_times[filepath_string] = modified;
 	}
 
 	push(std::move(data), filepath_string);
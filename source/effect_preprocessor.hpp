@@ -6,7 +6,7 @@
 #pragma once
 
 #include "effect_token.hpp"
-#include <memory> // std::unique_ptr
+#include <memory> // std::shared_ptr
 #include <filesystem>
 #include <unordered_set>
 #include <unordered_map>
@@ -80,6 +80,11 @@ namespace reshadefx
 		/// Get a list of all included files.
 		/// </summary>
 		std::vector<std::filesystem::path> included_files() const;
+		/// <summary>
+		/// Get the modification time of every file that was read, as it was right before reading it.
+		/// Included files that could not be found are listed with the minimum time value, so that they can be watched for being created.
+		/// </summary>
+		std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> file_times() const;
 
 		/// <summary>
 		/// Get a list of all defines that were used in #ifdef and #ifndef lines
@@ -94,10 +99,19 @@ namespace reshadefx
 			bool skipping;
 			reshadefx::token token;
 		};
+		/// <summary>
+		/// An input string together with the tokens lexed from it. This is immutable once created, so it can be shared between levels and preprocessor instances.
+		/// </summary>
+		struct input_data
+		{
+			std::shared_ptr<const std::string> source;
+			std::vector<token> tokens;
+		};
 		struct input_level
 		{
 			std::string name;
-			std::unique_ptr<class lexer> lexer;
+			std::shared_ptr<const input_data> data;
+			size_t next_token_index;
 			token next_token;
 			std::vector<if_level> if_stack;
 			std::unordered_set<std::string> hidden_macros;
@@ -107,10 +121,14 @@ namespace reshadefx
 		void error(const location &location, const std::string &message);
 		void warning(const location &location, const std::string &message);
 
-		lexer &current_lexer();
+		const std::string &current_input() const;
 		std::vector<if_level> &current_if_stack();
 
+		static std::shared_ptr<const input_data> lex_input(std::string input);
+		static std::shared_ptr<const input_data> load_file(const std::filesystem::path &path, const std::string &key, std::filesystem::file_time_type &modified);
+
 		void push(std::string input, const std::string &name = std::string());
+		void push(std::shared_ptr<const input_data> data, const std::string &name);
 
 		bool peek(tokenid token) const;
 		void consume();
@@ -147,6 +165,7 @@ namespace reshadefx
 		std::unordered_set<std::string> _used_macros;
 		std::unordered_map<std::string, macro> _macros;
 		std::vector<std::filesystem::path> _include_paths;
-		std::unordered_map<std::string, std::string> _filecache;
+		std::unordered_map<std::string, std::shared_ptr<const input_data>> _filecache;
+		std::unordered_map<std::string, std::filesystem::file_time_type> _file_times;
 	};
 }
@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_string_pool.hpp"
+#include <cstring> // memcpy
+#include <functional> // std::hash
+
+reshadefx::string_pool::string_pool()
+{
+	// Reserve the first handle, so that zero can be used to mark strings that were not found
+	_strings.emplace_back();
+	_lookup.resize(256);
+}
+
+uint32_t reshadefx::string_pool::intern(std::string_view str)
+{
+	size_t slot = find_slot(str);
+	if (_lookup[slot] != invalid_handle)
+		return _lookup[slot];
+
+	char *const data = allocate(str.size());
+	std::memcpy(data, str.data(), str.size());
+
+	const auto handle = static_cast<uint32_t>(_strings.size());
+	_strings.emplace_back(data, str.size());
+
+	// Keep the table at most half full, so that probe sequences stay short
+	if (_strings.size() * 2 > _lookup.size())
+	{
+		std::vector<uint32_t> lookup(_lookup.size() * 2);
+		_lookup.swap(lookup);
+
+		for (uint32_t existing : lookup)
+			if (existing != invalid_handle)
+				_lookup[find_slot(_strings[existing])] = existing;
+
+		slot = find_slot(str);
+	}
+
+	_lookup[slot] = handle;
+
+	return handle;
+}
+uint32_t reshadefx::string_pool::find(std::string_view str) const
+{
+	return _lookup[find_slot(str)];
+}
+
+size_t reshadefx::string_pool::find_slot(std::string_view str) const
+{
+	const size_t mask = _lookup.size() - 1;
+
+	// Linear probing until either the string or an empty slot is found
+	size_t slot = std::hash<std::string_view>()(str) & mask;
+	while (_lookup[slot] != invalid_handle && _strings[_lookup[slot]] != str)
+		slot = (slot + 1) & mask;
+
+	return slot;
+}
+
+char *reshadefx::string_pool::allocate(size_t size)
+{
+	// Long strings get a dedicated allocation, which is kept at the front so that the last block stays the one that is currently being filled
+	if (size > block_size / 4)
+		return _blocks.insert(_blocks.begin(), std::make_unique<char[]>(size))->get();
+
+	if (_block_offset + size > block_size)
+	{
+		_blocks.push_back(std::make_unique<char[]>(block_size));
+		_block_offset = 0;
+	}
+
+	char *const data = _blocks.back().get() + _block_offset;
+	_block_offset += size;
+	return data;
+}
@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// A pool of unique strings, each of which is identified by a small integer handle.
+	/// The characters are stored in large blocks that are only freed together with the pool, so views into the pool stay valid for its whole lifetime.
+	/// </summary>
+	class string_pool
+	{
+	public:
+		/// <summary>
+		/// The handle that is returned for strings that are not part of the pool. No string is ever assigned this handle.
+		/// </summary>
+		static constexpr uint32_t invalid_handle = 0;
+
+		string_pool();
+
+		// Views into the pool would be invalidated by copying, so only allow moving
+		string_pool(string_pool &&) = default;
+		string_pool &operator=(string_pool &&) = default;
+
+		/// <summary>
+		/// Add a string to the pool if it does not exist yet.
+		/// </summary>
+		/// <param name="str">The string to add.</param>
+		/// <returns>The handle of the string in the pool.</returns>
+		uint32_t intern(std::string_view str);
+		/// <summary>
+		/// Look up a string in the pool without adding it.
+		/// </summary>
+		/// <param name="str">The string to find.</param>
+		/// <returns>The handle of the string in the pool, or <see cref="invalid_handle"/> if it was not added yet.</returns>
+		uint32_t find(std::string_view str) const;
+
+		/// <summary>
+		/// Get the string associated with the specified <paramref name="handle"/>.
+		/// </summary>
+		std::string_view operator[](uint32_t handle) const { return _strings[handle]; }
+
+		/// <summary>
+		/// Get the number of handles in use (including the invalid handle). All valid handles are smaller than this.
+		/// </summary>
+		size_t size() const { return _strings.size(); }
+
+	private:
+		static constexpr size_t block_size = 16384;
+
+		char *allocate(size_t size);
+		size_t find_slot(std::string_view str) const;
+
+		std::vector<std::unique_ptr<char[]>> _blocks;
+		size_t _block_offset = block_size;
+		std::vector<std::string_view> _strings;
+		// Open addressing hash table of handles into '_strings' (with zero marking empty slots), which does not need an allocation per string like a node-based map
+		std::vector<uint32_t> _lookup;
+	};
+}
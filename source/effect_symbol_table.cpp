@@ -6,6 +6,7 @@
 #include "effect_symbol_table.hpp"
 #include <cassert>
 #include <algorithm> // std::upper_bound, std::sort
+#include <unordered_map>
 
 #pragma region Import intrinsic functions
 
@@ -90,6 +91,18 @@ static const intrinsic s_intrinsics[] = {
 #undef out_float4
 #undef sampler
 
+// Range of overloads in the intrinsic table for every intrinsic name (overloads of the same name are listed next to each other in the definition file)
+static const std::unordered_map<std::string_view, std::pair<const intrinsic *, const intrinsic *>> s_intrinsic_overloads = []() {
+	std::unordered_map<std::string_view, std::pair<const intrinsic *, const intrinsic *>> overloads;
+	for (const intrinsic &intrinsic : s_intrinsics)
+	{
+		auto &range = overloads.try_emplace(intrinsic.function.name, &intrinsic, &intrinsic).first->second;
+		assert(range.second == &intrinsic); // Overloads have to be contiguous
+		range.second = &intrinsic + 1;
+	}
+	return overloads;
+}();
+
 #pragma endregion
 
 unsigned int reshadefx::type::rank(const type &src, const type &dst)
@@ -148,9 +161,11 @@ void reshadefx::symbol_table::leave_scope()
 {
 	assert(_current_scope.level > 0);
 
-	for (auto &symbol : _symbol_stack)
+	// Only names that had symbols added in this or a nested scope can be affected, and those are at the end of the list
+	while (!_local_symbol_names.empty() && _local_symbol_names.back().first >= _current_scope.level)
 	{
-		std::vector<scoped_symbol> &scope_list = symbol.second;
+		std::vector<scoped_symbol> &scope_list = _symbol_stack[_local_symbol_names.back().second];
+		_local_symbol_names.pop_back();
 
 		for (auto scope_it = scope_list.begin(); scope_it != scope_list.end();)
 		{
@@ -186,6 +201,16 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 	if (symbol.op != symbol_type::function && find_symbol(name, _current_scope, true).id != 0)
 		return false;
 
+	// Get the list of symbols with the specified name, adding the name to the pool if necessary
+	const auto symbol_list = [this, &symbol](const std::string &name) -> std::vector<scoped_symbol> & {
+		const uint32_t handle = _names.intern(name);
+		if (handle >= _symbol_stack.size())
+			_symbol_stack.resize(handle + 1),
+			_function_generation.resize(handle + 1);
+		if (symbol.op == symbol_type::function)
+			_function_generation[handle]++;
+		return _symbol_stack[handle];
+	};
 	// Insertion routine which keeps the symbol stack sorted by namespace level
 	const auto insert_sorted = [](auto &vec, const auto &item) {
 		return vec.insert(
@@ -208,7 +233,7 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 			const auto previous_scope_name = _current_scope.name.substr(pos);
 
 			// Insert symbol into this scope
-			insert_sorted(_symbol_stack[previous_scope_name + name], scoped_symbol { symbol, scope });
+			insert_sorted(symbol_list(previous_scope_name + name), scoped_symbol { symbol, scope });
 
 			// Continue walking up the scope chain
 			scope.level = ++scope.namespace_level;
@@ -217,29 +242,33 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 	else
 	{
 		// This is a local symbol so it's sufficient to update the symbol stack with just the current scope
-		insert_sorted(_symbol_stack[name], scoped_symbol { symbol, _current_scope });
+		insert_sorted(symbol_list(name), scoped_symbol { symbol, _current_scope });
+
+		// Remember names in scopes that are left again later, so that 'leave_scope' can find them
+		if (_current_scope.level > _current_scope.namespace_level)
+			_local_symbol_names.emplace_back(_current_scope.level, _names.find(name));
 	}
 
 	return true;
 }
 
-reshadefx::symbol reshadefx::symbol_table::find_symbol(const std::string &name) const
+reshadefx::symbol reshadefx::symbol_table::find_symbol(uint32_t name) const
 {
 	// Default to start search with current scope and walk back the scope chain
 	return find_symbol(name, _current_scope, false);
 }
-reshadefx::symbol reshadefx::symbol_table::find_symbol(const std::string &name, const scope &scope, bool exclusive) const
+reshadefx::symbol reshadefx::symbol_table::find_symbol(uint32_t name, const scope &scope, bool exclusive) const
 {
-	const auto stack_it = _symbol_stack.find(name);
-
-	// Check if symbol does exist
-	if (stack_it == _symbol_stack.end() || stack_it->second.empty())
+	// Check if symbol does exist (names that were never inserted may not even have a slot in the stack)
+	if (name >= _symbol_stack.size() || _symbol_stack[name].empty())
 		return {};
 
+	const std::vector<scoped_symbol> &scope_list = _symbol_stack[name];
+
 	// Walk up the scope chain starting at the requested scope level and find a matching symbol
 	symbol result = {};
 
-	for (auto it = stack_it->second.rbegin(), end = stack_it->second.rend(); it != end; ++it)
+	for (auto it = scope_list.rbegin(), end = scope_list.rend(); it != end; ++it)
 	{
 		if (it->scope.level > scope.level ||
 			it->scope.namespace_level > scope.namespace_level || (it->scope.namespace_level == scope.namespace_level && it->scope.name != scope.name))
@@ -305,16 +334,56 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 {
 	out_data.op = symbol_type::function;
 
+	const uint32_t handle = _names.find(name);
+
+	// The result only depends on the function symbols visible from the scope and on the argument types, so build a key from those and check if the same call was resolved before
+	// Names that are not in the pool (like qualified names) are rare, so do not bother caching those
+	resolved_call *cached = nullptr;
+	if (handle != string_pool::invalid_handle)
+	{
+		const auto append_key = [this](uint32_t value) { _resolve_key.append(reinterpret_cast<const char *>(&value), sizeof(value)); };
+
+		_resolve_key.clear();
+		append_key(handle);
+		append_key(handle < _function_generation.size() ? _function_generation[handle] : 0);
+		append_key(scope.level);
+		append_key(scope.namespace_level);
+		for (const expression &argument : arguments)
+		{
+			// These are all the properties 'type::rank' looks at
+			append_key(argument.type.base | (argument.type.rows << 8) | (argument.type.cols << 16));
+			append_key(static_cast<uint32_t>(argument.type.array_length));
+			append_key(argument.type.definition);
+		}
+
+		if (const auto it = _resolved_calls.find(_resolve_key); it != _resolved_calls.end())
+		{
+			if (it->second.found)
+			{
+				out_data.op = it->second.op;
+				out_data.id = it->second.id;
+				out_data.type = it->second.type;
+				out_data.function = it->second.function;
+			}
+
+			is_ambiguous = it->second.ambiguous;
+
+			return it->second.found;
+		}
+
+		cached = &_resolved_calls[_resolve_key];
+	}
+
 	const function_info *result = nullptr;
 	unsigned int num_overloads = 0;
 	unsigned int overload_namespace = scope.namespace_level;
 
 	// Look up function name in the symbol stack and loop through the associated symbols
-	const auto stack_it = _symbol_stack.find(name);
-
-	if (stack_it != _symbol_stack.end() && !stack_it->second.empty())
+	if (handle < _symbol_stack.size())
 	{
-		for (auto it = stack_it->second.rbegin(), end = stack_it->second.rend(); it != end; ++it)
+		const std::vector<scoped_symbol> &scope_list = _symbol_stack[handle];
+
+		for (auto it = scope_list.rbegin(), end = scope_list.rend(); it != end; ++it)
 		{
 			if (it->scope.level > scope.level ||
 				it->scope.namespace_level > scope.namespace_level ||
@@ -365,11 +434,13 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 	}
 
 	// Try matching against intrinsic functions if no matching user-defined function was found up to this point
-	if (num_overloads == 0)
+	if (const auto overloads = s_intrinsic_overloads.find(name); num_overloads == 0 && overloads != s_intrinsic_overloads.end())
 	{
-		for (const intrinsic &intrinsic : s_intrinsics)
+		for (const intrinsic *it = overloads->second.first; it != overloads->second.second; ++it)
 		{
-			if (intrinsic.function.name != name || intrinsic.function.parameter_list.size() != arguments.size())
+			const intrinsic &intrinsic = *it;
+
+			if (intrinsic.function.parameter_list.size() != arguments.size())
 				continue;
 
 			// A new possibly-matching intrinsic function was found, compare it against the current result
@@ -393,5 +464,8 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 
 	is_ambiguous = num_overloads > 1;
 
+	if (cached != nullptr)
+		*cached = { out_data.op, out_data.id, out_data.type, out_data.function, num_overloads == 1, is_ambiguous };
+
 	return num_overloads == 1;
 }
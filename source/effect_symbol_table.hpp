@@ -6,7 +6,8 @@
 #pragma once
 
 #include "effect_module.hpp"
-#include <unordered_map> // Used for symbol lookup table
+#include "effect_string_pool.hpp"
+#include <unordered_map>
 
 namespace reshadefx
 {
@@ -75,6 +76,12 @@ namespace reshadefx
 		/// <returns></returns>
 		const scope &current_scope() const { return _current_scope; }
 
+		/// <summary>
+		/// Get the pool of all symbol names. Handles from this pool can be used to look up symbols without hashing their name again.
+		/// </summary>
+		string_pool &names() { return _names; }
+		const string_pool &names() const { return _names; }
+
 		/// <summary>
 		/// Insert an new symbol in the symbol table. Returns <c>false</c> if a symbol by that name and type already exists.
 		/// </summary>
@@ -83,8 +90,10 @@ namespace reshadefx
 		/// <summary>
 		/// Look for an existing symbol with the specified <paramref name="name"/>.
 		/// </summary>
-		symbol find_symbol(const std::string &name) const;
-		symbol find_symbol(const std::string &name, const scope &scope, bool exclusive) const;
+		symbol find_symbol(const std::string &name) const { return find_symbol(_names.find(name)); }
+		symbol find_symbol(const std::string &name, const scope &scope, bool exclusive) const { return find_symbol(_names.find(name), scope, exclusive); }
+		symbol find_symbol(uint32_t name) const;
+		symbol find_symbol(uint32_t name, const scope &scope, bool exclusive) const;
 
 		/// <summary>
 		/// Search for the best function or intrinsic overload matching the argument list.
@@ -96,8 +105,24 @@ namespace reshadefx
 			struct scope scope; // Store scope with symbol data
 		};
 
+		struct resolved_call {
+			symbol_type op;
+			uint32_t id;
+			reshadefx::type type;
+			const reshadefx::function_info *function;
+			bool found, ambiguous;
+		};
+
 		scope _current_scope;
-		std::unordered_map<std::string, // Lookup table from name to matching symbols
-			std::vector<scoped_symbol>> _symbol_stack;
+		string_pool _names;
+		// Lookup table from name handle to matching symbols
+		std::vector<std::vector<scoped_symbol>> _symbol_stack;
+		// Names of symbols in local scopes (together with the scope level they were added at), so that leaving a scope does not need to look at every name
+		std::vector<std::pair<unsigned int, uint32_t>> _local_symbol_names;
+		// Number of function symbols added for each name handle, which is part of the key of cached call resolutions so that those are not reused after new overloads appeared
+		std::vector<uint32_t> _function_generation;
+		// Previous results of overload resolution, keyed by the name, scope and argument types of the call
+		mutable std::unordered_map<std::string, resolved_call> _resolved_calls;
+		mutable std::string _resolve_key;
 	};
 }
@@ -8,6 +8,7 @@
 #undef IMPLEMENT_INTRINSIC_GLSL
 #undef IMPLEMENT_INTRINSIC_HLSL
 #undef IMPLEMENT_INTRINSIC_SPIRV
+#undef IMPLEMENT_INTRINSIC_CONSTANT
 #endif
 
 #ifndef DEFINE_INTRINSIC
@@ -22,6 +23,9 @@
 #ifndef IMPLEMENT_INTRINSIC_SPIRV
 #define IMPLEMENT_INTRINSIC_SPIRV(name, i, code)
 #endif
+#ifndef IMPLEMENT_INTRINSIC_CONSTANT
+#define IMPLEMENT_INTRINSIC_CONSTANT(name, i, code)
+#endif
 
 // ret abs(x)
 DEFINE_INTRINSIC(abs, 0, int, int)
@@ -58,6 +62,14 @@ IMPLEMENT_INTRINSIC_SPIRV(abs, 1, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(abs, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_int[i] = std::abs(args[0].constant.as_int[i]);
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(abs, 1, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::abs(args[0].constant.as_float[i]);
+	})
 
 // ret all(x)
 DEFINE_INTRINSIC(all, 0, bool, bool)
@@ -84,6 +96,14 @@ IMPLEMENT_INTRINSIC_SPIRV(all, 1, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(all, 0, {
+	res.as_uint[0] = args[0].constant.as_uint[0];
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(all, 1, {
+	res.as_uint[0] = 1;
+	for (unsigned int i = 0; i < args[0].type.components(); ++i)
+		res.as_uint[0] &= args[0].constant.as_uint[i] != 0;
+	})
 
 // ret any(x)
 DEFINE_INTRINSIC(any, 0, bool, bool)
@@ -110,6 +130,14 @@ IMPLEMENT_INTRINSIC_SPIRV(any, 1, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(any, 0, {
+	res.as_uint[0] = args[0].constant.as_uint[0];
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(any, 1, {
+	res.as_uint[0] = 0;
+	for (unsigned int i = 0; i < args[0].type.components(); ++i)
+		res.as_uint[0] |= args[0].constant.as_uint[i] != 0;
+	})
 
 // ret asin(x)
 DEFINE_INTRINSIC(asin, 0, float, float)
@@ -129,6 +157,10 @@ IMPLEMENT_INTRINSIC_SPIRV(asin, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(asin, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::asin(args[0].constant.as_float[i]);
+	})
 
 // ret acos(x)
 DEFINE_INTRINSIC(acos, 0, float, float)
@@ -148,6 +180,10 @@ IMPLEMENT_INTRINSIC_SPIRV(acos, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(acos, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::acos(args[0].constant.as_float[i]);
+	})
 
 // ret atan(x)
 DEFINE_INTRINSIC(atan, 0, float, float)
@@ -167,6 +203,10 @@ IMPLEMENT_INTRINSIC_SPIRV(atan, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(atan, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::atan(args[0].constant.as_float[i]);
+	})
 
 // ret atan2(x, y)
 DEFINE_INTRINSIC(atan2, 0, float, float, float)
@@ -187,6 +227,10 @@ IMPLEMENT_INTRINSIC_SPIRV(atan2, 0, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(atan2, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::atan2(args[0].constant.as_float[i], args[1].constant.as_float[i]);
+	})
 
 // ret sin(x)
 DEFINE_INTRINSIC(sin, 0, float, float)
@@ -206,6 +250,10 @@ IMPLEMENT_INTRINSIC_SPIRV(sin, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(sin, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::sin(args[0].constant.as_float[i]);
+	})
 
 // ret sinh(x)
 DEFINE_INTRINSIC(sinh, 0, float, float)
@@ -225,6 +273,10 @@ IMPLEMENT_INTRINSIC_SPIRV(sinh, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(sinh, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::sinh(args[0].constant.as_float[i]);
+	})
 
 // ret cos(x)
 DEFINE_INTRINSIC(cos, 0, float, float)
@@ -244,6 +296,10 @@ IMPLEMENT_INTRINSIC_SPIRV(cos, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(cos, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::cos(args[0].constant.as_float[i]);
+	})
 
 // ret cosh(x)
 DEFINE_INTRINSIC(cosh, 0, float, float)
@@ -263,6 +319,10 @@ IMPLEMENT_INTRINSIC_SPIRV(cosh, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(cosh, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::cosh(args[0].constant.as_float[i]);
+	})
 
 // ret tan(x)
 DEFINE_INTRINSIC(tan, 0, float, float)
@@ -282,6 +342,10 @@ IMPLEMENT_INTRINSIC_SPIRV(tan, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(tan, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::tan(args[0].constant.as_float[i]);
+	})
 
 // ret tanh(x)
 DEFINE_INTRINSIC(tanh, 0, float, float)
@@ -301,6 +365,10 @@ IMPLEMENT_INTRINSIC_SPIRV(tanh, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(tanh, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::tanh(args[0].constant.as_float[i]);
+	})
 
 // sincos(x, out s, out c)
 DEFINE_INTRINSIC(sincos, 0, void, float, out_float, out_float)
@@ -351,6 +419,10 @@ IMPLEMENT_INTRINSIC_SPIRV(asint, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(asint, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_uint[i] = args[0].constant.as_uint[i];
+	})
 
 // ret asuint(x)
 DEFINE_INTRINSIC(asuint, 0, uint, float)
@@ -368,6 +440,10 @@ IMPLEMENT_INTRINSIC_SPIRV(asuint, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(asuint, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_uint[i] = args[0].constant.as_uint[i];
+	})
 
 // ret asfloat(x)
 DEFINE_INTRINSIC(asfloat, 0, float, int)
@@ -400,6 +476,14 @@ IMPLEMENT_INTRINSIC_SPIRV(asfloat, 1, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(asfloat, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_uint[i] = args[0].constant.as_uint[i];
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(asfloat, 1, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_uint[i] = args[0].constant.as_uint[i];
+	})
 
 // ret ceil(x)
 DEFINE_INTRINSIC(ceil, 0, float, float)
@@ -419,6 +503,10 @@ IMPLEMENT_INTRINSIC_SPIRV(ceil, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(ceil, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::ceil(args[0].constant.as_float[i]);
+	})
 
 // ret floor(x)
 DEFINE_INTRINSIC(floor, 0, float, float)
@@ -441,6 +529,10 @@ IMPLEMENT_INTRINSIC_SPIRV(floor, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(floor, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::floor(args[0].constant.as_float[i]);
+	})
 
 // ret clamp(x, min, max)
 DEFINE_INTRINSIC(clamp, 0, int, int, int, int)
@@ -500,6 +592,18 @@ IMPLEMENT_INTRINSIC_SPIRV(clamp, 2, {
 		.add(args[2].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(clamp, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_int[i] = std::min(std::max(args[0].constant.as_int[i], args[1].constant.as_int[i]), args[2].constant.as_int[i]);
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(clamp, 1, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_uint[i] = std::min(std::max(args[0].constant.as_uint[i], args[1].constant.as_uint[i]), args[2].constant.as_uint[i]);
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(clamp, 2, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::min(std::max(args[0].constant.as_float[i], args[1].constant.as_float[i]), args[2].constant.as_float[i]);
+	})
 
 // ret saturate(x)
 DEFINE_INTRINSIC(saturate, 0, float, float)
@@ -524,6 +628,10 @@ IMPLEMENT_INTRINSIC_SPIRV(saturate, 0, {
 		.add(constant_one)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(saturate, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::min(std::max(args[0].constant.as_float[i], 0.0f), 1.0f);
+	})
 
 // ret mad(mvalue, avalue, bvalue)
 DEFINE_INTRINSIC(mad, 0, float, float, float, float)
@@ -548,6 +656,10 @@ IMPLEMENT_INTRINSIC_SPIRV(mad, 0, {
 		.add(args[2].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(mad, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[i] * args[1].constant.as_float[i] + args[2].constant.as_float[i];
+	})
 
 // ret rcp(x)
 DEFINE_INTRINSIC(rcp, 0, float, float)
@@ -571,6 +683,10 @@ IMPLEMENT_INTRINSIC_SPIRV(rcp, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(rcp, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = 1.0f / args[0].constant.as_float[i];
+	})
 
 // ret pow(x, y)
 DEFINE_INTRINSIC(pow, 0, float, float, float)
@@ -591,6 +707,14 @@ IMPLEMENT_INTRINSIC_SPIRV(pow, 0, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(pow, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		// The result is undefined for a negative base on the GPU, so do not fold this expression in that case
+		if (args[0].constant.as_float[i] < 0)
+			return false;
+		else
+			res.as_float[i] = std::pow(args[0].constant.as_float[i], args[1].constant.as_float[i]);
+	})
 
 // ret exp(x)
 DEFINE_INTRINSIC(exp, 0, float, float)
@@ -610,6 +734,10 @@ IMPLEMENT_INTRINSIC_SPIRV(exp, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(exp, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::exp(args[0].constant.as_float[i]);
+	})
 
 // ret exp2(x)
 DEFINE_INTRINSIC(exp2, 0, float, float)
@@ -629,6 +757,10 @@ IMPLEMENT_INTRINSIC_SPIRV(exp2, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(exp2, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::exp2(args[0].constant.as_float[i]);
+	})
 
 // ret log(x)
 DEFINE_INTRINSIC(log, 0, float, float)
@@ -648,6 +780,10 @@ IMPLEMENT_INTRINSIC_SPIRV(log, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(log, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::log(args[0].constant.as_float[i]);
+	})
 
 // ret log2(x)
 DEFINE_INTRINSIC(log2, 0, float, float)
@@ -667,6 +803,10 @@ IMPLEMENT_INTRINSIC_SPIRV(log2, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(log2, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::log2(args[0].constant.as_float[i]);
+	})
 
 // ret log10(x)
 DEFINE_INTRINSIC(log10, 0, float, float)
@@ -693,6 +833,10 @@ IMPLEMENT_INTRINSIC_SPIRV(log10, 0, {
 		.add(log2)
 		.add(log10)
 		.result; })
+IMPLEMENT_INTRINSIC_CONSTANT(log10, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::log10(args[0].constant.as_float[i]);
+	})
 
 // ret sign(x)
 DEFINE_INTRINSIC(sign, 0, int, int)
@@ -729,6 +873,14 @@ IMPLEMENT_INTRINSIC_SPIRV(sign, 1, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(sign, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_int[i] = (args[0].constant.as_int[i] > 0) - (args[0].constant.as_int[i] < 0);
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(sign, 1, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = static_cast<float>((args[0].constant.as_float[i] > 0) - (args[0].constant.as_float[i] < 0));
+	})
 
 // ret sqrt(x)
 DEFINE_INTRINSIC(sqrt, 0, float, float)
@@ -748,6 +900,10 @@ IMPLEMENT_INTRINSIC_SPIRV(sqrt, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(sqrt, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::sqrt(args[0].constant.as_float[i]);
+	})
 
 // ret rsqrt(x)
 DEFINE_INTRINSIC(rsqrt, 0, float, float)
@@ -767,6 +923,10 @@ IMPLEMENT_INTRINSIC_SPIRV(rsqrt, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(rsqrt, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = 1.0f / std::sqrt(args[0].constant.as_float[i]);
+	})
 
 // ret lerp(x, y, s)
 DEFINE_INTRINSIC(lerp, 0, float, float, float, float)
@@ -788,6 +948,10 @@ IMPLEMENT_INTRINSIC_SPIRV(lerp, 0, {
 		.add(args[2].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(lerp, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[i] + args[2].constant.as_float[i] * (args[1].constant.as_float[i] - args[0].constant.as_float[i]);
+	})
 
 // ret step(y, x)
 DEFINE_INTRINSIC(step, 0, float, float, float)
@@ -808,6 +972,10 @@ IMPLEMENT_INTRINSIC_SPIRV(step, 0, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(step, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[1].constant.as_float[i] >= args[0].constant.as_float[i] ? 1.0f : 0.0f;
+	})
 
 // ret smoothstep(min, max, x)
 DEFINE_INTRINSIC(smoothstep, 0, float, float, float, float)
@@ -829,6 +997,13 @@ IMPLEMENT_INTRINSIC_SPIRV(smoothstep, 0, {
 		.add(args[2].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(smoothstep, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+	{
+		const float t = std::min(std::max((args[2].constant.as_float[i] - args[0].constant.as_float[i]) / (args[1].constant.as_float[i] - args[0].constant.as_float[i]), 0.0f), 1.0f);
+		res.as_float[i] = t * t * (3.0f - 2.0f * t);
+	}
+	})
 
 // ret frac(x)
 DEFINE_INTRINSIC(frac, 0, float, float)
@@ -848,6 +1023,10 @@ IMPLEMENT_INTRINSIC_SPIRV(frac, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(frac, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[i] - std::floor(args[0].constant.as_float[i]);
+	})
 
 // ret ldexp(x, exp)
 DEFINE_INTRINSIC(ldexp, 0, float, float, int)
@@ -868,6 +1047,10 @@ IMPLEMENT_INTRINSIC_SPIRV(ldexp, 0, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(ldexp, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::ldexp(args[0].constant.as_float[i], args[1].constant.as_int[i]);
+	})
 
 // ret modf(x, out ip)
 DEFINE_INTRINSIC(modf, 0, float, float, out_float)
@@ -927,6 +1110,10 @@ IMPLEMENT_INTRINSIC_SPIRV(trunc, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(trunc, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::trunc(args[0].constant.as_float[i]);
+	})
 
 // ret round(x)
 DEFINE_INTRINSIC(round, 0, float, float)
@@ -946,6 +1133,10 @@ IMPLEMENT_INTRINSIC_SPIRV(round, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(round, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::nearbyint(args[0].constant.as_float[i]);
+	})
 
 // ret min(x, y)
 DEFINE_INTRINSIC(min, 0, int, int, int)
@@ -984,6 +1175,14 @@ IMPLEMENT_INTRINSIC_SPIRV(min, 1, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(min, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_int[i] = std::min(args[0].constant.as_int[i], args[1].constant.as_int[i]);
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(min, 1, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::min(args[0].constant.as_float[i], args[1].constant.as_float[i]);
+	})
 
 // ret max(x, y)
 DEFINE_INTRINSIC(max, 0, int, int, int)
@@ -1022,6 +1221,14 @@ IMPLEMENT_INTRINSIC_SPIRV(max, 1, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(max, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_int[i] = std::max(args[0].constant.as_int[i], args[1].constant.as_int[i]);
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(max, 1, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = std::max(args[0].constant.as_float[i], args[1].constant.as_float[i]);
+	})
 
 // ret degree(x)
 DEFINE_INTRINSIC(degrees, 0, float, float)
@@ -1041,6 +1248,10 @@ IMPLEMENT_INTRINSIC_SPIRV(degrees, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(degrees, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[i] * 57.29577951f;
+	})
 
 // ret radians(x)
 DEFINE_INTRINSIC(radians, 0, float, float)
@@ -1060,6 +1271,10 @@ IMPLEMENT_INTRINSIC_SPIRV(radians, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(radians, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[i] * 0.01745329252f;
+	})
 
 // ret ddx(x)
 DEFINE_INTRINSIC(ddx, 0, float, float)
@@ -1077,6 +1292,11 @@ IMPLEMENT_INTRINSIC_SPIRV(ddx, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(ddx, 0, {
+	// The derivative of a constant is always zero
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = 0.0f;
+	})
 
 // ret ddy(x)
 DEFINE_INTRINSIC(ddy, 0, float, float)
@@ -1094,6 +1314,11 @@ IMPLEMENT_INTRINSIC_SPIRV(ddy, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(ddy, 0, {
+	// The derivative of a constant is always zero
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = 0.0f;
+	})
 
 // ret fwidth(x)
 DEFINE_INTRINSIC(fwidth, 0, float, float)
@@ -1111,6 +1336,11 @@ IMPLEMENT_INTRINSIC_SPIRV(fwidth, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(fwidth, 0, {
+	// The derivative of a constant is always zero
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = 0.0f;
+	})
 
 // ret dot(x, y)
 DEFINE_INTRINSIC(dot, 0, float, float2, float2)
@@ -1128,6 +1358,11 @@ IMPLEMENT_INTRINSIC_SPIRV(dot, 0, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(dot, 0, {
+	res.as_float[0] = 0.0f;
+	for (unsigned int i = 0; i < args[0].type.components(); ++i)
+		res.as_float[0] += args[0].constant.as_float[i] * args[1].constant.as_float[i];
+	})
 
 // ret cross(x, y)
 DEFINE_INTRINSIC(cross, 0, float3, float3, float3)
@@ -1145,6 +1380,11 @@ IMPLEMENT_INTRINSIC_SPIRV(cross, 0, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(cross, 0, {
+	res.as_float[0] = args[0].constant.as_float[1] * args[1].constant.as_float[2] - args[0].constant.as_float[2] * args[1].constant.as_float[1];
+	res.as_float[1] = args[0].constant.as_float[2] * args[1].constant.as_float[0] - args[0].constant.as_float[0] * args[1].constant.as_float[2];
+	res.as_float[2] = args[0].constant.as_float[0] * args[1].constant.as_float[1] - args[0].constant.as_float[1] * args[1].constant.as_float[0];
+	})
 
 // ret length(x)
 DEFINE_INTRINSIC(length, 0, float, float)
@@ -1164,6 +1404,12 @@ IMPLEMENT_INTRINSIC_SPIRV(length, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(length, 0, {
+	float sum = 0.0f;
+	for (unsigned int i = 0; i < args[0].type.components(); ++i)
+		sum += args[0].constant.as_float[i] * args[0].constant.as_float[i];
+	res.as_float[0] = std::sqrt(sum);
+	})
 
 // ret distance(x, y)
 DEFINE_INTRINSIC(distance, 0, float, float, float)
@@ -1184,6 +1430,12 @@ IMPLEMENT_INTRINSIC_SPIRV(distance, 0, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(distance, 0, {
+	float sum = 0.0f;
+	for (unsigned int i = 0; i < args[0].type.components(); ++i)
+		sum += (args[0].constant.as_float[i] - args[1].constant.as_float[i]) * (args[0].constant.as_float[i] - args[1].constant.as_float[i]);
+	res.as_float[0] = std::sqrt(sum);
+	})
 
 // ret normalize(x)
 DEFINE_INTRINSIC(normalize, 0, float2, float2)
@@ -1202,6 +1454,14 @@ IMPLEMENT_INTRINSIC_SPIRV(normalize, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(normalize, 0, {
+	float sum = 0.0f;
+	for (unsigned int i = 0; i < args[0].type.components(); ++i)
+		sum += args[0].constant.as_float[i] * args[0].constant.as_float[i];
+	const float length = std::sqrt(sum);
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[i] / length;
+	})
 
 // ret transpose(x)
 DEFINE_INTRINSIC(transpose, 0, float2x2, float2x2)
@@ -1218,6 +1478,11 @@ IMPLEMENT_INTRINSIC_SPIRV(transpose, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(transpose, 0, {
+	for (unsigned int row = 0; row < res_type.rows; ++row)
+		for (unsigned int col = 0; col < res_type.cols; ++col)
+			res.as_float[row * res_type.cols + col] = args[0].constant.as_float[col * res_type.rows + row];
+	})
 
 // ret determinant(m)
 DEFINE_INTRINSIC(determinant, 0, float, float2x2)
@@ -1236,6 +1501,30 @@ IMPLEMENT_INTRINSIC_SPIRV(determinant, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(determinant, 0, {
+	const float *const m = args[0].constant.as_float;
+	switch (args[0].type.rows)
+	{
+	case 2:
+		res.as_float[0] = m[0] * m[3] - m[1] * m[2];
+		break;
+	case 3:
+		res.as_float[0] = m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) + m[2] * (m[3] * m[7] - m[4] * m[6]);
+		break;
+	case 4:
+		// Laplace expansion using the 2x2 sub-determinants of the upper and lower two rows
+		res.as_float[0] =
+			(m[0] * m[5] - m[1] * m[4]) * (m[10] * m[15] - m[11] * m[14]) -
+			(m[0] * m[6] - m[2] * m[4]) * (m[9] * m[15] - m[11] * m[13]) +
+			(m[0] * m[7] - m[3] * m[4]) * (m[9] * m[14] - m[10] * m[13]) +
+			(m[1] * m[6] - m[2] * m[5]) * (m[8] * m[15] - m[11] * m[12]) -
+			(m[1] * m[7] - m[3] * m[5]) * (m[8] * m[14] - m[10] * m[12]) +
+			(m[2] * m[7] - m[3] * m[6]) * (m[8] * m[13] - m[9] * m[12]);
+		break;
+	default:
+		return false;
+	}
+	})
 
 // ret reflect(i, n)
 DEFINE_INTRINSIC(reflect, 0, float2, float2, float2)
@@ -1255,6 +1544,13 @@ IMPLEMENT_INTRINSIC_SPIRV(reflect, 0, {
 		.add(args[1].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(reflect, 0, {
+	float n_dot_i = 0.0f;
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		n_dot_i += args[1].constant.as_float[i] * args[0].constant.as_float[i];
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[i] - 2.0f * n_dot_i * args[1].constant.as_float[i];
+	})
 
 // ret refract(i, n, eta)
 DEFINE_INTRINSIC(refract, 0, float2, float2, float2, float)
@@ -1275,6 +1571,15 @@ IMPLEMENT_INTRINSIC_SPIRV(refract, 0, {
 		.add(args[2].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(refract, 0, {
+	float n_dot_i = 0.0f;
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		n_dot_i += args[1].constant.as_float[i] * args[0].constant.as_float[i];
+	const float eta = args[2].constant.as_float[0];
+	const float k = 1.0f - eta * eta * (1.0f - n_dot_i * n_dot_i);
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = k < 0.0f ? 0.0f : eta * args[0].constant.as_float[i] - (eta * n_dot_i + std::sqrt(k)) * args[1].constant.as_float[i];
+	})
 
 // ret faceforward(n, i, ng)
 DEFINE_INTRINSIC(faceforward, 0, float, float, float, float)
@@ -1296,6 +1601,13 @@ IMPLEMENT_INTRINSIC_SPIRV(faceforward, 0, {
 		.add(args[2].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(faceforward, 0, {
+	float ng_dot_i = 0.0f;
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		ng_dot_i += args[2].constant.as_float[i] * args[1].constant.as_float[i];
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = ng_dot_i < 0.0f ? args[0].constant.as_float[i] : -args[0].constant.as_float[i];
+	})
 
 // ret mul(x, y)
 DEFINE_INTRINSIC(mul, 0, float2, float, float2)
@@ -1407,6 +1719,49 @@ IMPLEMENT_INTRINSIC_SPIRV(mul, 6, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(mul, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[0] * args[1].constant.as_float[i];
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(mul, 1, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[i] * args[1].constant.as_float[0];
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(mul, 2, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[0] * args[1].constant.as_float[i];
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(mul, 3, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_float[i] = args[0].constant.as_float[i] * args[1].constant.as_float[0];
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(mul, 4, {
+	// Row vector times matrix
+	for (unsigned int col = 0; col < res_type.rows; ++col)
+	{
+		res.as_float[col] = 0.0f;
+		for (unsigned int row = 0; row < args[1].type.rows; ++row)
+			res.as_float[col] += args[0].constant.as_float[row] * args[1].constant.as_float[row * args[1].type.cols + col];
+	}
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(mul, 5, {
+	// Matrix times column vector
+	for (unsigned int row = 0; row < res_type.rows; ++row)
+	{
+		res.as_float[row] = 0.0f;
+		for (unsigned int col = 0; col < args[0].type.cols; ++col)
+			res.as_float[row] += args[0].constant.as_float[row * args[0].type.cols + col] * args[1].constant.as_float[col];
+	}
+	})
+IMPLEMENT_INTRINSIC_CONSTANT(mul, 6, {
+	for (unsigned int row = 0; row < res_type.rows; ++row)
+		for (unsigned int col = 0; col < res_type.cols; ++col)
+		{
+			res.as_float[row * res_type.cols + col] = 0.0f;
+			for (unsigned int k = 0; k < args[0].type.cols; ++k)
+				res.as_float[row * res_type.cols + col] += args[0].constant.as_float[row * args[0].type.cols + k] * args[1].constant.as_float[k * args[1].type.cols + col];
+		}
+	})
 
 // ret isinf(x)
 DEFINE_INTRINSIC(isinf, 0, bool, float)
@@ -1424,6 +1779,10 @@ IMPLEMENT_INTRINSIC_SPIRV(isinf, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(isinf, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_uint[i] = std::isinf(args[0].constant.as_float[i]);
+	})
 
 // ret isnan(x)
 DEFINE_INTRINSIC(isnan, 0, bool, float)
@@ -1441,6 +1800,10 @@ IMPLEMENT_INTRINSIC_SPIRV(isnan, 0, {
 		.add(args[0].base)
 		.result;
 	})
+IMPLEMENT_INTRINSIC_CONSTANT(isnan, 0, {
+	for (unsigned int i = 0; i < res_type.components(); ++i)
+		res.as_uint[i] = std::isnan(args[0].constant.as_float[i]);
+	})
 
 // ret tex2D(s, coords)
 DEFINE_INTRINSIC(tex2D, 0, float4, sampler, float2)
@@ -1733,3 +2096,4 @@ IMPLEMENT_INTRINSIC_SPIRV(tex2Dgatheroffset, 0, {
 #undef IMPLEMENT_INTRINSIC_GLSL
 #undef IMPLEMENT_INTRINSIC_HLSL
 #undef IMPLEMENT_INTRINSIC_SPIRV
+#undef IMPLEMENT_INTRINSIC_CONSTANT
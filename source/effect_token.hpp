@@ -200,6 +200,7 @@ namespace reshadefx
 			double literal_as_double;
 		};
 		std::string literal_as_string;
+		uint32_t literal_as_handle; // Handle of an identifier in the string pool of the lexer, or zero if there is none
 
 		inline operator tokenid() const { return id; }
 
@@ -0,0 +1,115 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/// <summary>
+/// A bounded lock-free queue, which any number of threads may push to and pop from at the same time.
+/// Each slot carries a sequence number that tells whether it is ready to be written or read in the current lap around the buffer, so no thread ever waits for another.
+/// </summary>
+template <typename T, size_t CAPACITY>
+class lockfree_queue
+{
+	static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity has to be a power of two");
+
+public:
+	lockfree_queue()
+	{
+		for (size_t i = 0; i < CAPACITY; ++i)
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Adds a value to the end of the queue.
+	/// </summary>
+	/// <param name="value">The value to add. It is only moved from if the push succeeds.</param>
+	/// <returns><c>true</c> if the value was added, <c>false</c> if the queue is full.</returns>
+	bool try_push(T &value)
+	{
+		size_t pos = _tail.load(std::memory_order_relaxed);
+		for (slot *s;;)
+		{
+			s = &_slots[pos & (CAPACITY - 1)];
+
+			// The slot is free for this position when its sequence matches, and still holds a value from the previous lap when it lags behind
+			if (const intptr_t diff = static_cast<intptr_t>(s->sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos); diff == 0)
+			{
+				if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					s->value = std::move(value);
+					s->sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = _tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Removes the value at the front of the queue.
+	/// </summary>
+	/// <param name="value">Set to the removed value.</param>
+	/// <returns><c>true</c> if a value was removed, <c>false</c> if the queue is empty.</returns>
+	bool try_pop(T &value)
+	{
+		size_t pos = _head.load(std::memory_order_relaxed);
+		for (slot *s;;)
+		{
+			s = &_slots[pos & (CAPACITY - 1)];
+
+			if (const intptr_t diff = static_cast<intptr_t>(s->sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos + 1); diff == 0)
+			{
+				if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					value = std::move(s->value);
+					s->value = T();
+					// Mark the slot as free for the push one lap later
+					s->sequence.store(pos + CAPACITY, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = _head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Checks whether the queue is empty. The result may be outdated by the time it is returned if other threads are using the queue.
+	/// </summary>
+	bool empty() const
+	{
+		return _head.load(std::memory_order_acquire) >= _tail.load(std::memory_order_acquire);
+	}
+
+private:
+	struct slot
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	slot _slots[CAPACITY];
+	// Keep the producer and consumer positions on separate cache lines, so that they do not contend with each other
+	alignas(64) std::atomic<size_t> _head = 0;
+	alignas(64) std::atomic<size_t> _tail = 0;
+};
@@ -7,6 +7,7 @@
 #include "runtime_gl.hpp"
 #include "runtime_config.hpp"
 #include "runtime_objects.hpp"
+#include "pixel_conversion.hpp"
 #include <imgui.h>
 
 namespace reshade::opengl
@@ -321,21 +322,17 @@ bool reshade::opengl::runtime_gl::capture_screenshot(uint8_t *buffer) const
 	glReadBuffer(_current_fbo == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
 	glReadPixels(0, 0, GLsizei(_width), GLsizei(_height), GL_RGBA, GL_UNSIGNED_BYTE, buffer);
 
-	// Flip image horizontally
-	for (unsigned int y = 0, pitch = _width * 4; y * 2 < _height; ++y)
+	// Flip image vertically and clear alpha channel, swapping pairs of rows through a temporary row
+	const uint32_t pitch = _width * 4;
+	std::vector<uint8_t> temp(pitch);
+	for (uint32_t y = 0; y * 2 < _height; ++y)
 	{
-		const auto i1 = y * pitch;
-		const auto i2 = (_height - 1 - y) * pitch;
+		const auto line1 = buffer + pitch * (y);
+		const auto line2 = buffer + pitch * (_height - 1 - y);
 
-		for (unsigned int x = 0; x < pitch; x += 4)
-		{
-			buffer[i1 + x + 3] = 0xFF; // Clear alpha channel
-			buffer[i2 + x + 3] = 0xFF;
-
-			std::swap(buffer[i1 + x + 0], buffer[i2 + x + 0]);
-			std::swap(buffer[i1 + x + 1], buffer[i2 + x + 1]);
-			std::swap(buffer[i1 + x + 2], buffer[i2 + x + 2]);
-		}
+		std::memcpy(temp.data(), line1, pitch);
+		convert_pixels(pixel_format::rgba8_unorm, line2, pitch, pixel_format::rgba8_unorm, line1, pitch, _width, 1, true);
+		convert_pixels(pixel_format::rgba8_unorm, temp.data(), pitch, pixel_format::rgba8_unorm, line2, pitch, _width, 1, true);
 	}
 
 	return true;
@@ -362,9 +359,12 @@ bool reshade::opengl::runtime_gl::init_effect(size_t index)
 
 	std::unordered_map<std::string, GLuint> entry_points;
 
-	// Compile all entry points
+	// Compile the entry points of the techniques that are initialized now (the others are compiled once they get enabled)
 	for (const auto &entry_point : effect.module.entry_points)
 	{
+		if (!is_entry_point_pending(index, entry_point.name))
+			continue;
+
 		GLuint shader_id = glCreateShader(entry_point.is_pixel_shader ? GL_FRAGMENT_SHADER : GL_VERTEX_SHADER);
 		entry_points[entry_point.name] = shader_id;
 
@@ -422,7 +422,8 @@ bool reshade::opengl::runtime_gl::init_effect(size_t index)
 	if (index >= _effect_ubos.size())
 		_effect_ubos.resize(index + 1);
 
-	if (!effect.uniform_data_storage.empty())
+	// The uniform buffer is shared by all techniques, so it already exists if this effect was initialized for other techniques before
+	if (!effect.uniform_data_storage.empty() && _effect_ubos[index] == 0)
 	{
 		GLuint &ubo = _effect_ubos[index];
 		glGenBuffers(1, &ubo);
@@ -438,13 +439,16 @@ bool reshade::opengl::runtime_gl::init_effect(size_t index)
 	{
 		const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
 			[&texture_name = info.texture_name](const auto &item) {
-			return item.unique_name == texture_name && item.impl != nullptr;
+			return item.unique_name == texture_name;
 		});
 		if (existing_texture == _textures.end())
 		{
 			success = false;
 			continue;
 		}
+		// Textures only used by techniques that are not enabled yet were not created, so there is nothing to bind
+		if (existing_texture->impl == nullptr)
+			continue;
 
 		// Hash sampler state to avoid duplicated sampler objects
 		size_t hash = 2166136261;
@@ -541,7 +545,7 @@ bool reshade::opengl::runtime_gl::init_effect(size_t index)
 
 	for (technique &technique : _techniques)
 	{
-		if (technique.impl != nullptr || technique.effect_index != index)
+		if (!is_technique_pending(technique, index))
 			continue;
 
 		// Copy construct new technique implementation instead of move because effect may contain multiple techniques
@@ -842,20 +846,11 @@ void reshade::opengl::runtime_gl::upload_texture(texture &texture, const uint8_t
 	const auto impl = texture.impl->as<opengl_tex_data>();
 	assert(impl != nullptr && pixels != nullptr && texture.impl_reference == texture_reference::none);
 
-	unsigned int upload_pitch = texture.width * 4;
-	std::vector<uint8_t> upload_data(pixels, pixels + upload_pitch * texture.height);
-
-	// Flip image data horizontally
-	const auto temp = static_cast<uint8_t *>(alloca(upload_pitch));
-	for (uint32_t y = 0; 2 * y < texture.height; y++)
-	{
-		const auto line1 = upload_data.data() + upload_pitch * (y);
-		const auto line2 = upload_data.data() + upload_pitch * (texture.height - 1 - y);
-
-		std::memcpy(temp,  line1, upload_pitch);
-		std::memcpy(line1, line2, upload_pitch);
-		std::memcpy(line2, temp,  upload_pitch);
-	}
+	// Flip image data vertically by reading the rows from the bottom up
+	// Format conversion is left to the driver, since it accepts RGBA data for textures of any format
+	const unsigned int upload_pitch = texture.width * 4;
+	std::vector<uint8_t> upload_data(upload_pitch * texture.height);
+	convert_pixels(pixel_format::rgba8_unorm, pixels + upload_pitch * (texture.height - 1), -static_cast<ptrdiff_t>(upload_pitch), pixel_format::rgba8_unorm, upload_data.data(), upload_pitch, texture.width, texture.height);
 
 	// Get current state
 	GLint previous_tex = 0;
@@ -946,7 +941,10 @@ void reshade::opengl::runtime_gl::render_technique(technique &technique)
 	if (_effect_ubos[technique.effect_index] != 0)
 	{
 		glBindBufferBase(GL_UNIFORM_BUFFER, 0, _effect_ubos[technique.effect_index]);
-		glBufferSubData(GL_UNIFORM_BUFFER, 0, _effects[technique.effect_index].uniform_data_storage.size(), _effects[technique.effect_index].uniform_data_storage.data());
+
+		// The buffer keeps its contents, so only the modified ranges have to be written
+		for (size_t offset, size; consume_uniform_data_changes(technique.effect_index, offset, size);)
+			glBufferSubData(GL_UNIFORM_BUFFER, offset, size, _effects[technique.effect_index].uniform_data_storage.data() + offset);
 	}
 
 	// Set up shader resources
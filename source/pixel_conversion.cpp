@@ -0,0 +1,954 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "pixel_conversion.hpp"
+#include <cmath>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#define RESHADE_PIXEL_CONVERSION_X86 1
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define AVX2_FUNCTION
+	#else
+		#define AVX2_FUNCTION __attribute__((target("avx2")))
+	#endif
+#else
+	#define RESHADE_PIXEL_CONVERSION_X86 0
+#endif
+
+using reshade::pixel_format;
+using reshade::pixel_conversion_isa;
+
+// Row conversion kernel, which converts 'count' consecutive pixels
+using row_function = void(*)(const uint8_t *src, uint8_t *dst, size_t count);
+
+static inline uint32_t load_u32(const uint8_t *p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+static inline uint16_t load_u16(const uint8_t *p) { uint16_t v; std::memcpy(&v, p, 2); return v; }
+static inline float load_f32(const uint8_t *p) { float v; std::memcpy(&v, p, 4); return v; }
+static inline void store_u32(uint8_t *p, uint32_t v) { std::memcpy(p, &v, 4); }
+static inline void store_u16(uint8_t *p, uint16_t v) { std::memcpy(p, &v, 2); }
+static inline void store_f32(uint8_t *p, float v) { std::memcpy(p, &v, 4); }
+static inline uint32_t float_bits(float v) { uint32_t b; std::memcpy(&b, &v, 4); return b; }
+static inline float bits_float(uint32_t b) { float v; std::memcpy(&v, &b, 4); return v; }
+
+static float srgb_to_linear(double v)
+{
+	return static_cast<float>(v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4));
+}
+
+// Linear values below this always encode to an sRGB value of zero, above it the sRGB lookup table is indexed by exponent and the upper 7 bits of the mantissa
+static const uint32_t srgb_table_min_bits = 0x39000000; // 2^-13
+static const uint32_t srgb_table_shift = 23 - 7;
+static const uint32_t srgb_table_size = ((0x3F800000 - srgb_table_min_bits) >> srgb_table_shift) + 1;
+
+static const struct conversion_tables
+{
+	conversion_tables()
+	{
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			unorm8_to_float[i] = i / 255.0f;
+			srgb8_to_linear[i] = srgb_to_linear(i / 255.0);
+		}
+
+		// The encoded value changes from 'i' to 'i + 1' at the linear value of the midpoint between both
+		for (uint32_t i = 0; i < 255; ++i)
+			srgb8_thresholds[i] = srgb_to_linear((i + 0.5) / 255.0);
+		srgb8_thresholds[255] = 2.0f; // Never reached, since values are clamped to one
+
+		// Store the encoded value at the start of each bucket, the buckets are small enough that at most one threshold falls into each
+		for (uint32_t i = 0, code = 0; i < srgb_table_size; ++i)
+		{
+			const float bucket_start = bits_float(srgb_table_min_bits + (i << srgb_table_shift));
+			while (code < 255 && bucket_start >= srgb8_thresholds[code])
+				code++;
+			srgb8_table[i] = static_cast<uint8_t>(code);
+		}
+	}
+
+	float unorm8_to_float[256];
+	float srgb8_to_linear[256];
+	float srgb8_thresholds[256];
+	uint8_t srgb8_table[srgb_table_size];
+} s_tables;
+
+static inline float decode_unorm8(uint8_t v)
+{
+	return s_tables.unorm8_to_float[v];
+}
+static inline float decode_srgb8(uint8_t v)
+{
+	return s_tables.srgb8_to_linear[v];
+}
+
+static inline uint8_t encode_unorm8(float v)
+{
+	// Written so that NaN turns into zero, like it does in the vectorized versions below
+	v = v > 0.0f ? v : 0.0f;
+	v = v < 1.0f ? v : 1.0f;
+	return static_cast<uint8_t>(v * 255.0f + 0.5f);
+}
+static inline uint8_t encode_srgb8(float v)
+{
+	v = v > 0.0f ? v : 0.0f;
+	v = v < 1.0f ? v : 1.0f;
+
+	// Values below the table range all fall into the first bucket, whose threshold is above that range, so this needs no branch
+	const uint32_t bits = std::max(float_bits(v), srgb_table_min_bits);
+
+	const uint32_t code = s_tables.srgb8_table[(bits - srgb_table_min_bits) >> srgb_table_shift];
+	return static_cast<uint8_t>(code + (v >= s_tables.srgb8_thresholds[code]));
+}
+static inline uint16_t encode_unorm16(float v)
+{
+	v = v > 0.0f ? v : 0.0f;
+	v = v < 1.0f ? v : 1.0f;
+	return static_cast<uint16_t>(v * 65535.0f + 0.5f);
+}
+static inline uint32_t encode_unorm_bits(float v, float max)
+{
+	v = v > 0.0f ? v : 0.0f;
+	v = v < 1.0f ? v : 1.0f;
+	return static_cast<uint32_t>(v * max + 0.5f);
+}
+
+static inline float half_to_float(uint16_t h)
+{
+	// Shift exponent and mantissa into place and rebias the exponent
+	// Denormals are normalized by subtracting the implicit leading one again, so there is never any arithmetic on denormal floats (which is slow and affected by the flush-to-zero mode)
+	uint32_t bits = (h & 0x7FFFu) << 13;
+	const uint32_t exp = bits & 0x0F800000u;
+	bits += (127u - 15u) << 23;
+
+	if (exp == 0x0F800000u)
+		bits += (128u - 16u) << 23; // Infinity or NaN
+	else if (exp == 0)
+		bits = float_bits(bits_float(bits + (1u << 23)) - bits_float(113u << 23));
+
+	return bits_float(bits | ((h & 0x8000u) << 16));
+}
+static inline uint16_t float_to_half(float v)
+{
+	uint32_t f = float_bits(v);
+	const uint32_t sign = (f >> 16) & 0x8000u;
+	f &= 0x7FFFFFFFu;
+
+	uint32_t h;
+	if (f >= 0x47800000u)
+	{
+		h = f > 0x7F800000u ? 0x7E00u : 0x7C00u; // Overflow to infinity, NaN stays NaN
+	}
+	else if (f < 0x38800000u)
+	{
+		// Result is a denormal or zero, so let the floating-point unit shift the mantissa into place and round it
+		h = float_bits(bits_float(f) + 0.5f) - 0x3F000000u;
+	}
+	else
+	{
+		// Rebias the exponent and round to nearest even
+		f += ((15u - 127u) << 23) + 0xFFFu + ((f >> 13) & 1u);
+		h = f >> 13;
+	}
+
+	return static_cast<uint16_t>(h | sign);
+}
+
+// === Generic conversion ===
+// Decodes source pixels to linear floating-point RGBA and encodes them again, which works for any combination of formats
+
+static void decode_row(pixel_format format, const uint8_t *src, float *rgba, size_t count)
+{
+	switch (format)
+	{
+	case pixel_format::r8_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 1)
+			rgba[0] = decode_unorm8(src[0]), rgba[1] = 0.0f, rgba[2] = 0.0f, rgba[3] = 1.0f;
+		break;
+	case pixel_format::rg8_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 2)
+			rgba[0] = decode_unorm8(src[0]), rgba[1] = decode_unorm8(src[1]), rgba[2] = 0.0f, rgba[3] = 1.0f;
+		break;
+	case pixel_format::rgba8_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 4)
+			rgba[0] = decode_unorm8(src[0]), rgba[1] = decode_unorm8(src[1]), rgba[2] = decode_unorm8(src[2]), rgba[3] = decode_unorm8(src[3]);
+		break;
+	case pixel_format::rgba8_unorm_srgb:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 4)
+			rgba[0] = decode_srgb8(src[0]), rgba[1] = decode_srgb8(src[1]), rgba[2] = decode_srgb8(src[2]), rgba[3] = decode_unorm8(src[3]);
+		break;
+	case pixel_format::bgra8_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 4)
+			rgba[0] = decode_unorm8(src[2]), rgba[1] = decode_unorm8(src[1]), rgba[2] = decode_unorm8(src[0]), rgba[3] = decode_unorm8(src[3]);
+		break;
+	case pixel_format::bgra8_unorm_srgb:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 4)
+			rgba[0] = decode_srgb8(src[2]), rgba[1] = decode_srgb8(src[1]), rgba[2] = decode_srgb8(src[0]), rgba[3] = decode_unorm8(src[3]);
+		break;
+	case pixel_format::rgb10a2_unorm:
+	case pixel_format::bgr10a2_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 4)
+		{
+			const uint32_t p = load_u32(src);
+			const float c0 = (p & 0x3FF) / 1023.0f, c1 = ((p >> 10) & 0x3FF) / 1023.0f, c2 = ((p >> 20) & 0x3FF) / 1023.0f;
+			rgba[0] = format == pixel_format::rgb10a2_unorm ? c0 : c2;
+			rgba[1] = c1;
+			rgba[2] = format == pixel_format::rgb10a2_unorm ? c2 : c0;
+			rgba[3] = (p >> 30) / 3.0f;
+		}
+		break;
+	case pixel_format::rg16_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 4)
+			rgba[0] = load_u16(src) / 65535.0f, rgba[1] = load_u16(src + 2) / 65535.0f, rgba[2] = 0.0f, rgba[3] = 1.0f;
+		break;
+	case pixel_format::rgba16_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 8)
+			for (size_t c = 0; c < 4; ++c)
+				rgba[c] = load_u16(src + c * 2) / 65535.0f;
+		break;
+	case pixel_format::r16_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 2)
+			rgba[0] = half_to_float(load_u16(src)), rgba[1] = 0.0f, rgba[2] = 0.0f, rgba[3] = 1.0f;
+		break;
+	case pixel_format::rg16_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 4)
+			rgba[0] = half_to_float(load_u16(src)), rgba[1] = half_to_float(load_u16(src + 2)), rgba[2] = 0.0f, rgba[3] = 1.0f;
+		break;
+	case pixel_format::rgba16_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 8)
+			for (size_t c = 0; c < 4; ++c)
+				rgba[c] = half_to_float(load_u16(src + c * 2));
+		break;
+	case pixel_format::r32_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 4)
+			rgba[0] = load_f32(src), rgba[1] = 0.0f, rgba[2] = 0.0f, rgba[3] = 1.0f;
+		break;
+	case pixel_format::rg32_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, src += 8)
+			rgba[0] = load_f32(src), rgba[1] = load_f32(src + 4), rgba[2] = 0.0f, rgba[3] = 1.0f;
+		break;
+	case pixel_format::rgba32_float:
+		std::memcpy(rgba, src, count * 16);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+static void encode_row(pixel_format format, const float *rgba, uint8_t *dst, size_t count)
+{
+	switch (format)
+	{
+	case pixel_format::r8_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 1)
+			dst[0] = encode_unorm8(rgba[0]);
+		break;
+	case pixel_format::rg8_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 2)
+			dst[0] = encode_unorm8(rgba[0]), dst[1] = encode_unorm8(rgba[1]);
+		break;
+	case pixel_format::rgba8_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 4)
+			dst[0] = encode_unorm8(rgba[0]), dst[1] = encode_unorm8(rgba[1]), dst[2] = encode_unorm8(rgba[2]), dst[3] = encode_unorm8(rgba[3]);
+		break;
+	case pixel_format::rgba8_unorm_srgb:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 4)
+			dst[0] = encode_srgb8(rgba[0]), dst[1] = encode_srgb8(rgba[1]), dst[2] = encode_srgb8(rgba[2]), dst[3] = encode_unorm8(rgba[3]);
+		break;
+	case pixel_format::bgra8_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 4)
+			dst[0] = encode_unorm8(rgba[2]), dst[1] = encode_unorm8(rgba[1]), dst[2] = encode_unorm8(rgba[0]), dst[3] = encode_unorm8(rgba[3]);
+		break;
+	case pixel_format::bgra8_unorm_srgb:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 4)
+			dst[0] = encode_srgb8(rgba[2]), dst[1] = encode_srgb8(rgba[1]), dst[2] = encode_srgb8(rgba[0]), dst[3] = encode_unorm8(rgba[3]);
+		break;
+	case pixel_format::rgb10a2_unorm:
+	case pixel_format::bgr10a2_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 4)
+		{
+			const float r = format == pixel_format::rgb10a2_unorm ? rgba[0] : rgba[2];
+			const float b = format == pixel_format::rgb10a2_unorm ? rgba[2] : rgba[0];
+			store_u32(dst, encode_unorm_bits(r, 1023.0f) | (encode_unorm_bits(rgba[1], 1023.0f) << 10) | (encode_unorm_bits(b, 1023.0f) << 20) | (encode_unorm_bits(rgba[3], 3.0f) << 30));
+		}
+		break;
+	case pixel_format::rg16_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 4)
+			store_u16(dst, encode_unorm16(rgba[0])), store_u16(dst + 2, encode_unorm16(rgba[1]));
+		break;
+	case pixel_format::rgba16_unorm:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 8)
+			for (size_t c = 0; c < 4; ++c)
+				store_u16(dst + c * 2, encode_unorm16(rgba[c]));
+		break;
+	case pixel_format::r16_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 2)
+			store_u16(dst, float_to_half(rgba[0]));
+		break;
+	case pixel_format::rg16_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 4)
+			store_u16(dst, float_to_half(rgba[0])), store_u16(dst + 2, float_to_half(rgba[1]));
+		break;
+	case pixel_format::rgba16_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 8)
+			for (size_t c = 0; c < 4; ++c)
+				store_u16(dst + c * 2, float_to_half(rgba[c]));
+		break;
+	case pixel_format::r32_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 4)
+			store_f32(dst, rgba[0]);
+		break;
+	case pixel_format::rg32_float:
+		for (size_t i = 0; i < count; ++i, rgba += 4, dst += 8)
+			store_f32(dst, rgba[0]), store_f32(dst + 4, rgba[1]);
+		break;
+	case pixel_format::rgba32_float:
+		std::memcpy(dst, rgba, count * 16);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+static void convert_row_generic(pixel_format src_format, const uint8_t *src, pixel_format dst_format, uint8_t *dst, size_t count, bool force_opaque)
+{
+	const size_t src_size = reshade::pixel_format_size(src_format);
+	const size_t dst_size = reshade::pixel_format_size(dst_format);
+
+	// Work in small chunks, so that the intermediate data stays in the cache
+	// All source pixels of a chunk are decoded before any are written, so this also works in-place for formats of the same size
+	float rgba[64 * 4];
+	for (size_t offset = 0; offset < count; offset += 64)
+	{
+		const size_t chunk = std::min<size_t>(count - offset, 64);
+
+		decode_row(src_format, src + offset * src_size, rgba, chunk);
+
+		if (force_opaque)
+			for (size_t i = 0; i < chunk; ++i)
+				rgba[i * 4 + 3] = 1.0f;
+
+		encode_row(dst_format, rgba, dst + offset * dst_size, chunk);
+	}
+}
+
+// === Scalar kernels ===
+// These define the exact result of each specialized conversion, the vectorized versions below have to match them bit for bit
+
+template <size_t size>
+static void copy_scalar(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	std::memmove(dst, src, count * size);
+}
+
+template <bool swap_rb, bool opaque>
+static void swizzle_rgba8_scalar(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i, src += 4, dst += 4)
+	{
+		uint32_t p = load_u32(src);
+		if (swap_rb)
+			p = (p & 0xFF00FF00u) | ((p >> 16) & 0xFFu) | ((p & 0xFFu) << 16);
+		if (opaque)
+			p |= 0xFF000000u;
+		store_u32(dst, p);
+	}
+}
+
+template <bool swap_rb, bool opaque>
+static void unpack_rgb10a2_scalar(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i, src += 4, dst += 4)
+	{
+		const uint32_t p = load_u32(src);
+
+		// Drop the two least significant bits to get from 10-bit range (0-1023) into 8-bit range (0-255)
+		uint32_t c0 = (p >> 2) & 0xFFu;
+		const uint32_t c1 = (p >> 12) & 0xFFu;
+		uint32_t c2 = (p >> 22) & 0xFFu;
+		if (swap_rb)
+			std::swap(c0, c2);
+		const uint32_t a = opaque ? 0xFFu : (p >> 30) * 0x55u;
+
+		store_u32(dst, c0 | (c1 << 8) | (c2 << 16) | (a << 24));
+	}
+}
+
+static void extract_r8_scalar(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i, src += 4, dst += 1)
+		dst[0] = src[0];
+}
+static void extract_rg8_scalar(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i, src += 4, dst += 2)
+		dst[0] = src[0], dst[1] = src[1];
+}
+
+static void rgba8_to_float_scalar(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	for (size_t i = 0; i < count * 4; ++i, dst += 4)
+		store_f32(dst, decode_unorm8(src[i]));
+}
+
+template <bool srgb, bool opaque>
+static void half_to_rgba8_scalar(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i, src += 8, dst += 4)
+	{
+		for (size_t c = 0; c < 3; ++c)
+			dst[c] = srgb ? encode_srgb8(half_to_float(load_u16(src + c * 2))) : encode_unorm8(half_to_float(load_u16(src + c * 2)));
+		dst[3] = opaque ? 0xFF : encode_unorm8(half_to_float(load_u16(src + 6)));
+	}
+}
+
+#if RESHADE_PIXEL_CONVERSION_X86
+
+// === SSE2 kernels ===
+
+template <bool swap_rb, bool opaque>
+static inline __m128i swizzle_rgba8(__m128i p)
+{
+	if (swap_rb)
+	{
+		// Red and blue are two bytes apart, so shifting each 32-bit lane by 16 bits in both directions swaps them
+		const __m128i rb = _mm_andnot_si128(_mm_set1_epi32(0xFF00FF00), p);
+		p = _mm_or_si128(_mm_and_si128(p, _mm_set1_epi32(0xFF00FF00)), _mm_or_si128(_mm_srli_epi32(rb, 16), _mm_slli_epi32(rb, 16)));
+	}
+	if (opaque)
+		p = _mm_or_si128(p, _mm_set1_epi32(0xFF000000));
+	return p;
+}
+
+template <bool swap_rb, bool opaque>
+static void swizzle_rgba8_sse2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), swizzle_rgba8<swap_rb, opaque>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4))));
+
+	swizzle_rgba8_scalar<swap_rb, opaque>(src + i * 4, dst + i * 4, count - i);
+}
+
+template <bool swap_rb, bool opaque>
+static inline __m128i unpack_rgb10a2(__m128i p)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+
+	// Shift the upper 8 bits of each 10-bit channel directly into their target byte
+	const __m128i c0 = swap_rb ? _mm_and_si128(_mm_slli_epi32(p, 14), _mm_set1_epi32(0xFF0000)) : _mm_and_si128(_mm_srli_epi32(p, 2), mask);
+	const __m128i c1 = _mm_and_si128(_mm_srli_epi32(p, 4), _mm_set1_epi32(0xFF00));
+	const __m128i c2 = swap_rb ? _mm_srli_epi32(_mm_slli_epi32(p, 2), 24) : _mm_and_si128(_mm_srli_epi32(p, 6), _mm_set1_epi32(0xFF0000));
+
+	__m128i a;
+	if (opaque)
+	{
+		a = _mm_set1_epi32(0xFF000000);
+	}
+	else
+	{
+		// Replicate the 2-bit alpha value four times, which is the same as multiplying by 0x55
+		a = _mm_srli_epi32(p, 30);
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 2));
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 4));
+		a = _mm_slli_epi32(a, 24);
+	}
+
+	return _mm_or_si128(_mm_or_si128(c0, c1), _mm_or_si128(c2, a));
+}
+
+template <bool swap_rb, bool opaque>
+static void unpack_rgb10a2_sse2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), unpack_rgb10a2<swap_rb, opaque>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4))));
+
+	unpack_rgb10a2_scalar<swap_rb, opaque>(src + i * 4, dst + i * 4, count - i);
+}
+
+static void extract_r8_sse2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i p0 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 0)), mask);
+		const __m128i p1 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 16)), mask);
+		const __m128i p2 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 32)), mask);
+		const __m128i p3 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 48)), mask);
+
+		// Values fit into 8 bits, so the saturating packs do not change them
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3)));
+	}
+
+	extract_r8_scalar(src + i * 4, dst + i, count - i);
+}
+static void extract_rg8_sse2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	const __m128i mask = _mm_set1_epi32(0xFFFF);
+	const __m128i bias32 = _mm_set1_epi32(0x8000);
+	const __m128i bias16 = _mm_set1_epi16(-0x8000);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		// There is no unsigned 32 to 16-bit pack in SSE2, so move the values into signed range before packing and back afterwards
+		const __m128i p0 = _mm_sub_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 0)), mask), bias32);
+		const __m128i p1 = _mm_sub_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 16)), mask), bias32);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2), _mm_xor_si128(_mm_packs_epi32(p0, p1), bias16));
+	}
+
+	extract_rg8_scalar(src + i * 4, dst + i * 2, count - i);
+}
+
+static void rgba8_to_float_sse2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scale = _mm_set1_ps(255.0f);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+		const __m128i lo = _mm_unpacklo_epi8(p, zero);
+		const __m128i hi = _mm_unpackhi_epi8(p, zero);
+
+		// Divide instead of multiplying by the reciprocal, to get the same result as the lookup table
+		float *const out = reinterpret_cast<float *>(dst + i * 16);
+		_mm_storeu_ps(out + 0, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+		_mm_storeu_ps(out + 4, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+		_mm_storeu_ps(out + 8, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+		_mm_storeu_ps(out + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+	}
+
+	rgba8_to_float_scalar(src + i * 4, dst + i * 16, count - i);
+}
+
+static inline __m128 half_to_float(__m128i h)
+{
+	// Same algorithm as the scalar 'half_to_float' above, on four values stored in the lower half of each 32-bit lane
+	const __m128i expmant = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+	const __m128i exp = _mm_and_si128(_mm_slli_epi32(expmant, 13), _mm_set1_epi32(0x0F800000));
+	__m128i bits = _mm_add_epi32(_mm_slli_epi32(expmant, 13), _mm_set1_epi32((127 - 15) << 23));
+
+	bits = _mm_add_epi32(bits, _mm_and_si128(_mm_cmpeq_epi32(exp, _mm_set1_epi32(0x0F800000)), _mm_set1_epi32((128 - 16) << 23)));
+
+	const __m128i denormal_mask = _mm_cmpeq_epi32(exp, _mm_setzero_si128());
+	const __m128 denormal = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))), _mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+	bits = _mm_or_si128(_mm_andnot_si128(denormal_mask, bits), _mm_and_si128(denormal_mask, _mm_castps_si128(denormal)));
+
+	return _mm_castsi128_ps(_mm_or_si128(bits, _mm_slli_epi32(_mm_xor_si128(h, expmant), 16)));
+}
+static inline __m128i encode_unorm8(__m128 v)
+{
+	// Operand order matters for NaN handling, 'max' returns the second operand if either is NaN
+	v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+template <bool srgb, bool opaque>
+static void half_to_rgba8_sse2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i h0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 8 + 0));
+		const __m128i h1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 8 + 16));
+
+		__m128 v[4] = {
+			half_to_float(_mm_unpacklo_epi16(h0, zero)),
+			half_to_float(_mm_unpackhi_epi16(h0, zero)),
+			half_to_float(_mm_unpacklo_epi16(h1, zero)),
+			half_to_float(_mm_unpackhi_epi16(h1, zero)) };
+
+		__m128i p;
+		if (srgb)
+		{
+			// Encoding to sRGB needs table lookups, which have to be done one at a time without a gather instruction
+			alignas(16) float values[16];
+			for (int k = 0; k < 4; ++k)
+				_mm_store_ps(values + k * 4, v[k]);
+
+			alignas(16) uint8_t encoded[16];
+			for (int k = 0; k < 16; k += 4)
+			{
+				encoded[k + 0] = encode_srgb8(values[k + 0]);
+				encoded[k + 1] = encode_srgb8(values[k + 1]);
+				encoded[k + 2] = encode_srgb8(values[k + 2]);
+				encoded[k + 3] = encode_unorm8(values[k + 3]);
+			}
+			p = _mm_load_si128(reinterpret_cast<const __m128i *>(encoded));
+		}
+		else
+		{
+			p = _mm_packus_epi16(
+				_mm_packs_epi32(encode_unorm8(v[0]), encode_unorm8(v[1])),
+				_mm_packs_epi32(encode_unorm8(v[2]), encode_unorm8(v[3])));
+		}
+
+		if (opaque)
+			p = _mm_or_si128(p, _mm_set1_epi32(0xFF000000));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), p);
+	}
+
+	half_to_rgba8_scalar<srgb, opaque>(src + i * 8, dst + i * 4, count - i);
+}
+
+// === AVX2 kernels ===
+
+template <bool swap_rb, bool opaque>
+AVX2_FUNCTION static void swizzle_rgba8_avx2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	const __m256i mask_ga = _mm256_set1_epi32(0xFF00FF00);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+		if (swap_rb)
+		{
+			const __m256i rb = _mm256_andnot_si256(mask_ga, p);
+			p = _mm256_or_si256(_mm256_and_si256(p, mask_ga), _mm256_or_si256(_mm256_srli_epi32(rb, 16), _mm256_slli_epi32(rb, 16)));
+		}
+		if (opaque)
+			p = _mm256_or_si256(p, _mm256_set1_epi32(0xFF000000));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), p);
+	}
+
+	swizzle_rgba8_sse2<swap_rb, opaque>(src + i * 4, dst + i * 4, count - i);
+}
+
+template <bool swap_rb, bool opaque>
+AVX2_FUNCTION static void unpack_rgb10a2_avx2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+
+		const __m256i c0 = swap_rb ? _mm256_and_si256(_mm256_slli_epi32(p, 14), _mm256_set1_epi32(0xFF0000)) : _mm256_and_si256(_mm256_srli_epi32(p, 2), _mm256_set1_epi32(0xFF));
+		const __m256i c1 = _mm256_and_si256(_mm256_srli_epi32(p, 4), _mm256_set1_epi32(0xFF00));
+		const __m256i c2 = swap_rb ? _mm256_srli_epi32(_mm256_slli_epi32(p, 2), 24) : _mm256_and_si256(_mm256_srli_epi32(p, 6), _mm256_set1_epi32(0xFF0000));
+
+		__m256i a;
+		if (opaque)
+		{
+			a = _mm256_set1_epi32(0xFF000000);
+		}
+		else
+		{
+			a = _mm256_mullo_epi32(_mm256_srli_epi32(p, 30), _mm256_set1_epi32(0x55));
+			a = _mm256_slli_epi32(a, 24);
+		}
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_or_si256(_mm256_or_si256(c0, c1), _mm256_or_si256(c2, a)));
+	}
+
+	unpack_rgb10a2_sse2<swap_rb, opaque>(src + i * 4, dst + i * 4, count - i);
+}
+
+AVX2_FUNCTION static void rgba8_to_float_avx2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	const __m256 scale = _mm256_set1_ps(255.0f);
+
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2)
+	{
+		// Zero extend two pixels (eight channels) at a time straight to 32-bit integers
+		const __m256i p = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i * 4)));
+		_mm256_storeu_ps(reinterpret_cast<float *>(dst + i * 16), _mm256_div_ps(_mm256_cvtepi32_ps(p), scale));
+	}
+
+	rgba8_to_float_sse2(src + i * 4, dst + i * 16, count - i);
+}
+
+AVX2_FUNCTION static inline __m256 half_to_float(__m256i h)
+{
+	const __m256i expmant = _mm256_and_si256(h, _mm256_set1_epi32(0x7FFF));
+	const __m256i exp = _mm256_and_si256(_mm256_slli_epi32(expmant, 13), _mm256_set1_epi32(0x0F800000));
+	__m256i bits = _mm256_add_epi32(_mm256_slli_epi32(expmant, 13), _mm256_set1_epi32((127 - 15) << 23));
+
+	bits = _mm256_add_epi32(bits, _mm256_and_si256(_mm256_cmpeq_epi32(exp, _mm256_set1_epi32(0x0F800000)), _mm256_set1_epi32((128 - 16) << 23)));
+
+	const __m256i denormal_mask = _mm256_cmpeq_epi32(exp, _mm256_setzero_si256());
+	const __m256 denormal = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_add_epi32(bits, _mm256_set1_epi32(1 << 23))), _mm256_castsi256_ps(_mm256_set1_epi32(113 << 23)));
+	bits = _mm256_blendv_epi8(bits, _mm256_castps_si256(denormal), denormal_mask);
+
+	return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_slli_epi32(_mm256_xor_si256(h, expmant), 16)));
+}
+AVX2_FUNCTION static inline __m256i encode_unorm8(__m256 v)
+{
+	v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+	return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+}
+
+template <bool opaque>
+AVX2_FUNCTION static void half_to_unorm8_avx2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i v0 = encode_unorm8(half_to_float(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 8 + 0)))));
+		const __m256i v1 = encode_unorm8(half_to_float(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 8 + 16)))));
+		const __m256i v2 = encode_unorm8(half_to_float(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 8 + 32)))));
+		const __m256i v3 = encode_unorm8(half_to_float(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 8 + 48)))));
+
+		// The packs operate per 128-bit lane, which interleaves the pixels, so restore their order with a cross-lane permute
+		__m256i p = _mm256_packus_epi16(_mm256_packs_epi32(v0, v1), _mm256_packs_epi32(v2, v3));
+		p = _mm256_permutevar8x32_epi32(p, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+		if (opaque)
+			p = _mm256_or_si256(p, _mm256_set1_epi32(0xFF000000));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), p);
+	}
+
+	half_to_rgba8_sse2<false, opaque>(src + i * 8, dst + i * 4, count - i);
+}
+
+#endif
+
+// === Kernel selection ===
+
+static bool is_rgba8(pixel_format format)
+{
+	return format == pixel_format::rgba8_unorm || format == pixel_format::rgba8_unorm_srgb;
+}
+static bool is_bgra8(pixel_format format)
+{
+	return format == pixel_format::bgra8_unorm || format == pixel_format::bgra8_unorm_srgb;
+}
+static bool is_srgb(pixel_format format)
+{
+	return format == pixel_format::rgba8_unorm_srgb || format == pixel_format::bgra8_unorm_srgb;
+}
+static bool has_alpha(pixel_format format)
+{
+	switch (format)
+	{
+	case pixel_format::rgba8_unorm:
+	case pixel_format::rgba8_unorm_srgb:
+	case pixel_format::bgra8_unorm:
+	case pixel_format::bgra8_unorm_srgb:
+	case pixel_format::rgb10a2_unorm:
+	case pixel_format::bgr10a2_unorm:
+	case pixel_format::rgba16_unorm:
+	case pixel_format::rgba16_float:
+	case pixel_format::rgba32_float:
+		return true;
+	default:
+		return false;
+	}
+}
+
+template <template <bool, bool> typename kernel, bool a>
+static row_function select(bool b)
+{
+	return b ? kernel<a, true>::function : kernel<a, false>::function;
+}
+
+// Wrap each kernel family in a class template, so that the selection below can be written once for all instruction sets
+#define DEFINE_KERNEL_FAMILY(name, function_name) \
+	template <bool a, bool b> struct name##_scalar_kernel { static constexpr row_function function = &function_name##_scalar<a, b>; }; \
+	template <bool a, bool b> struct name##_sse2_kernel { static constexpr row_function function = &function_name##_sse2<a, b>; }; \
+	template <bool a, bool b> struct name##_avx2_kernel { static constexpr row_function function = &function_name##_avx2<a, b>; };
+
+#if RESHADE_PIXEL_CONVERSION_X86
+template <bool srgb, bool opaque> static void half_to_rgba8_avx2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	if (srgb) // There is no benefit from AVX2 when encoding to sRGB, since that is bound by the table lookups
+		half_to_rgba8_sse2<srgb, opaque>(src, dst, count);
+	else
+		half_to_unorm8_avx2<opaque>(src, dst, count);
+}
+
+DEFINE_KERNEL_FAMILY(swizzle, swizzle_rgba8)
+DEFINE_KERNEL_FAMILY(unpack, unpack_rgb10a2)
+DEFINE_KERNEL_FAMILY(half, half_to_rgba8)
+#endif
+
+static row_function find_kernel(pixel_format src_format, pixel_format dst_format, bool force_opaque, pixel_conversion_isa isa)
+{
+	// Forcing alpha to one only makes a difference if both formats have an alpha channel
+	const bool opaque = force_opaque && has_alpha(src_format) && has_alpha(dst_format);
+
+	if (src_format == dst_format && !opaque)
+	{
+		switch (reshade::pixel_format_size(src_format))
+		{
+		case 1: return &copy_scalar<1>;
+		case 2: return &copy_scalar<2>;
+		case 4: return &copy_scalar<4>;
+		case 8: return &copy_scalar<8>;
+		case 16: return &copy_scalar<16>;
+		}
+	}
+
+	enum { none, swizzle, swizzle_swap, unpack, unpack_swap, half, half_srgb, extract_r8, extract_rg8, to_float } kind = none;
+
+	// Conversions between formats with the same transfer function do not need to decode anything
+	if ((is_rgba8(src_format) && is_rgba8(dst_format)) || (is_bgra8(src_format) && is_bgra8(dst_format)))
+		kind = is_srgb(src_format) == is_srgb(dst_format) ? swizzle : none;
+	else if ((is_rgba8(src_format) && is_bgra8(dst_format)) || (is_bgra8(src_format) && is_rgba8(dst_format)))
+		kind = is_srgb(src_format) == is_srgb(dst_format) ? swizzle_swap : none;
+	else if (src_format == pixel_format::rgb10a2_unorm && (dst_format == pixel_format::rgba8_unorm || dst_format == pixel_format::bgra8_unorm))
+		kind = dst_format == pixel_format::rgba8_unorm ? unpack : unpack_swap;
+	else if (src_format == pixel_format::bgr10a2_unorm && (dst_format == pixel_format::rgba8_unorm || dst_format == pixel_format::bgra8_unorm))
+		kind = dst_format == pixel_format::bgra8_unorm ? unpack : unpack_swap;
+	else if (src_format == pixel_format::rgba16_float && (dst_format == pixel_format::rgba8_unorm || dst_format == pixel_format::rgba8_unorm_srgb))
+		kind = dst_format == pixel_format::rgba8_unorm ? half : half_srgb;
+	else if (src_format == pixel_format::rgba8_unorm && dst_format == pixel_format::r8_unorm)
+		kind = extract_r8;
+	else if (src_format == pixel_format::rgba8_unorm && dst_format == pixel_format::rg8_unorm)
+		kind = extract_rg8;
+	else if (src_format == pixel_format::rgba8_unorm && dst_format == pixel_format::rgba32_float)
+		kind = to_float;
+
+#if RESHADE_PIXEL_CONVERSION_X86
+	if (isa == pixel_conversion_isa::avx2)
+	{
+		switch (kind)
+		{
+		case swizzle: return select<swizzle_avx2_kernel, false>(opaque);
+		case swizzle_swap: return select<swizzle_avx2_kernel, true>(opaque);
+		case unpack: return select<unpack_avx2_kernel, false>(opaque);
+		case unpack_swap: return select<unpack_avx2_kernel, true>(opaque);
+		case half: return select<half_avx2_kernel, false>(opaque);
+		case half_srgb: return select<half_avx2_kernel, true>(opaque);
+		case extract_r8: return &extract_r8_sse2;
+		case extract_rg8: return &extract_rg8_sse2;
+		case to_float: return &rgba8_to_float_avx2;
+		default: return nullptr;
+		}
+	}
+	if (isa == pixel_conversion_isa::sse2)
+	{
+		switch (kind)
+		{
+		case swizzle: return select<swizzle_sse2_kernel, false>(opaque);
+		case swizzle_swap: return select<swizzle_sse2_kernel, true>(opaque);
+		case unpack: return select<unpack_sse2_kernel, false>(opaque);
+		case unpack_swap: return select<unpack_sse2_kernel, true>(opaque);
+		case half: return select<half_sse2_kernel, false>(opaque);
+		case half_srgb: return select<half_sse2_kernel, true>(opaque);
+		case extract_r8: return &extract_r8_sse2;
+		case extract_rg8: return &extract_rg8_sse2;
+		case to_float: return &rgba8_to_float_sse2;
+		default: return nullptr;
+		}
+	}
+#endif
+
+	switch (kind)
+	{
+	case swizzle: return opaque ? &swizzle_rgba8_scalar<false, true> : &swizzle_rgba8_scalar<false, false>;
+	case swizzle_swap: return opaque ? &swizzle_rgba8_scalar<true, true> : &swizzle_rgba8_scalar<true, false>;
+	case unpack: return opaque ? &unpack_rgb10a2_scalar<false, true> : &unpack_rgb10a2_scalar<false, false>;
+	case unpack_swap: return opaque ? &unpack_rgb10a2_scalar<true, true> : &unpack_rgb10a2_scalar<true, false>;
+	case half: return opaque ? &half_to_rgba8_scalar<false, true> : &half_to_rgba8_scalar<false, false>;
+	case half_srgb: return opaque ? &half_to_rgba8_scalar<true, true> : &half_to_rgba8_scalar<true, false>;
+	case extract_r8: return &extract_r8_scalar;
+	case extract_rg8: return &extract_rg8_scalar;
+	case to_float: return &rgba8_to_float_scalar;
+	default: return nullptr;
+	}
+}
+
+static pixel_conversion_isa s_isa_limit = pixel_conversion_isa::avx2;
+
+size_t reshade::pixel_format_size(pixel_format format)
+{
+	switch (format)
+	{
+	case pixel_format::r8_unorm:
+		return 1;
+	case pixel_format::rg8_unorm:
+	case pixel_format::r16_float:
+		return 2;
+	case pixel_format::rgba8_unorm:
+	case pixel_format::rgba8_unorm_srgb:
+	case pixel_format::bgra8_unorm:
+	case pixel_format::bgra8_unorm_srgb:
+	case pixel_format::rgb10a2_unorm:
+	case pixel_format::bgr10a2_unorm:
+	case pixel_format::rg16_unorm:
+	case pixel_format::rg16_float:
+	case pixel_format::r32_float:
+		return 4;
+	case pixel_format::rgba16_unorm:
+	case pixel_format::rgba16_float:
+	case pixel_format::rg32_float:
+		return 8;
+	case pixel_format::rgba32_float:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+bool reshade::convert_pixels(pixel_format src_format, const void *src, ptrdiff_t src_pitch, pixel_format dst_format, void *dst, ptrdiff_t dst_pitch, uint32_t width, uint32_t height, bool force_opaque)
+{
+	if (pixel_format_size(src_format) == 0 || pixel_format_size(dst_format) == 0)
+		return false;
+
+	const pixel_conversion_isa isa = std::min(pixel_conversion_supported_isa(), s_isa_limit);
+	const row_function kernel = find_kernel(src_format, dst_format, force_opaque, isa);
+
+	auto src_row = static_cast<const uint8_t *>(src);
+	auto dst_row = static_cast<uint8_t *>(dst);
+
+	for (uint32_t y = 0; y < height; ++y, src_row += src_pitch, dst_row += dst_pitch)
+	{
+		if (kernel != nullptr)
+			kernel(src_row, dst_row, width);
+		else
+			convert_row_generic(src_format, src_row, dst_format, dst_row, width, force_opaque);
+	}
+
+	return true;
+}
+
+pixel_conversion_isa reshade::pixel_conversion_supported_isa()
+{
+#if RESHADE_PIXEL_CONVERSION_X86
+	static const pixel_conversion_isa isa = []() {
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return pixel_conversion_isa::sse2;
+
+		// Check that the operating system saves the AVX registers too, not only that the processor supports AVX2
+		__cpuid(info, 1);
+		const bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+		__cpuidex(info, 7, 0);
+		const bool avx2 = (info[1] & (1 << 5)) != 0;
+
+		return os_avx && avx2 ? pixel_conversion_isa::avx2 : pixel_conversion_isa::sse2;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? pixel_conversion_isa::avx2 : pixel_conversion_isa::sse2;
+#endif
+	}();
+	return isa;
+#else
+	return pixel_conversion_isa::scalar;
+#endif
+}
+
+void reshade::pixel_conversion_limit_isa(pixel_conversion_isa isa)
+{
+	s_isa_limit = isa;
+}
@@ -0,0 +1,143 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace reshade
+{
+	/// <summary>
+	/// Memory layouts of pixel data the runtime reads back from or uploads to the GPU.
+	/// Channels are listed in memory order, so 'rgb10a2' has red in the lowest bits and 'bgr10a2' has blue in the lowest bits.
+	/// </summary>
+	enum class pixel_format
+	{
+		unknown,
+
+		r8_unorm,
+		rg8_unorm,
+		rgba8_unorm,
+		rgba8_unorm_srgb,
+		bgra8_unorm,
+		bgra8_unorm_srgb,
+		rgb10a2_unorm,
+		bgr10a2_unorm,
+		rg16_unorm,
+		rgba16_unorm,
+		r16_float,
+		rg16_float,
+		rgba16_float,
+		r32_float,
+		rg32_float,
+		rgba32_float,
+	};
+
+	/// <summary>
+	/// Instruction set extensions the conversion kernels can make use of.
+	/// </summary>
+	enum class pixel_conversion_isa
+	{
+		scalar,
+		sse2,
+		avx2,
+	};
+
+	/// <summary>
+	/// Get the size of a single pixel in bytes.
+	/// </summary>
+	/// <param name="format">The pixel format.</param>
+	size_t pixel_format_size(pixel_format format);
+
+	/// <summary>
+	/// Get the pixel format matching the memory layout of a texture with the specified effect texture format.
+	/// </summary>
+	/// <param name="format">The texture format.</param>
+	inline pixel_format pixel_format_from_texture_format(reshadefx::texture_format format)
+	{
+		switch (format)
+		{
+		case reshadefx::texture_format::r8:
+			return pixel_format::r8_unorm;
+		case reshadefx::texture_format::r16f:
+			return pixel_format::r16_float;
+		case reshadefx::texture_format::r32f:
+			return pixel_format::r32_float;
+		case reshadefx::texture_format::rg8:
+			return pixel_format::rg8_unorm;
+		case reshadefx::texture_format::rg16:
+			return pixel_format::rg16_unorm;
+		case reshadefx::texture_format::rg16f:
+			return pixel_format::rg16_float;
+		case reshadefx::texture_format::rg32f:
+			return pixel_format::rg32_float;
+		case reshadefx::texture_format::rgba8:
+			return pixel_format::rgba8_unorm;
+		case reshadefx::texture_format::rgba16:
+			return pixel_format::rgba16_unorm;
+		case reshadefx::texture_format::rgba16f:
+			return pixel_format::rgba16_float;
+		case reshadefx::texture_format::rgba32f:
+			return pixel_format::rgba32_float;
+		case reshadefx::texture_format::rgb10a2:
+			return pixel_format::rgb10a2_unorm;
+		default:
+			return pixel_format::unknown;
+		}
+	}
+
+	/// <summary>
+	/// Get the 8-bit RGBA format screenshots of a back buffer with the specified format are stored in.
+	/// 8-bit sRGB data is kept as is and floating-point data (which is linear) is encoded to sRGB, so that the image looks the same as on screen.
+	/// </summary>
+	/// <param name="format">The back buffer format.</param>
+	inline pixel_format pixel_format_for_screenshot(pixel_format format)
+	{
+		switch (format)
+		{
+		case pixel_format::rgba8_unorm_srgb:
+		case pixel_format::bgra8_unorm_srgb:
+		case pixel_format::r16_float:
+		case pixel_format::rg16_float:
+		case pixel_format::rgba16_float:
+		case pixel_format::r32_float:
+		case pixel_format::rg32_float:
+		case pixel_format::rgba32_float:
+			return pixel_format::rgba8_unorm_srgb;
+		default:
+			return pixel_format::rgba8_unorm;
+		}
+	}
+
+	/// <summary>
+	/// Convert a two-dimensional block of pixels from one format to another.
+	/// Values are converted as if sampled on the GPU and written to a render target, so sRGB formats are decoded to and encoded from linear values and missing channels are filled with zero (or one for alpha).
+	/// Common conversions (such as swizzles, 10-bit unpacking, channel extraction and half to 8-bit conversion) use vectorized kernels, all others go through a generic scalar path.
+	/// </summary>
+	/// <param name="src_format">The format of the source pixels.</param>
+	/// <param name="src">Pointer to the first row of source pixels.</param>
+	/// <param name="src_pitch">Offset in bytes between rows of source pixels. This may be negative to flip the image vertically.</param>
+	/// <param name="dst_format">The format to convert to.</param>
+	/// <param name="dst">Pointer to the first row of destination pixels. Source and destination may not overlap, unless they are the same and both formats are the same size.</param>
+	/// <param name="dst_pitch">Offset in bytes between rows of destination pixels.</param>
+	/// <param name="width">The number of pixels per row.</param>
+	/// <param name="height">The number of rows.</param>
+	/// <param name="force_opaque">Set to <c>true</c> to write an alpha value of one, regardless of the source alpha.</param>
+	/// <returns><c>true</c> if the conversion is supported, <c>false</c> if either format is unknown.</returns>
+	bool convert_pixels(pixel_format src_format, const void *src, ptrdiff_t src_pitch, pixel_format dst_format, void *dst, ptrdiff_t dst_pitch, uint32_t width, uint32_t height, bool force_opaque = false);
+
+	/// <summary>
+	/// Get the best instruction set extension supported by the current processor, which is used by <see cref="convert_pixels"/>.
+	/// </summary>
+	pixel_conversion_isa pixel_conversion_supported_isa();
+	/// <summary>
+	/// Limit the instruction set extensions used by <see cref="convert_pixels"/>, for testing and benchmarking.
+	/// The limit is clamped to what the current processor supports.
+	/// </summary>
+	/// <param name="isa">The best instruction set extension that may be used.</param>
+	void pixel_conversion_limit_isa(pixel_conversion_isa isa);
+}
@@ -0,0 +1,194 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "qoi_encoder.hpp"
+#include "task_pool.hpp"
+#include <cstring>
+#include <algorithm>
+
+// Aim for strips of about a quarter megabyte of input, which keeps each strip in cache and gives enough strips to balance across threads
+static const size_t s_pixels_per_strip = 64 * 1024;
+
+static inline uint32_t qoi_hash(uint32_t px)
+{
+	// Pixels are loaded as little-endian 32-bit values, so red is in the lowest byte
+	return ((px & 0xFF) * 3 + ((px >> 8) & 0xFF) * 5 + ((px >> 16) & 0xFF) * 7 + (px >> 24) * 11) & 63;
+}
+
+static size_t encode_qoi_strip(const uint8_t *pixels, size_t num_pixels, uint8_t *out)
+{
+	uint8_t *p = out;
+
+	// The decoder carries over the previous color and color index from the last strip, which the encoder of this strip does not know
+	// So start with an explicit color and only ever reference index entries that were written in this strip, since those match in the decoder
+	uint32_t index[64];
+	uint64_t index_valid = 0;
+
+	uint32_t prev;
+	std::memcpy(&prev, pixels, 4);
+	*p++ = 0xFF; // QOI_OP_RGBA
+	std::memcpy(p, pixels, 4);
+	p += 4;
+	index[qoi_hash(prev)] = prev;
+	index_valid |= 1ull << qoi_hash(prev);
+
+	uint32_t run = 0;
+	for (size_t i = 1; i < num_pixels; ++i)
+	{
+		uint32_t px;
+		std::memcpy(&px, pixels + i * 4, 4);
+
+		if (px == prev)
+		{
+			if (++run == 62)
+			{
+				*p++ = static_cast<uint8_t>(0xC0 | (run - 1)); // QOI_OP_RUN
+				run = 0;
+			}
+			continue;
+		}
+
+		if (run != 0)
+		{
+			*p++ = static_cast<uint8_t>(0xC0 | (run - 1)); // QOI_OP_RUN
+			run = 0;
+		}
+
+		const uint32_t hash = qoi_hash(px);
+		if ((index_valid >> hash) & 1 && index[hash] == px)
+		{
+			*p++ = static_cast<uint8_t>(hash); // QOI_OP_INDEX
+		}
+		else
+		{
+			index[hash] = px;
+			index_valid |= 1ull << hash;
+
+			if ((px >> 24) == (prev >> 24))
+			{
+				// Differences wrap around, as specified by the format
+				const int vr = static_cast<int8_t>((px & 0xFF) - (prev & 0xFF));
+				const int vg = static_cast<int8_t>(((px >> 8) & 0xFF) - ((prev >> 8) & 0xFF));
+				const int vb = static_cast<int8_t>(((px >> 16) & 0xFF) - ((prev >> 16) & 0xFF));
+				const int vg_r = vr - vg;
+				const int vg_b = vb - vg;
+
+				if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+				{
+					*p++ = static_cast<uint8_t>(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)); // QOI_OP_DIFF
+				}
+				else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8)
+				{
+					*p++ = static_cast<uint8_t>(0x80 | (vg + 32)); // QOI_OP_LUMA
+					*p++ = static_cast<uint8_t>((vg_r + 8) << 4 | (vg_b + 8));
+				}
+				else
+				{
+					*p++ = 0xFE; // QOI_OP_RGB
+					std::memcpy(p, &px, 3);
+					p += 3;
+				}
+			}
+			else
+			{
+				*p++ = 0xFF; // QOI_OP_RGBA
+				std::memcpy(p, &px, 4);
+				p += 4;
+			}
+		}
+
+		prev = px;
+	}
+
+	// Runs may not continue into the next strip, since that starts with an explicit color again
+	if (run != 0)
+		*p++ = static_cast<uint8_t>(0xC0 | (run - 1)); // QOI_OP_RUN
+
+	return p - out;
+}
+
+namespace
+{
+	// State shared between the calling thread and helper tasks, which may only start running after all strips have been encoded already
+	struct qoi_encode_job
+	{
+		const uint8_t *pixels;
+		size_t num_pixels;
+		size_t num_strips;
+		std::vector<std::vector<uint8_t>> strips;
+		std::atomic<size_t> next_strip = 0;
+		std::atomic<size_t> num_finished = 0;
+		std::mutex mutex;
+		std::condition_variable finished_condition;
+
+		void run()
+		{
+			for (size_t strip_index; (strip_index = next_strip++) < num_strips;)
+			{
+				const size_t offset = strip_index * s_pixels_per_strip;
+				const size_t count = std::min(s_pixels_per_strip, num_pixels - offset);
+
+				// Every pixel takes at most five bytes
+				std::vector<uint8_t> &out = strips[strip_index];
+				out.resize(count * 5);
+				out.resize(encode_qoi_strip(pixels + offset * 4, count, out.data()));
+
+				if (++num_finished == num_strips)
+				{
+					const std::lock_guard<std::mutex> lock(mutex);
+					finished_condition.notify_all();
+				}
+			}
+		}
+	};
+}
+
+std::vector<uint8_t> reshade::encode_qoi(const uint8_t *pixels, uint32_t width, uint32_t height, bool has_alpha, task_pool *pool)
+{
+	const size_t num_pixels = static_cast<size_t>(width) * height;
+
+	const auto job = std::make_shared<qoi_encode_job>();
+	job->pixels = pixels;
+	job->num_pixels = num_pixels;
+	job->num_strips = (num_pixels + s_pixels_per_strip - 1) / s_pixels_per_strip;
+	job->strips.resize(job->num_strips);
+
+	if (pool != nullptr && job->num_strips > 1)
+	{
+		std::vector<std::function<void()>> tasks;
+		for (size_t i = 0; i < std::min(pool->num_threads(), job->num_strips - 1); ++i)
+			tasks.push_back([job]() { job->run(); });
+		pool->submit(std::move(tasks));
+	}
+
+	job->run();
+
+	// Wait for strips that helper tasks are still working on
+	{	std::unique_lock<std::mutex> lock(job->mutex);
+		job->finished_condition.wait(lock, [&job]() { return job->num_finished == job->num_strips; });
+	}
+
+	size_t total_size = 14 + 8;
+	for (const std::vector<uint8_t> &strip : job->strips)
+		total_size += strip.size();
+
+	std::vector<uint8_t> data;
+	data.reserve(total_size);
+
+	// Header with magic, big-endian size, channel count and color space (zero is sRGB with linear alpha)
+	const uint8_t header[14] = { 'q', 'o', 'i', 'f',
+		static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16), static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+		static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16), static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+		static_cast<uint8_t>(has_alpha ? 4 : 3), 0 };
+	data.insert(data.end(), header, header + sizeof(header));
+
+	for (const std::vector<uint8_t> &strip : job->strips)
+		data.insert(data.end(), strip.begin(), strip.end());
+
+	const uint8_t end_marker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	data.insert(data.end(), end_marker, end_marker + sizeof(end_marker));
+
+	return data;
+}
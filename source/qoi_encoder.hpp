@@ -0,0 +1,26 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace reshade
+{
+	class task_pool;
+
+	/// <summary>
+	/// Encode an image to the lossless "Quite OK Image" format (https://qoiformat.org).
+	/// The image is split into strips of rows that are encoded independently and concatenated. Each strip starts with an explicit color and only references colors from within itself, so the result is a regular QOI file that any decoder reads.
+	/// </summary>
+	/// <param name="pixels">Pointer to the RGBA pixel data, with rows tightly packed.</param>
+	/// <param name="width">The width of the image in pixels.</param>
+	/// <param name="height">The height of the image in pixels.</param>
+	/// <param name="has_alpha">Set to <c>false</c> to mark the image as RGB in the file header, if all alpha values are one.</param>
+	/// <param name="pool">Optional pool to encode strips in parallel on. The calling thread encodes strips too, so this can be called from a task running on the same pool.</param>
+	/// <returns>The encoded file data.</returns>
+	std::vector<uint8_t> encode_qoi(const uint8_t *pixels, uint32_t width, uint32_t height, bool has_alpha, task_pool *pool = nullptr);
+}
@@ -8,11 +8,15 @@
 #include "runtime.hpp"
 #include "runtime_config.hpp"
 #include "runtime_objects.hpp"
+#include "effect_cache.hpp"
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
 #include "input.hpp"
+#include "task_pool.hpp"
+#include "qoi_encoder.hpp"
 #include <thread>
+#include <numeric>
 #include <cassert>
 #include <algorithm>
 #include <stb_image.h>
@@ -103,12 +107,16 @@ reshade::runtime::runtime() :
 	_reload_key_data(),
 	_effects_key_data(),
 	_screenshot_key_data(),
+	_frame_capture_key_data(),
 	_prev_preset_key_data(),
 	_next_preset_key_data(),
 	_screenshot_path(g_target_executable_path.parent_path())
 {
 	// Default shortcut PrtScrn
 	_screenshot_key_data[0] = 0x2C;
+	// Default shortcut Shift + PrtScrn
+	_frame_capture_key_data[0] = 0x2C;
+	_frame_capture_key_data[2] = true;
 
 	_configuration_path = g_reshade_dll_path;
 	_configuration_path.replace_extension(".ini");
@@ -129,7 +137,10 @@ reshade::runtime::runtime() :
 }
 reshade::runtime::~runtime()
 {
-	assert(_worker_threads.empty());
+	// Wait for any screenshots that are still being saved in the background
+	_screenshot_pool.reset();
+
+	assert(_worker_pool == nullptr || _worker_pool->is_idle());
 	assert(!_is_initialized && _techniques.empty());
 
 #if RESHADE_GUI
@@ -157,6 +168,11 @@ bool reshade::runtime::on_init(input::window_handle window)
 }
 void reshade::runtime::on_reset()
 {
+	stop_frame_capture();
+
+	// Back-ends release their readback resources after this, so finish all deferred captures now
+	finish_deferred_captures(true);
+
 	unload_effects();
 
 	if (!_is_initialized)
@@ -186,6 +202,10 @@ void reshade::runtime::on_present()
 	_last_frame_duration = current_time - _last_present_time;
 	_last_present_time = current_time;
 
+	// Read back captures from earlier frames and report screenshots that finished saving in the background since the last frame
+	finish_deferred_captures();
+	finish_screenshots();
+
 #ifndef _DEBUG
 	// Lock input so it cannot be modified by other threads while we are reading it here
 	const auto input_lock = _input->lock();
@@ -200,6 +220,14 @@ void reshade::runtime::on_present()
 		if (_input->is_key_pressed(_screenshot_key_data))
 			_should_save_screenshot = true; // Notify 'update_and_render_effects' that we want to save a screenshot
 
+		if (_input->is_key_pressed(_frame_capture_key_data))
+		{
+			if (_frame_capture == nullptr)
+				start_frame_capture();
+			else
+				stop_frame_capture();
+		}
+
 		// Do not allow the next shortcuts while effects are being loaded or compiled (since they affect that state)
 		if (!is_loading() && _reload_compile_queue.empty())
 		{
@@ -224,6 +252,9 @@ void reshade::runtime::on_present()
 		}
 	}
 
+	// Capture before the overlay is drawn, so that it does not show up in the recorded frames
+	update_frame_capture();
+
 #if RESHADE_GUI
 	// Draw overlay
 	draw_ui();
@@ -254,14 +285,20 @@ void reshade::runtime::on_present()
 	// Reset frame statistics
 	g_network_traffic = 0;
 	_drawcalls = _vertices = 0;
+	_uniform_bytes_uploaded = _uniform_uploads_skipped = 0;
 }
 
 bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t index)
 {
+	const std::chrono::high_resolution_clock::time_point load_start = std::chrono::high_resolution_clock::now();
+
 	effect &effect = _effects[index]; // Safe to access this multi-threaded, since this is the only call working on this effect
 	effect.source_file = path;
 	effect.compile_sucess = true;
 
+	// Modification times of the source file and all included files, so that changes to any of them can be detected later
+	std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> file_times;
+
 	{ // Load, pre-process and compile the source file
 		reshadefx::preprocessor pp;
 		if (path.is_absolute())
@@ -322,25 +359,56 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 		else
 			shader_model = 60;
 
-		std::unique_ptr<reshadefx::codegen> codegen;
-		if ((_renderer_id & 0xF0000) == 0)
-			codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, _performance_mode));
-		else if (_renderer_id < 0x20000)
-			codegen.reset(reshadefx::create_codegen_glsl(!_no_debug_info, _performance_mode));
-		else // Vulkan uses SPIR-V input
-			codegen.reset(reshadefx::create_codegen_spirv(true, !_no_debug_info, _performance_mode, true));
-
-		reshadefx::parser parser;
-
-		// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
-		if (!parser.parse(std::move(pp.output()), codegen.get()))
+		// Everything that influences code generation has to be part of the cache key, so that changing any of it never hits a stale entry
+		const std::string cache_settings =
+			"version=" VERSION_STRING_FILE " " VERSION_DATE " " VERSION_TIME
+			";renderer=" + std::to_string(_renderer_id) +
+			";shader_model=" + std::to_string(shader_model) +
+			";debug_info=" + (_no_debug_info ? '0' : '1') +
+			";spec_constants=" + (_performance_mode ? '1' : '0') +
+			";uniform_layout=" + (_uniform_layout_optimization ? '1' : '0') +
+			";spirv_optimization=" + (_spirv_optimization ? '1' : '0');
+
+		const reshadefx::module_cache cache(_no_effect_cache ? std::filesystem::path() : _intermediate_cache_path);
+
+		// Only successfully compiled modules are stored in the cache, so do not even look if the preprocessor failed already
+		std::string cached_warnings;
+		if (effect.compile_sucess && cache.load(pp.output(), cache_settings, effect.module, cached_warnings))
 		{
-			LOG(ERROR) << "Failed to compile " << path << ":\n" << pp.errors() << parser.errors();
-			effect.compile_sucess = false;
+			effect.errors = std::move(pp.errors()) + std::move(cached_warnings);
 		}
+		else
+		{
+			std::unique_ptr<reshadefx::codegen> codegen;
+			if ((_renderer_id & 0xF0000) == 0)
+				codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, _performance_mode));
+			else if (_renderer_id < 0x20000)
+				codegen.reset(reshadefx::create_codegen_glsl(!_no_debug_info, _performance_mode));
+			else // Vulkan uses SPIR-V input
+				codegen.reset(reshadefx::create_codegen_spirv(true, !_no_debug_info, _performance_mode, true, _spirv_optimization));
+
+			if (_uniform_layout_optimization)
+				codegen->optimize_uniform_layout();
+
+			reshadefx::parser parser;
+
+			// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
+			// The source is still needed afterwards to store the result in the cache, so cannot move it into the parser here
+			if (!parser.parse(pp.output(), codegen.get()))
+			{
+				LOG(ERROR) << "Failed to compile " << path << ":\n" << pp.errors() << parser.errors();
+				effect.compile_sucess = false;
+			}
+
+			// Write result to effect module
+			codegen->write_result(effect.module);
+
+			if (effect.compile_sucess && !cache.save(pp.output(), cache_settings, effect.module, parser.errors()) && !cache.directory().empty())
+				LOG(WARN) << "Failed to write " << path << " to effect cache in " << cache.directory() << '.';
 
-		// Append preprocessor and parser errors to the error list
-		effect.errors = std::move(pp.errors()) + std::move(parser.errors());
+			// Append preprocessor and parser errors to the error list
+			effect.errors = std::move(pp.errors()) + std::move(parser.errors());
+		}
 
 		// Keep track of used preprocessor definitions (so they can be displayed in the GUI)
 		for (const auto &definition : pp.used_macro_definitions())
@@ -355,8 +423,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 		effect.included_files = pp.included_files();
 		std::sort(effect.included_files.begin(), effect.included_files.end()); // Sort file names alphabetically
 
-		// Write result to effect module
-		codegen->write_result(effect.module);
+		// These were taken right before each file was read, so that a file modified while this effect is compiling is detected as modified again afterwards
+		file_times = pp.file_times();
 	}
 
 	// Fill all specialization constants with values from the current preset
@@ -415,6 +483,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 
 	// Create space for all variables (aligned to 16 bytes)
 	effect.uniform_data_storage.resize((effect.module.total_uniform_size + 15) & ~15);
+	effect.uniform_data_dirty_begin = 0;
+	effect.uniform_data_dirty_end = effect.uniform_data_storage.size();
 
 	for (uniform var : effect.module.uniforms)
 	{
@@ -448,6 +518,49 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 		else if (special == "bufready_depth")
 			var.special = special_uniform::bufready_depth;
 
+		if (var.special != special_uniform::none)
+		{
+			special_uniform_update update = {};
+			update.kind = var.special;
+			update.uniform_index = static_cast<uint32_t>(effect.uniforms.size());
+
+			switch (var.special)
+			{
+			case special_uniform::frame_count:
+				update.frame_count.as_boolean = var.type.is_boolean();
+				break;
+			case special_uniform::random:
+				update.random.min = var.annotation_as_int("min");
+				update.random.max = var.annotation_as_int("max");
+				break;
+			case special_uniform::ping_pong:
+				update.ping_pong.min = var.annotation_as_float("min");
+				update.ping_pong.max = var.annotation_as_float("max");
+				update.ping_pong.step_min = var.annotation_as_float("step", 0);
+				update.ping_pong.step_max = var.annotation_as_float("step", 1);
+				update.ping_pong.smoothing = var.annotation_as_float("smoothing");
+				break;
+			case special_uniform::key:
+			case special_uniform::mouse_button:
+				update.key.keycode = var.annotation_as_int("keycode");
+				if (const std::string_view mode = var.annotation_as_string("mode");
+					mode == "toggle" || var.annotation_as_int("toggle"))
+					update.key.mode = special_uniform_update::input_mode::toggle;
+				else if (mode == "press")
+					update.key.mode = special_uniform_update::input_mode::press;
+				else
+					update.key.mode = special_uniform_update::input_mode::down;
+
+				// Leave out keys that are out of range, since those are never updated anyway
+				if (var.special == special_uniform::key ? (update.key.keycode <= 7 || update.key.keycode >= 256) : (update.key.keycode < 0 || update.key.keycode >= 5))
+					update.kind = special_uniform::none;
+				break;
+			}
+
+			if (update.kind != special_uniform::none)
+				effect.special_uniforms.push_back(update);
+		}
+
 		effect.uniforms.push_back(std::move(var));
 	}
 
@@ -503,10 +616,15 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 						sampler_info.texture_name = existing_texture->unique_name;
 				// Overwrite referenced texture in render targets with the pooled one
 				for (auto &technique_info : effect.module.techniques)
+				{
 					for (auto &pass_info : technique_info.passes)
 						for (auto &target_name : pass_info.render_target_names)
 							if (target_name == texture.unique_name)
 								target_name = existing_texture->unique_name;
+					for (auto &texture_name : technique_info.texture_names)
+						if (texture_name == texture.unique_name)
+							texture_name = existing_texture->unique_name;
+				}
 
 				existing_texture->shared = true;
 				continue;
@@ -546,10 +664,31 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 		else
 			LOG(WARN) << "Successfully loaded " << path << " with warnings:\n" << effect.errors;
 
+	effect.compile_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - load_start).count();
+
+	// Still watch the source file if it could not be read at all, so that fixing it triggers a reload
+	if (file_times.empty())
+		file_times.emplace_back(path, std::filesystem::file_time_type::min());
+
 	{	const std::lock_guard<std::mutex> lock(_reload_mutex);
 		std::move(new_textures.begin(), new_textures.end(), std::back_inserter(_textures));
 		std::move(new_techniques.begin(), new_techniques.end(), std::back_inserter(_techniques));
 
+		for (const auto &file : file_times)
+		{
+			watched_file &watched = _watched_effect_files[file.first.u8string()];
+			// Another effect may have read a different version of a shared file, in which case force the next check to reload all effects that depend on it
+			if (!watched.effects.empty() && watched.modified != file.second)
+				watched.modified = std::filesystem::file_time_type::min();
+			else
+				watched.modified = file.second;
+			if (std::find(watched.effects.begin(), watched.effects.end(), index) == watched.effects.end())
+				watched.effects.push_back(index);
+		}
+
+		// Remember how long this file took, so that the next reload can schedule it accordingly
+		_effect_compile_times[path.u8string()] = effect.compile_duration;
+
 		_last_reload_successful &= effect.compile_sucess;
 		_reload_remaining_effects--;
 	}
@@ -588,17 +727,48 @@ bool reshade::runtime::load_effects()
 	// Allocate space for effects which are placed in this array during the 'load_effect' call
 	_effects.resize(_reload_total_effects);
 
+	// Estimate the cost of each file, so that the most expensive ones can be started first and do not end up delaying the whole reload
+	// Files that were compiled before use their last compile time, all others are estimated from their size using the average throughput so far
+	std::vector<uint64_t> effect_costs(effect_files.size());
+	std::vector<uintmax_t> effect_sizes(effect_files.size());
+	uint64_t known_duration = 0;
+	uintmax_t known_size = 0;
+
+	for (size_t i = 0; i < effect_files.size(); ++i)
+	{
+		std::error_code ec;
+		effect_sizes[i] = std::filesystem::file_size(effect_files[i], ec);
+
+		if (const auto it = _effect_compile_times.find(effect_files[i].u8string()); it != _effect_compile_times.end())
+		{
+			effect_costs[i] = it->second;
+			known_duration += it->second;
+			known_size += effect_sizes[i];
+		}
+	}
+
+	const uint64_t cost_per_byte = known_size != 0 ? std::max<uint64_t>(known_duration / known_size, 1) : 1;
+
+	for (size_t i = 0; i < effect_files.size(); ++i)
+		if (effect_costs[i] == 0)
+			effect_costs[i] = effect_sizes[i] * cost_per_byte;
+
+	std::vector<size_t> effect_order(effect_files.size());
+	std::iota(effect_order.begin(), effect_order.end(), size_t(0));
+	std::stable_sort(effect_order.begin(), effect_order.end(),
+		[&effect_costs](size_t lhs, size_t rhs) { return effect_costs[lhs] > effect_costs[rhs]; });
+
 	// Now that we have a list of files, load them in parallel
-	// Split workload into batches instead of launching a thread for every file to avoid launch overhead and stutters due to too many threads being in flight
-	const size_t num_splits = std::min<size_t>(effect_files.size(), std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1);
-
-	// Keep track of the spawned threads, so the runtime cannot be destroyed while they are still running
-	for (size_t n = 0; n < num_splits; ++n)
-		_worker_threads.emplace_back([this, effect_files, num_splits, n]() {
-			for (size_t i = 0; i < effect_files.size(); ++i)
-				if (i * num_splits / effect_files.size() == n)
-					load_effect(effect_files[i], i);
-		});
+	// The pool is kept alive across reloads to avoid launch overhead, and idle workers steal queued files from busy ones, so a single large file cannot hold back others
+	if (_worker_pool == nullptr)
+		_worker_pool = std::make_unique<task_pool>();
+
+	std::vector<std::function<void()>> tasks;
+	tasks.reserve(effect_order.size());
+	for (const size_t i : effect_order)
+		tasks.push_back([this, path = effect_files[i], i]() { load_effect(path, i); });
+
+	_worker_pool->submit(std::move(tasks));
 
 	return _last_reload_successful;
 }
@@ -610,6 +780,8 @@ void reshade::runtime::load_textures()
 	{
 		if (texture.impl == nullptr || texture.impl_reference != texture_reference::none)
 			continue; // Ignore textures that are not created yet and those that are handled in the runtime implementation
+		if (texture.loaded)
+			continue; // Ignore textures whose image data was uploaded before (e.g. those of other effects when only a single effect was reloaded)
 
 		std::filesystem::path source_path = std::filesystem::u8path(
 			texture.annotation_as_string("source"));
@@ -658,6 +830,8 @@ void reshade::runtime::load_textures()
 			upload_texture(texture, filedata);
 		}
 
+		texture.loaded = true;
+
 		stbi_image_free(filedata);
 	}
 
@@ -678,6 +852,18 @@ void reshade::runtime::unload_effect(size_t index)
 	_techniques.erase(std::remove_if(_techniques.begin(), _techniques.end(),
 		[index](const auto &it) { return it.effect_index == index; }), _techniques.end());
 
+	// Remove the effect from the reverse include graph again, it is added back with the current list of included files when it is loaded the next time
+	for (auto it = _watched_effect_files.begin(); it != _watched_effect_files.end();)
+	{
+		std::vector<size_t> &effects = it->second.effects;
+		effects.erase(std::remove(effects.begin(), effects.end(), index), effects.end());
+
+		if (effects.empty())
+			it = _watched_effect_files.erase(it);
+		else
+			++it;
+	}
+
 	// Do not clear source file, so that an 'unload_effect' immediately followed by a 'load_effect' which accesses that works
 	effect &effect = _effects[index];;
 	effect.rendering = false;
@@ -688,7 +874,11 @@ void reshade::runtime::unload_effect(size_t index)
 	effect.definitions.clear();
 	effect.assembly.clear();
 	effect.uniforms.clear();
+	effect.special_uniforms.clear();
 	effect.uniform_data_storage.clear();
+	effect.uniform_data_dirty_begin = effect.uniform_data_dirty_end = 0;
+	effect.per_frame_uniform_data_dirty = false;
+	effect.uniform_data_checked_frame = std::numeric_limits<uint64_t>::max();
 }
 void reshade::runtime::unload_effects()
 {
@@ -700,18 +890,79 @@ void reshade::runtime::unload_effects()
 #endif
 
 	// Make sure no threads are still accessing effect data
-	for (std::thread &thread : _worker_threads)
-		thread.join();
-	_worker_threads.clear();
+	if (_worker_pool != nullptr)
+		_worker_pool->wait();
 
 	_textures.clear();
 	_techniques.clear();
 
 	_effects.clear();
 
+	// Effect indices are no longer valid, so forget about all files and pending modifications
+	_watched_effect_files.clear();
+	_modified_effect_files.clear();
+
 	_textures_loaded = false;
 }
 
+bool reshade::runtime::is_technique_pending(const technique &technique, size_t index)
+{
+	return technique.effect_index == index && technique.enabled && technique.impl == nullptr;
+}
+bool reshade::runtime::is_entry_point_pending(size_t index, const std::string &entry_point) const
+{
+	for (const technique &technique : _techniques)
+		if (is_technique_pending(technique, index))
+			for (const reshadefx::pass_info &pass_info : technique.passes)
+				if (pass_info.vs_entry_point == entry_point || pass_info.ps_entry_point == entry_point)
+					return true;
+	return false;
+}
+
+bool reshade::runtime::consume_uniform_data_changes(size_t index, size_t &offset, size_t &size, bool whole_buffer)
+{
+	effect &effect = _effects[index];
+
+	// Only the first check of an effect in a frame says anything about whether an upload was skipped, later ones (for other techniques or the next range) find the data clean after an upload too
+	const bool first_check_in_frame = effect.uniform_data_checked_frame != _framecount;
+	effect.uniform_data_checked_frame = _framecount;
+
+	if (!effect.per_frame_uniform_data_dirty && effect.uniform_data_dirty_begin == effect.uniform_data_dirty_end)
+	{
+		if (first_check_in_frame)
+			_uniform_uploads_skipped++;
+		return false;
+	}
+
+	if (whole_buffer)
+	{
+		offset = 0;
+		size = effect.uniform_data_storage.size();
+
+		effect.per_frame_uniform_data_dirty = false;
+		effect.uniform_data_dirty_begin = effect.uniform_data_dirty_end = 0;
+	}
+	else if (effect.per_frame_uniform_data_dirty)
+	{
+		// Upload the block of uniforms updated every frame on its own, so that when only those changed, nothing else is uploaded with them
+		offset = 0;
+		size = effect.module.per_frame_uniform_size;
+
+		effect.per_frame_uniform_data_dirty = false;
+	}
+	else
+	{
+		offset = effect.uniform_data_dirty_begin;
+		size = effect.uniform_data_dirty_end - effect.uniform_data_dirty_begin;
+
+		effect.uniform_data_dirty_begin = effect.uniform_data_dirty_end = 0;
+	}
+
+	_uniform_bytes_uploaded += static_cast<unsigned int>(size);
+
+	return true;
+}
+
 void reshade::runtime::update_and_render_effects()
 {
 	// Delay first load to the first render call to avoid loading while the application is still initializing
@@ -720,10 +971,8 @@ void reshade::runtime::update_and_render_effects()
 
 	if (_reload_remaining_effects == 0)
 	{
-		// Clear the thread list now that they all have finished
-		for (std::thread &thread : _worker_threads)
-			thread.join(); // Threads have exited, but still need to join them prior destruction
-		_worker_threads.clear();
+		// All effects have been loaded, but wait for the tasks to return before accessing effect data without the lock
+		_worker_pool->wait();
 
 		// Finished loading effects, so apply preset to figure out which ones need compiling
 		load_current_preset();
@@ -745,11 +994,22 @@ void reshade::runtime::update_and_render_effects()
 			_reload_compile_queue.pop_back();
 			effect &effect = _effects[effect_index];
 
+			// Other techniques of this effect may already be rendering, so keep track of what is initialized now, to only clean that up again on failure
+			std::vector<technique *> pending_techniques;
+			for (technique &technique : _techniques)
+				if (is_technique_pending(technique, effect_index))
+					pending_techniques.push_back(&technique);
+			std::vector<texture *> created_textures;
+
 			// Create textures now, since they are referenced when building samplers in the 'init_effect' call below
+			// Textures of this effect that none of the techniques about to be initialized use are left out, until a technique that does is enabled
 			bool success = true;
 			for (texture &texture : _textures)
 			{
-				if (texture.impl == nullptr && (texture.effect_index == effect_index || texture.shared))
+				if (texture.impl == nullptr && (texture.shared || (texture.effect_index == effect_index &&
+					std::any_of(_techniques.begin(), _techniques.end(), [effect_index, &texture](const technique &technique) {
+						return is_technique_pending(technique, effect_index) &&
+							std::find(technique.texture_names.begin(), technique.texture_names.end(), texture.unique_name) != technique.texture_names.end(); }))))
 				{
 					if (!init_texture(texture))
 					{
@@ -757,6 +1017,8 @@ void reshade::runtime::update_and_render_effects()
 						effect.errors += "Failed to create texture " + texture.unique_name;
 						break;
 					}
+
+					created_textures.push_back(&texture);
 				}
 			}
 
@@ -784,16 +1046,22 @@ void reshade::runtime::update_and_render_effects()
 
 			if (!success) // Something went wrong, do clean up
 			{
-				// Destroy all textures belonging to this effect
-				for (texture &texture : _textures)
-					if (texture.effect_index == effect_index && !texture.shared)
-						texture.impl.reset();
-				// Disable all techniques belonging to this effect
-				for (technique &technique : _techniques)
-					if (technique.effect_index == effect_index)
-						disable_technique(technique);
+				// Destroy the textures created for the techniques that failed to initialize
+				// None of these were used for rendering yet, so there is no need to wait for the GPU, and textures of techniques that are already running are left alone
+				for (texture *texture : created_textures)
+					if (!texture->shared)
+						texture->impl.reset();
+				// Disable the techniques that failed to initialize and throw away anything the back-end created for them before failing
+				for (technique *technique : pending_techniques)
+				{
+					technique->impl.reset();
+					technique->passes_data.clear();
+					disable_technique(*technique);
+				}
 
-				effect.compile_sucess = false;
+				// Only mark the effect as failed when none of its techniques are running, so that the others stay usable
+				if (std::none_of(_techniques.begin(), _techniques.end(), [effect_index](const technique &technique) { return technique.effect_index == effect_index && technique.impl != nullptr; }))
+					effect.compile_sucess = false;
 				_last_reload_successful = false;
 			}
 
@@ -805,6 +1073,10 @@ void reshade::runtime::update_and_render_effects()
 			// Now that all effects were compiled, load all textures
 			load_textures();
 		}
+		else if (_auto_reload_effects)
+		{
+			reload_modified_effects();
+		}
 	}
 
 #ifndef _DEBUG
@@ -861,8 +1133,13 @@ void reshade::runtime::update_and_render_effects()
 				}
 				save_current_preset();
 			}
+		}
+
+		for (const special_uniform_update &update : effect.special_uniforms)
+		{
+			uniform &variable = effect.uniforms[update.uniform_index];
 
-			switch (variable.special)
+			switch (update.kind)
 			{
 				case special_uniform::frame_time:
 				{
@@ -871,7 +1148,7 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::frame_count:
 				{
-					if (variable.type.is_boolean())
+					if (update.frame_count.as_boolean)
 						set_uniform_value(variable, (_framecount % 2) == 0);
 					else
 						set_uniform_value(variable, static_cast<unsigned int>(_framecount % UINT_MAX));
@@ -879,19 +1156,19 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::random:
 				{
-					const int min = variable.annotation_as_int("min");
-					const int max = variable.annotation_as_int("max");
+					const int min = update.random.min;
+					const int max = update.random.max;
 					set_uniform_value(variable, min + (std::rand() % (max - min + 1)));
 					break;
 				}
 				case special_uniform::ping_pong:
 				{
-					const float min = variable.annotation_as_float("min");
-					const float max = variable.annotation_as_float("max");
-					const float step_min = variable.annotation_as_float("step", 0);
-					const float step_max = variable.annotation_as_float("step", 1);
+					const float min = update.ping_pong.min;
+					const float max = update.ping_pong.max;
+					const float step_min = update.ping_pong.step_min;
+					const float step_max = update.ping_pong.step_max;
 					float increment = step_max == 0 ? step_min : (step_min + std::fmodf(static_cast<float>(std::rand()), step_max - step_min + 1));
-					const float smoothing = variable.annotation_as_float("smoothing");
+					const float smoothing = update.ping_pong.smoothing;
 
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
@@ -927,24 +1204,25 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::key:
 				{
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode > 7 && keycode < 256)
+					switch (update.key.mode)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+					case special_uniform_update::input_mode::toggle:
+						if (_input->is_key_pressed(update.key.keycode))
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value, 1);
-							if (_input->is_key_pressed(keycode))
-								set_uniform_value(variable, !current_value);
+							set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_key_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_key_down(keycode));
+						break;
+					case special_uniform_update::input_mode::press:
+						set_uniform_value(variable, _input->is_key_pressed(update.key.keycode));
+						break;
+					case special_uniform_update::input_mode::down:
+						set_uniform_value(variable, _input->is_key_down(update.key.keycode));
+						break;
 					}
 					break;
-					}
+				}
 				case special_uniform::mouse_point:
 					set_uniform_value(variable, _input->mouse_position_x(), _input->mouse_position_y());
 					break;
@@ -953,21 +1231,22 @@ void reshade::runtime::update_and_render_effects()
 					break;
 				case special_uniform::mouse_button:
 				{
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode >= 0 && keycode < 5)
+					switch (update.key.mode)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+					case special_uniform_update::input_mode::toggle:
+						if (_input->is_mouse_button_pressed(update.key.keycode))
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value, 1);
-							if (_input->is_mouse_button_pressed(keycode))
-								set_uniform_value(variable, !current_value);
+							set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_mouse_button_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_mouse_button_down(keycode));
+						break;
+					case special_uniform_update::input_mode::press:
+						set_uniform_value(variable, _input->is_mouse_button_pressed(update.key.keycode));
+						break;
+					case special_uniform_update::input_mode::down:
+						set_uniform_value(variable, _input->is_mouse_button_down(update.key.keycode));
+						break;
 					}
 					break;
 				}
@@ -1013,6 +1292,99 @@ void reshade::runtime::update_and_render_effects()
 	}
 }
 
+void reshade::runtime::reload_modified_effects()
+{
+	// Wait for the previous check to finish before looking at its results or starting another one
+	if (_checking_effect_files || _worker_pool == nullptr)
+		return;
+
+	std::vector<std::string> modified_files;
+	{	const std::lock_guard<std::mutex> lock(_reload_mutex);
+		modified_files.swap(_modified_effect_files);
+	}
+
+	if (modified_files.empty())
+	{
+		const auto current_time = std::chrono::high_resolution_clock::now();
+		if (current_time - _last_effect_file_check_time < std::chrono::seconds(1))
+			return;
+		_last_effect_file_check_time = current_time;
+
+		// Take a snapshot of the watched files, so that the check can run on a worker thread without holding the lock
+		// Querying the modification time of hundreds of files can take several milliseconds, which would otherwise cause a hitch every time
+		std::vector<std::pair<std::string, std::filesystem::file_time_type>> files;
+		{	const std::lock_guard<std::mutex> lock(_reload_mutex);
+			files.reserve(_watched_effect_files.size());
+			for (const auto &file : _watched_effect_files)
+				files.emplace_back(file.first, file.second.modified);
+		}
+
+		_checking_effect_files = true;
+
+		std::vector<std::function<void()>> tasks;
+		tasks.push_back([this, files = std::move(files)]() {
+			std::vector<std::string> modified_files;
+			for (const auto &file : files)
+			{
+				std::error_code ec;
+				const std::filesystem::file_time_type modified = std::filesystem::last_write_time(std::filesystem::u8path(file.first), ec);
+				if (!ec && modified != file.second)
+					modified_files.push_back(file.first);
+			}
+
+			{	const std::lock_guard<std::mutex> lock(_reload_mutex);
+				_modified_effect_files = std::move(modified_files);
+			}
+
+			_checking_effect_files = false;
+		});
+		_worker_pool->submit(std::move(tasks));
+		return;
+	}
+
+	// Collect all effects that depend on any of the modified files
+	std::vector<size_t> effect_indices;
+	{	const std::lock_guard<std::mutex> lock(_reload_mutex);
+		for (const std::string &file : modified_files)
+			if (const auto it = _watched_effect_files.find(file); it != _watched_effect_files.end())
+				for (const size_t index : it->second.effects)
+					if (std::find(effect_indices.begin(), effect_indices.end(), index) == effect_indices.end())
+						effect_indices.push_back(index);
+	}
+
+	if (effect_indices.empty())
+		return;
+
+	LOG(INFO) << "Detected " << modified_files.size() << " modified file(s), reloading " << effect_indices.size() << " dependent effect(s) ...";
+
+	// Current variable values and enabled techniques are restored from the preset when loading finished in 'update_and_render_effects'
+	save_current_preset();
+
+#if RESHADE_GUI
+	// Hide splash bar when reloading only some effect files
+	_show_splash = false;
+#endif
+	_reload_total_effects = effect_indices.size();
+	_reload_remaining_effects = effect_indices.size();
+
+	// Forget about failures of the effects that are reloaded now, but keep reporting those of all other effects
+	_last_reload_successful = true;
+	for (size_t index = 0; index < _effects.size(); ++index)
+		if (std::find(effect_indices.begin(), effect_indices.end(), index) == effect_indices.end())
+			_last_reload_successful &= _effects[index].compile_sucess;
+
+	// All other effects keep their resources and techniques, only the dependent ones are unloaded and compiled again
+	std::vector<std::function<void()>> tasks;
+	tasks.reserve(effect_indices.size());
+	for (const size_t index : effect_indices)
+	{
+		unload_effect(index);
+		tasks.push_back([this, path = _effects[index].source_file, index]() { load_effect(path, index); });
+	}
+
+	_worker_pool->submit(std::move(tasks));
+}
+
 void reshade::runtime::enable_technique(technique &technique)
 {
 	if (!_effects[technique.effect_index].compile_sucess)
@@ -1067,6 +1439,7 @@ void reshade::runtime::load_config()
 	config.get("INPUT", "KeyReload", _reload_key_data);
 	config.get("INPUT", "KeyEffects", _effects_key_data);
 	config.get("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config.get("INPUT", "KeyFrameCapture", _frame_capture_key_data);
 	config.get("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
 	config.get("INPUT", "KeyNextPreset", _next_preset_key_data);
 
@@ -1081,9 +1454,27 @@ void reshade::runtime::load_config()
 	config.get("GENERAL", "ScreenshotSaveUI", _screenshot_save_ui);
 	config.get("GENERAL", "ScreenshotSaveBefore", _screenshot_save_before);
 	config.get("GENERAL", "ScreenshotIncludePreset", _screenshot_include_preset);
+	config.get("GENERAL", "ScreenshotMemoryBudget", _screenshot_memory_budget);
+	config.get("GENERAL", "FrameCaptureFormat", _frame_capture_format);
+	config.get("GENERAL", "FrameCaptureInterval", _frame_capture_interval);
+	config.get("GENERAL", "FrameCaptureLength", _frame_capture_length);
 
 	config.get("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.get("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.get("GENERAL", "NoEffectCache", _no_effect_cache);
+	config.get("GENERAL", "UniformLayoutOptimization", _uniform_layout_optimization);
+	config.get("GENERAL", "SPIRVOptimization", _spirv_optimization);
+	config.get("GENERAL", "AutoReloadEffects", _auto_reload_effects);
+	config.get("GENERAL", "IntermediateCachePath", _intermediate_cache_path);
+
+	if (_intermediate_cache_path.empty())
+	{
+		// Default to a directory in the temporary folder, which is shared between all applications
+		std::error_code ec;
+		_intermediate_cache_path = std::filesystem::temp_directory_path(ec);
+		if (!ec)
+			_intermediate_cache_path /= L"ReShade";
+	}
 
 	if (current_preset_path.empty())
 	{
@@ -1112,6 +1503,7 @@ void reshade::runtime::save_config() const
 	config.set("INPUT", "KeyReload", _reload_key_data);
 	config.set("INPUT", "KeyEffects", _effects_key_data);
 	config.set("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config.set("INPUT", "KeyFrameCapture", _frame_capture_key_data);
 	config.set("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
 	config.set("INPUT", "KeyNextPreset", _next_preset_key_data);
 
@@ -1126,9 +1518,18 @@ void reshade::runtime::save_config() const
 	config.set("GENERAL", "ScreenshotSaveUI", _screenshot_save_ui);
 	config.set("GENERAL", "ScreenshotSaveBefore", _screenshot_save_before);
 	config.set("GENERAL", "ScreenshotIncludePreset", _screenshot_include_preset);
+	config.set("GENERAL", "ScreenshotMemoryBudget", _screenshot_memory_budget);
+	config.set("GENERAL", "FrameCaptureFormat", _frame_capture_format);
+	config.set("GENERAL", "FrameCaptureInterval", _frame_capture_interval);
+	config.set("GENERAL", "FrameCaptureLength", _frame_capture_length);
 
 	config.set("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.set("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.set("GENERAL", "NoEffectCache", _no_effect_cache);
+	config.set("GENERAL", "UniformLayoutOptimization", _uniform_layout_optimization);
+	config.set("GENERAL", "SPIRVOptimization", _spirv_optimization);
+	config.set("GENERAL", "AutoReloadEffects", _auto_reload_effects);
+	config.set("GENERAL", "IntermediateCachePath", _intermediate_cache_path);
 
 	for (const auto &callback : _save_config_callables)
 		callback(config);
@@ -1375,56 +1776,442 @@ bool reshade::runtime::switch_to_next_preset(const std::filesystem::path &filter
 	return true;
 }
 
-void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool should_save_preset)
+bool reshade::runtime::capture_screenshot_deferred(capture_callback callback, bool allow_synchronous)
+{
+	readback_request &request = _readback_requests[_readback_next_slot];
+	if (request.pending || !_is_initialized)
+		return false;
+
+	request.frame = _framecount;
+	request.synchronous = !begin_readback(_readback_next_slot);
+	if (request.synchronous)
+	{
+		if (!allow_synchronous)
+			return false;
+
+		request.data.resize(_width * _height * 4);
+		if (!capture_screenshot(request.data.data()))
+			request.data.clear();
+	}
+
+	request.pending = true;
+	request.callback = std::move(callback);
+
+	_readback_next_slot = (_readback_next_slot + 1) % NUM_READBACK_SLOTS;
+
+	return true;
+}
+void reshade::runtime::finish_deferred_captures(bool flush)
 {
-	const int hour = _date[3] / 3600;
-	const int minute = (_date[3] - hour * 3600) / 60;
-	const int seconds = _date[3] - hour * 3600 - minute * 60;
+	// Slots are handed out round-robin, so starting at the next one visits requests from oldest to newest
+	for (unsigned int i = 0; i < NUM_READBACK_SLOTS; ++i)
+	{
+		const unsigned int slot = (_readback_next_slot + i) % NUM_READBACK_SLOTS;
+
+		readback_request &request = _readback_requests[slot];
+		if (!request.pending)
+			continue;
+		if (!flush && _framecount - request.frame < READBACK_LATENCY)
+			break; // All following requests are newer, so cannot be ready either
+
+		if (!request.synchronous)
+		{
+			request.data.resize(_width * _height * 4);
+			if (!finish_readback(slot, request.data.data()))
+				request.data.clear();
+		}
+
+		request.pending = false;
+
+		// Move everything out of the slot first, since the callback may queue another capture
+		const capture_callback callback = std::move(request.callback);
+		std::vector<uint8_t> data = std::move(request.data);
+		request.callback = nullptr;
+		request.data.clear();
+
+		callback(std::move(data), _width, _height);
+	}
+}
+
+static std::wstring build_capture_base_path(const std::filesystem::path &screenshot_path, const int date[4])
+{
+	const int hour = date[3] / 3600;
+	const int minute = (date[3] - hour * 3600) / 60;
+	const int seconds = date[3] - hour * 3600 - minute * 60;
 
 	char filename[21];
-	sprintf_s(filename, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", _date[0], _date[1], _date[2], hour, minute, seconds);
+	sprintf_s(filename, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", date[0], date[1], date[2], hour, minute, seconds);
+
+	return (screenshot_path.is_relative() ? g_target_executable_path.parent_path() / screenshot_path : screenshot_path) / g_target_executable_path.stem().concat(filename);
+}
+
+static const wchar_t *image_file_extension(unsigned int format)
+{
+	const wchar_t *const extensions[] = { L".bmp", L".png", L".qoi" };
+	return extensions[std::min<size_t>(format, std::size(extensions) - 1)];
+}
+
+static bool write_image_file(const std::filesystem::path &path, unsigned int format, const uint8_t *data, unsigned int width, unsigned int height, reshade::task_pool *pool)
+{
+	FILE *file;
+	if (_wfopen_s(&file, path.c_str(), L"wb") != 0)
+		return false;
+
+	const auto write_callback = [](void *context, void *data, int size) {
+		fwrite(data, 1, size, static_cast<FILE *>(context));
+	};
+
+	bool success = false;
+	switch (format)
+	{
+	case 0:
+		success = stbi_write_bmp_to_func(write_callback, file, width, height, 4, data) != 0;
+		break;
+	case 1:
+		success = stbi_write_png_to_func(write_callback, file, width, height, 4, data, 0) != 0;
+		break;
+	case 2:
+		// Screenshots are always opaque, so mark the image as RGB
+		if (const std::vector<uint8_t> encoded = reshade::encode_qoi(data, width, height, false, pool); !encoded.empty())
+			success = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+		break;
+	}
+
+	fclose(file);
+
+	return success;
+}
 
-	const std::wstring least = (_screenshot_path.is_relative() ? g_target_executable_path.parent_path() / _screenshot_path : _screenshot_path) / g_target_executable_path.stem().concat(filename);
-	const std::wstring screenshot_path = least + postfix + (_screenshot_format == 0 ? L".bmp" : L".png");
+void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool should_save_preset)
+{
+	const std::wstring least = build_capture_base_path(_screenshot_path, _date);
+	const std::wstring screenshot_path = least + postfix + image_file_extension(_screenshot_format);
 
 	LOG(INFO) << "Saving screenshot to " << screenshot_path << " ...";
 
-	_screenshot_save_success = false; // Default to a save failure unless it is reported to succeed below
+	screenshot_result result;
+	result.path = screenshot_path;
 
-	if (std::vector<uint8_t> data(_width * _height * 4); capture_screenshot(data.data()))
+	// Take a copy of the preset right away, since it may be switched or modified before the screenshot has finished saving
+	if (_screenshot_include_preset && should_save_preset && ini_file::flush_cache(_current_preset_path))
 	{
-		if (FILE *file; _wfopen_s(&file, screenshot_path.c_str(), L"wb") == 0)
+		if (FILE *file; _wfopen_s(&file, _current_preset_path.c_str(), L"rb") == 0)
 		{
-			const auto write_callback = [](void *context, void *data, int size) {
-				fwrite(data, 1, size, static_cast<FILE *>(context));
-			};
+			char buffer[4096];
+			for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) != 0;)
+				result.preset_data.append(buffer, read);
+			fclose(file);
 
-			switch (_screenshot_format)
+			result.preset_path = least + L".ini";
+		}
+	}
+
+	// This is called on the present thread once the image data is available, which for deferred captures is a few frames later
+	const auto save = [this, result = std::move(result), format = _screenshot_format](std::vector<uint8_t> &&data, unsigned int width, unsigned int height) {
+		if (data.empty())
+		{
+			LOG(ERROR) << "Failed to capture screenshot!";
+
+			_screenshot_save_success = false;
+			_last_screenshot_file = result.path;
+			_last_screenshot_time = std::chrono::high_resolution_clock::now();
+			return;
+		}
+
+		const size_t data_size = data.size();
+
+		{	// Bound the memory held by screenshots and captured frames that are still being encoded, by dropping new ones when a burst exceeds the budget
+			// Waiting for earlier ones to finish instead would stall the application, which is what encoding in the background is supposed to avoid
+			// A single screenshot is always accepted, even if it is larger than the budget on its own
+			const size_t budget = static_cast<size_t>(_screenshot_memory_budget) * 1024 * 1024;
+			if (_screenshot_pending_bytes != 0 && _screenshot_pending_bytes + data_size > budget)
 			{
-			case 0:
-				_screenshot_save_success = stbi_write_bmp_to_func(write_callback, file, _width, _height, 4, data.data()) != 0;
-				break;
-			case 1:
-				_screenshot_save_success = stbi_write_png_to_func(write_callback, file, _width, _height, 4, data.data(), 0) != 0;
-				break;
+				LOG(ERROR) << "Screenshot memory budget exceeded. Dropping screenshot " << result.path << " since previous screenshots or captured frames are still being saved!";
+
+				_screenshot_save_success = false;
+				_last_screenshot_file = result.path;
+				_last_screenshot_time = std::chrono::high_resolution_clock::now();
+				return;
 			}
 
+			_screenshot_pending_bytes += data_size;
+		}
+
+		// Only the capture happens on the present thread, encoding and writing the file is done in the background
+		// The result is picked up again in 'on_present', so that the user interface state is only ever modified on the present thread
+		// Use up to half of the hardware threads, so that encoding does not compete too much with the application
+		if (_screenshot_pool == nullptr)
+			_screenshot_pool = std::make_unique<task_pool>(std::max(std::thread::hardware_concurrency() / 2, 2u));
+
+		std::vector<std::function<void()>> tasks;
+		tasks.push_back([this, result, data = std::move(data), width, height, format, pool = _screenshot_pool.get()]() mutable {
+			const auto encode_start = std::chrono::high_resolution_clock::now();
+
+			// Encoding is split across the pool, with this task working on it too, so that a single large screenshot finishes quickly
+			result.success = write_image_file(result.path, format, data.data(), width, height, pool);
+
+			const size_t data_size = data.size();
+			result.data_size = data_size;
+			result.encode_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - encode_start);
+			data = std::vector<uint8_t>(); // Release the pixel data before reporting back, so that it no longer counts against the budget
+
+			_screenshot_pending_bytes -= data_size;
+
+			const std::lock_guard<std::mutex> lock(_screenshot_mutex);
+			_screenshot_results.push_back(std::move(result));
+		});
+
+		_screenshot_pool->submit(std::move(tasks));
+	};
+
+	// Prefer reading back the image a few frames later, so that the capture does not have to wait for the GPU
+	// Fall back to a synchronous capture when too many captures are still in flight
+	if (!capture_screenshot_deferred(save))
+	{
+		std::vector<uint8_t> data(_width * _height * 4);
+		if (!capture_screenshot(data.data()))
+			data.clear();
+
+		save(std::move(data), _width, _height);
+	}
+}
+void reshade::runtime::finish_screenshots()
+{
+	std::vector<screenshot_result> results;
+	{	const std::lock_guard<std::mutex> lock(_screenshot_mutex);
+		if (_screenshot_results.empty())
+			return;
+		results.swap(_screenshot_results);
+	}
+
+	for (const screenshot_result &result : results)
+	{
+		_screenshot_save_success = result.success;
+		_last_screenshot_file = result.path;
+		_last_screenshot_time = std::chrono::high_resolution_clock::now();
+
+		if (!result.success)
+		{
+			LOG(ERROR) << "Failed to write screenshot to " << result.path << '!';
+			continue;
+		}
+
+		// Throughput is measured on the uncompressed image data, so that it is comparable between formats
+		const double encode_seconds = std::max(std::chrono::duration<double>(result.encode_time).count(), 1e-6);
+		LOG(INFO) << "Saved screenshot to " << result.path << " in " << (encode_seconds * 1000.0) << " ms (" << (result.data_size / encode_seconds / 1e6) << " MB/s).";
+
+		if (FILE *file; !result.preset_path.empty() && _wfopen_s(&file, result.preset_path.c_str(), L"wb") == 0)
+		{
+			// Write the preset as it was when the screenshot was taken next to the image
+			fwrite(result.preset_data.data(), 1, result.preset_data.size(), file);
 			fclose(file);
 		}
 	}
+}
+
+void reshade::runtime::start_frame_capture()
+{
+	if (_frame_capture != nullptr || !_is_initialized)
+		return;
+
+	// Capturing frames synchronously would stall the application on every captured frame, so only support back-ends that can read back deferred
+	if (!supports_readback())
+	{
+		LOG(ERROR) << "Frame capture is not supported on this graphics API, since it cannot read back frames without waiting for the GPU.";
+		return;
+	}
+
+	const auto capture = std::make_shared<frame_capture>();
+	capture->format = _frame_capture_format;
+	capture->image_format = _screenshot_format;
+	capture->width = _width;
+	capture->height = _height;
+	capture->interval = std::max(_frame_capture_interval, 1u);
+	capture->length = _frame_capture_length;
+	capture->start_frame = _framecount;
+	capture->memory_budget = static_cast<size_t>(_screenshot_memory_budget) * 1024 * 1024;
+	capture->pending_bytes = &_screenshot_pending_bytes;
 
-	_last_screenshot_file = screenshot_path;
-	_last_screenshot_time = std::chrono::high_resolution_clock::now();
+	if (_screenshot_pool == nullptr)
+		_screenshot_pool = std::make_unique<task_pool>(std::max(std::thread::hardware_concurrency() / 2, 2u));
+	capture->pool = _screenshot_pool.get();
 
-	if (!_screenshot_save_success)
+	const std::wstring least = build_capture_base_path(_screenshot_path, _date);
+
+	if (capture->format == 1)
 	{
-		LOG(ERROR) << "Failed to write screenshot to " << screenshot_path << '!';
+		// Raw streams have no header, so put the frame size into the file name instead (e.g. for "ffmpeg -f rawvideo -pixel_format rgba -video_size WxH")
+		capture->path = least + L' ' + std::to_wstring(_width) + L'x' + std::to_wstring(_height) + L".rgba";
+		if (_wfopen_s(&capture->raw_file, capture->path.c_str(), L"wb") != 0)
+		{
+			LOG(ERROR) << "Failed to open " << capture->path << " for frame capture!";
+			return;
+		}
 	}
-	else if (_screenshot_include_preset && should_save_preset && ini_file::flush_cache(_current_preset_path))
+	else
 	{
-		// Preset was flushed to disk, so can just copy it over to the new location
-		std::error_code ec; std::filesystem::copy_file(_current_preset_path, least + L".ini", std::filesystem::copy_options::overwrite_existing, ec);
+		// Image sequences go into their own directory, with files numbered by their position in the sequence
+		// Frames are encoded in parallel, since the file name already defines their order
+		capture->path = least;
+		capture->max_encoders = static_cast<unsigned int>(capture->pool->num_threads());
+		if (std::error_code ec; !std::filesystem::create_directories(capture->path, ec) && ec.value() != 0)
+		{
+			LOG(ERROR) << "Failed to create directory " << capture->path << " for frame capture!";
+			return;
+		}
 	}
+
+	LOG(INFO) << "Starting frame capture to " << capture->path << " ...";
+
+	_frame_capture = capture;
+}
+void reshade::runtime::stop_frame_capture()
+{
+	if (_frame_capture == nullptr)
+		return;
+
+	LOG(INFO) << "Stopping frame capture after " << _frame_capture->num_requested << " frames ...";
+
+	// Frames that are still being read back or encoded keep the capture alive until they are written
+	_frame_capture.reset();
+}
+void reshade::runtime::update_frame_capture()
+{
+	if (_frame_capture == nullptr)
+		return;
+
+	if (_frame_capture->width != _width || _frame_capture->height != _height)
+	{
+		LOG(WARN) << "Frame size changed during frame capture.";
+		stop_frame_capture();
+		return;
+	}
+
+	const uint64_t frame = _framecount - _frame_capture->start_frame;
+	if (frame % _frame_capture->interval != 0)
+		return;
+
+	const uint64_t index = frame / _frame_capture->interval;
+	_frame_capture->num_requested++;
+
+	// Never fall back to a synchronous capture here (e.g. when creating a staging resource failed), since that would stall the application on every captured frame
+	// Dropped frames leave a gap in the numbering, so that the same index always refers to the same point in time across multiple captures
+	if (!capture_screenshot_deferred([capture = _frame_capture, index](std::vector<uint8_t> &&data, unsigned int, unsigned int) {
+			captured_frame frame;
+			frame.index = index;
+			frame.data = std::move(data);
+			capture->push_frame(frame);
+		}, false))
+		_frame_capture->num_dropped++;
+
+	if (_frame_capture->length != 0 && _frame_capture->num_requested == _frame_capture->length)
+		stop_frame_capture();
+}
+
+reshade::runtime::frame_capture::~frame_capture()
+{
+	if (num_requested != 0)
+		LOG(INFO) << "Finished frame capture to " << path << " with " << num_written.load() << " frames written and " << num_dropped.load() << " frames dropped" << (raw_file != nullptr ? " (written as blank frames)." : ".");
+
+	if (raw_file != nullptr)
+	{
+		// Frames dropped at the end of the capture were not followed by another frame that filled them in
+		write_raw_gap(num_requested);
+		fclose(raw_file);
+	}
+}
+
+void reshade::runtime::frame_capture::push_frame(captured_frame &frame)
+{
+	const size_t data_size = frame.data.size();
+
+	// Drop the frame instead of waiting for the encoders to catch up, so that recording never stalls the application
+	// A single frame is always accepted, even if it is larger than the budget on its own
+	if (data_size == 0 || (*pending_bytes != 0 && *pending_bytes + data_size > memory_budget))
+	{
+		num_dropped++;
+		return;
+	}
+
+	*pending_bytes += data_size;
+	if (!queue.try_push(frame))
+	{
+		*pending_bytes -= data_size;
+		num_dropped++;
+		return;
+	}
+
+	// Start another encoder if fewer than the maximum are running, otherwise one of those picks up the frame
+	for (unsigned int count = num_encoders; count < max_encoders;)
+	{
+		if (num_encoders.compare_exchange_weak(count, count + 1))
+		{
+			pool->submit({ [capture = shared_from_this()]() { capture->encode_frames(); } });
+			break;
+		}
+	}
+}
+void reshade::runtime::frame_capture::encode_frames()
+{
+	for (captured_frame frame;;)
+	{
+		while (queue.try_pop(frame))
+		{
+			const size_t data_size = frame.data.size();
+
+			bool success = false;
+			if (raw_file != nullptr)
+			{
+				// Raw streams have no frame numbers, so fill in dropped frames to keep every following frame at its position in time
+				success = write_raw_gap(frame.index) && fwrite(frame.data.data(), 1, data_size, raw_file) == data_size;
+				next_raw_index = frame.index + 1;
+			}
+			else
+			{
+				wchar_t filename[32];
+				swprintf_s(filename, L"%.6llu%ls", static_cast<unsigned long long>(frame.index), image_file_extension(image_format));
+
+				// Frames are already encoded in parallel, so do not split up each frame any further
+				success = write_image_file(path / filename, image_format, frame.data.data(), width, height, nullptr);
+			}
+
+			frame.data = std::vector<uint8_t>(); // Release the pixel data right away, so that it no longer counts against the budget
+			*pending_bytes -= data_size;
+
+			if (success)
+				num_written++;
+			else if (!write_failed.exchange(true))
+				LOG(ERROR) << "Failed to write frame " << frame.index << " to " << path << '!';
+		}
+
+		num_encoders--;
+
+		// A frame may have been pushed after the queue was found empty, but before this encoder was counted as finished, in which case no new encoder was started for it
+		// So check again and continue working if that happened and no other encoder can take care of it
+		if (queue.empty())
+			break;
+
+		unsigned int count = num_encoders;
+		while (count < max_encoders && !num_encoders.compare_exchange_weak(count, count + 1))
+			continue;
+		if (count >= max_encoders)
+			break;
+	}
+}
+
+bool reshade::runtime::frame_capture::write_raw_gap(uint64_t index)
+{
+	if (next_raw_index >= index)
+		return true;
+
+	// Write each blank frame row by row, so that a long gap does not need a buffer for a whole frame
+	const std::vector<uint8_t> blank_row(width * 4);
+	for (; next_raw_index < index; ++next_raw_index)
+		for (unsigned int y = 0; y < height; ++y)
+			if (fwrite(blank_row.data(), 1, blank_row.size(), raw_file) != blank_row.size())
+				return false;
+
+	return true;
 }
 
 static inline bool force_floating_point_value(const reshadefx::type &type, uint32_t renderer_id)
@@ -1436,6 +2223,27 @@ static inline bool force_floating_point_value(const reshadefx::type &type, uint3
 	return false;
 }
 
+static inline void mark_uniform_data_modified(reshade::effect &effect, size_t offset, size_t size)
+{
+	// The optimized layout places uniforms updated every frame at the start of the buffer, so anything there is uploaded as part of that block
+	if (offset < effect.module.per_frame_uniform_size)
+	{
+		effect.per_frame_uniform_data_dirty = true;
+		return;
+	}
+
+	if (effect.uniform_data_dirty_begin == effect.uniform_data_dirty_end)
+	{
+		effect.uniform_data_dirty_begin = offset;
+		effect.uniform_data_dirty_end = offset + size;
+	}
+	else
+	{
+		effect.uniform_data_dirty_begin = std::min(effect.uniform_data_dirty_begin, offset);
+		effect.uniform_data_dirty_end = std::max(effect.uniform_data_dirty_end, offset + size);
+	}
+}
+
 void reshade::runtime::get_uniform_value(const uniform &variable, uint8_t *data, size_t size) const
 {
 	assert(data != nullptr);
@@ -1520,22 +2328,40 @@ void reshade::runtime::set_uniform_value(uniform &variable, const uint8_t *data,
 
 	size = std::min(size, static_cast<size_t>(variable.size));
 
-	auto &data_storage = _effects[variable.effect_index].uniform_data_storage;
+	effect &effect = _effects[variable.effect_index];
+	auto &data_storage = effect.uniform_data_storage;
 	assert(variable.offset + size <= data_storage.size());
 
+	// Only mark the data as modified if it actually changed, since many values are set again every frame with the same value
+	bool modified = false;
+
 	if (variable.type.is_matrix())
 	{
 		assert((size % 4) == 0);
 
 		// Each row of a matrix is 16-byte aligned, so needs special handling
 		for (size_t row = 0, i = 0; row < variable.type.rows; ++row)
+		{
 			for (size_t col = 0; i < (size / 4), col < variable.type.cols; ++col, ++i)
-				std::memcpy(data_storage.data() + variable.offset + (row * 4 + col) * 4, data + (row * variable.type.cols + col) * 4, 4);
+			{
+				uint8_t *const target = data_storage.data() + variable.offset + (row * 4 + col) * 4;
+				const uint8_t *const source = data + (row * variable.type.cols + col) * 4;
+				if (std::memcmp(target, source, 4) != 0)
+				{
+					std::memcpy(target, source, 4);
+					modified = true;
+				}
+			}
+		}
 	}
-	else
+	else if (std::memcmp(data_storage.data() + variable.offset, data, size) != 0)
 	{
 		std::memcpy(data_storage.data() + variable.offset, data, size);
+		modified = true;
 	}
+
+	if (modified)
+		mark_uniform_data_modified(effect, variable.offset, variable.size);
 }
 void reshade::runtime::set_uniform_value(uniform &variable, const bool *values, size_t count)
 {
@@ -1610,6 +2436,7 @@ void reshade::runtime::reset_uniform_value(uniform &variable)
 	if (!variable.has_initializer_value)
 	{
 		std::memset(data_storage.data() + variable.offset, 0, variable.size);
+		mark_uniform_data_modified(_effects[variable.effect_index], variable.offset, variable.size);
 		return;
 	}
 
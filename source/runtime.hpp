@@ -6,10 +6,13 @@
 #pragma once
 
 #include <mutex>
+#include <cstdio>
 #include <memory>
 #include <atomic>
 #include <chrono>
 #include <filesystem>
+#include <unordered_map>
+#include "lockfree_queue.hpp"
 
 #if RESHADE_GUI
 #include "imgui_editor.hpp"
@@ -25,6 +28,7 @@ namespace reshade
 	struct uniform;
 	struct texture;
 	struct technique;
+	class task_pool;
 
 	/// <summary>
 	/// Platform independent base class for the main ReShade runtime.
@@ -48,6 +52,19 @@ namespace reshade
 		/// <param name="buffer">The 32bpp RGBA buffer to save the screenshot to.</param>
 		virtual bool capture_screenshot(uint8_t *buffer) const = 0;
 
+		/// <summary>
+		/// Function called with the image of a deferred capture, in 32bpp RGBA format. The data is empty if the capture failed.
+		/// </summary>
+		using capture_callback = std::function<void(std::vector<uint8_t> &&data, unsigned int width, unsigned int height)>;
+		/// <summary>
+		/// Create a copy of the current frame image in system memory without waiting for the GPU.
+		/// The copy is recorded right away, but only read back a few frames later during present, at which point the <paramref name="callback"/> is called with the image data.
+		/// </summary>
+		/// <param name="callback">The function to call with the captured image data.</param>
+		/// <param name="allow_synchronous">Set to <c>false</c> to fail instead of capturing the image right away when the back-end cannot read it back deferred.</param>
+		/// <returns><c>true</c> if the capture was queued, <c>false</c> if too many captures are still in flight.</returns>
+		bool capture_screenshot_deferred(capture_callback callback, bool allow_synchronous = true);
+
 		/// <summary>
 		/// Save user configuration to disk.
 		/// </summary>
@@ -118,6 +135,9 @@ namespace reshade
 		void subscribe_to_save_config(std::function<void(ini_file &)> function);
 
 	protected:
+		static const unsigned int NUM_READBACK_SLOTS = 4;
+		static const unsigned int READBACK_LATENCY = 2;
+
 		runtime();
 		virtual ~runtime();
 
@@ -160,6 +180,48 @@ namespace reshade
 		/// </summary>
 		virtual void unload_effects();
 
+		/// <summary>
+		/// Check whether the next <see cref="init_effect"/> call for the specified effect has to initialize a technique.
+		/// Only enabled techniques are initialized, the others are initialized by another call once they get enabled, so that they do not cost anything before.
+		/// </summary>
+		/// <param name="technique">The technique to check.</param>
+		/// <param name="index">The ID of the effect.</param>
+		static bool is_technique_pending(const technique &technique, size_t index);
+		/// <summary>
+		/// Check whether any technique the next <see cref="init_effect"/> call for the specified effect initializes uses an entry point.
+		/// </summary>
+		/// <param name="index">The ID of the effect.</param>
+		/// <param name="entry_point">The name of the entry point function.</param>
+		bool is_entry_point_pending(size_t index, const std::string &entry_point) const;
+
+		/// <summary>
+		/// Get the next range of the uniform data of an effect that was modified since the last upload and mark it as uploaded.
+		/// Call this right before uploading the uniform data of an effect to the GPU, repeatedly until it returns <c>false</c>, so that nothing is uploaded when nothing changed.
+		/// </summary>
+		/// <param name="index">The ID of the effect.</param>
+		/// <param name="offset">Set to the offset in bytes of the range that has to be uploaded.</param>
+		/// <param name="size">Set to the size in bytes of the range that has to be uploaded.</param>
+		/// <param name="whole_buffer">Set to <c>true</c> to always get the entire uniform data when anything was modified, for uploads that cannot update part of a buffer.</param>
+		/// <returns><c>true</c> if the uniform data has to be uploaded, <c>false</c> if the data on the GPU is up to date already.</returns>
+		bool consume_uniform_data_changes(size_t index, size_t &offset, size_t &size, bool whole_buffer = false);
+
+		/// <summary>
+		/// Return whether this back-end implements <see cref="begin_readback"/>, so that captures do not have to wait for the GPU.
+		/// </summary>
+		virtual bool supports_readback() const { return false; }
+		/// <summary>
+		/// Record a copy of the current frame image into a persistent staging resource, without waiting for it to finish.
+		/// Back-ends that do not implement this return <c>false</c>, in which case the frame is captured with <see cref="capture_screenshot"/> instead.
+		/// </summary>
+		/// <param name="slot">The index of the readback slot to copy to.</param>
+		virtual bool begin_readback(unsigned int slot) { return false; }
+		/// <summary>
+		/// Read back the contents of a readback slot, which was filled by <see cref="begin_readback"/> at least <see cref="READBACK_LATENCY"/> frames ago.
+		/// </summary>
+		/// <param name="slot">The index of the readback slot to read from.</param>
+		/// <param name="buffer">The 32bpp RGBA buffer to save the image to.</param>
+		virtual bool finish_readback(unsigned int slot, uint8_t *buffer) { return false; }
+
 		/// <summary>
 		/// Load image files and update textures with image data.
 		/// </summary>
@@ -197,6 +259,8 @@ namespace reshade
 		uint64_t _framecount = 0;
 		unsigned int _vertices = 0;
 		unsigned int _drawcalls = 0;
+		unsigned int _uniform_bytes_uploaded = 0;
+		unsigned int _uniform_uploads_skipped = 0;
 
 		std::vector<effect> _effects;
 		std::vector<texture> _textures;
@@ -215,6 +279,11 @@ namespace reshade
 		/// </summary>
 		bool is_loading() const { return _reload_remaining_effects != std::numeric_limits<size_t>::max(); }
 
+		/// <summary>
+		/// Check the source and included files of all effects for modifications in the background and reload only the effects that depend on modified files.
+		/// </summary>
+		void reload_modified_effects();
+
 		/// <summary>
 		/// Enable a technique so it is rendered.
 		/// </summary>
@@ -252,6 +321,26 @@ namespace reshade
 		/// Create a copy of the current frame and write it to an image file on disk.
 		/// </summary>
 		void save_screenshot(const std::wstring &postfix = std::wstring(), bool should_save_preset = false);
+		void finish_screenshots();
+
+		/// <summary>
+		/// Start recording frames to an image sequence or raw stream in the screenshot directory, using the current frame capture settings.
+		/// </summary>
+		void start_frame_capture();
+		/// <summary>
+		/// Stop recording frames. Frames that were captured already are still written in the background.
+		/// </summary>
+		void stop_frame_capture();
+		/// <summary>
+		/// Capture the current frame if it is part of the active frame capture.
+		/// </summary>
+		void update_frame_capture();
+
+		/// <summary>
+		/// Read back all deferred captures that are old enough and pass them on to their callbacks.
+		/// </summary>
+		/// <param name="flush">Set to <c>true</c> to finish all captures right away, waiting for the GPU if necessary.</param>
+		void finish_deferred_captures(bool flush = false);
 
 		// === Status ===
 		int _date[4] = {};
@@ -276,16 +365,31 @@ namespace reshade
 		bool _last_reload_successful = true;
 		bool _textures_loaded = false;
 		bool _performance_mode = false;
+		bool _no_effect_cache = false;
+		bool _uniform_layout_optimization = false; // Group the uniforms updated every frame at the start of the uniform buffer, which changes the buffer layout add-ons see
+		bool _spirv_optimization = false; // Run the built-in SPIR-V optimization passes on effects compiled for Vulkan
+		bool _auto_reload_effects = false;
 		unsigned int _reload_key_data[4];
 		size_t _reload_total_effects = 1;
 		std::vector<size_t> _reload_compile_queue;
 		std::atomic<size_t> _reload_remaining_effects = 0;
 		std::mutex _reload_mutex;
-		std::vector<std::thread> _worker_threads;
+		std::unique_ptr<task_pool> _worker_pool;
+		std::unordered_map<std::string, uint64_t> _effect_compile_times;
+		struct watched_file
+		{
+			std::filesystem::file_time_type modified;
+			std::vector<size_t> effects; // Indices of all effects that use this file (which forms the reverse include graph)
+		};
+		std::unordered_map<std::string, watched_file> _watched_effect_files;
+		std::vector<std::string> _modified_effect_files;
+		std::atomic<bool> _checking_effect_files = false;
+		std::chrono::high_resolution_clock::time_point _last_effect_file_check_time;
 		std::vector<std::string> _global_preprocessor_definitions;
 		std::vector<std::string> _preset_preprocessor_definitions;
 		std::vector<std::filesystem::path> _effect_search_paths;
 		std::vector<std::filesystem::path> _texture_search_paths;
+		std::filesystem::path _intermediate_cache_path;
 		std::chrono::high_resolution_clock::time_point _last_reload_time;
 
 		// === Screenshots ===
@@ -299,6 +403,82 @@ namespace reshade
 		std::filesystem::path _screenshot_path;
 		std::filesystem::path _last_screenshot_file;
 		std::chrono::high_resolution_clock::time_point _last_screenshot_time;
+		unsigned int _screenshot_memory_budget = 512; // In MiB
+		struct screenshot_result
+		{
+			bool success = false;
+			std::filesystem::path path;
+			std::filesystem::path preset_path; // Empty if the preset should not be copied alongside the screenshot
+			std::string preset_data; // Contents of the preset at the time the screenshot was taken
+			size_t data_size = 0; // Size of the uncompressed image data in bytes
+			std::chrono::microseconds encode_time = {}; // Time taken to encode and write the file
+		};
+		std::atomic<size_t> _screenshot_pending_bytes = 0; // Size of the image data of all screenshots and captured frames that are still being encoded
+		std::vector<screenshot_result> _screenshot_results;
+		std::mutex _screenshot_mutex;
+		std::unique_ptr<task_pool> _screenshot_pool;
+
+		// === Deferred Capture ===
+		struct readback_request
+		{
+			bool pending = false;
+			bool synchronous = false; // Set when the back-end does not support deferred readback, so the data was captured right away
+			uint64_t frame = 0;
+			capture_callback callback;
+			std::vector<uint8_t> data;
+		};
+		unsigned int _readback_next_slot = 0;
+		readback_request _readback_requests[NUM_READBACK_SLOTS];
+
+		// === Frame Capture ===
+		unsigned int _frame_capture_key_data[4];
+		unsigned int _frame_capture_format = 0; // 0 = Image sequence in the screenshot format, 1 = Raw RGBA stream
+		unsigned int _frame_capture_interval = 1; // Capture every Nth frame
+		unsigned int _frame_capture_length = 0; // Number of frames to capture, or zero to capture until stopped
+		struct captured_frame
+		{
+			uint64_t index = 0;
+			std::vector<uint8_t> data;
+		};
+		struct frame_capture : std::enable_shared_from_this<frame_capture>
+		{
+			~frame_capture();
+
+			/// <summary>
+			/// Hand a captured frame over to the encoders without blocking, or drop it if that would exceed the memory budget.
+			/// </summary>
+			void push_frame(captured_frame &frame);
+			/// <summary>
+			/// Write frames from the queue until it is empty. This is run on the screenshot pool.
+			/// </summary>
+			void encode_frames();
+			/// <summary>
+			/// Write a blank frame to the raw stream for every frame that was dropped before the frame with the specified index.
+			/// </summary>
+			bool write_raw_gap(uint64_t index);
+
+			unsigned int format = 0;
+			unsigned int image_format = 0;
+			unsigned int width = 0;
+			unsigned int height = 0;
+			unsigned int interval = 1;
+			unsigned int length = 0;
+			unsigned int max_encoders = 1; // Raw streams are written by a single encoder, so that frames stay in order
+			uint64_t start_frame = 0;
+			uint64_t num_requested = 0;
+			size_t memory_budget = 0;
+			std::filesystem::path path; // Directory for image sequences, file for raw streams
+			FILE *raw_file = nullptr;
+			task_pool *pool = nullptr;
+			std::atomic<size_t> *pending_bytes = nullptr; // Shared with screenshots, so that both together stay within the memory budget
+			uint64_t next_raw_index = 0; // Index of the next frame in the raw stream, only accessed by the encoder
+			std::atomic<unsigned int> num_encoders = 0;
+			std::atomic<uint64_t> num_written = 0;
+			std::atomic<uint64_t> num_dropped = 0;
+			std::atomic<bool> write_failed = false;
+			lockfree_queue<captured_frame, 64> queue;
+		};
+		std::shared_ptr<frame_capture> _frame_capture;
 
 		// === Preset Switching ===
 		bool _is_in_between_presets_transition = false;
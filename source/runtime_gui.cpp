@@ -437,6 +437,7 @@ void reshade::runtime::draw_ui()
 {
 	const bool show_splash = _show_splash && (is_loading() || !_reload_compile_queue.empty() || (_last_present_time - _last_reload_time) < std::chrono::seconds(5));
 	const bool show_screenshot_message = _show_screenshot_message && _last_present_time - _last_screenshot_time < std::chrono::seconds(_screenshot_save_success ? 3 : 5);
+	const bool show_frame_capture_message = _show_screenshot_message && _frame_capture != nullptr;
 
 	if (_show_menu && !_ignore_shortcuts && !_imgui_context->IO.NavVisible && _input->is_key_pressed(0x1B /* VK_ESCAPE */))
 		_show_menu = false; // Close when pressing the escape button and not currently navigating with the keyboard
@@ -485,7 +486,7 @@ void reshade::runtime::draw_ui()
 	ImVec2 viewport_offset = ImVec2(0, 0);
 
 	// Create ImGui widgets and windows
-	if (show_splash || show_screenshot_message || (!_show_menu && _tutorial_index == 0))
+	if (show_splash || show_screenshot_message || show_frame_capture_message || (!_show_menu && _tutorial_index == 0))
 	{
 		ImGui::SetNextWindowPos(ImVec2(10, 10));
 		ImGui::SetNextWindowSize(ImVec2(imgui_io.DisplaySize.x - 20.0f, 0.0f));
@@ -501,15 +502,22 @@ void reshade::runtime::draw_ui()
 			ImGuiWindowFlags_NoDocking |
 			ImGuiWindowFlags_NoFocusOnAppearing);
 
-		if (show_screenshot_message)
+		if (show_screenshot_message || show_frame_capture_message)
 		{
-			if (!_screenshot_save_success)
-				if (std::error_code ec; std::filesystem::exists(_screenshot_path, ec))
-					ImGui::TextColored(COLOR_RED, "Unable to save screenshot because of an internal error (the format may not be supported).");
+			if (show_frame_capture_message)
+				ImGui::Text("Capturing frames to %s (%llu written, %llu dropped)", _frame_capture->path.u8string().c_str(),
+					static_cast<unsigned long long>(_frame_capture->num_written.load()), static_cast<unsigned long long>(_frame_capture->num_dropped.load()));
+
+			if (show_screenshot_message)
+			{
+				if (!_screenshot_save_success)
+					if (std::error_code ec; std::filesystem::exists(_screenshot_path, ec))
+						ImGui::TextColored(COLOR_RED, "Unable to save screenshot because of an internal error (the format may not be supported).");
+					else
+						ImGui::TextColored(COLOR_RED, "Unable to save screenshot because path doesn't exist: %s.", _screenshot_path.u8string().c_str());
 				else
-					ImGui::TextColored(COLOR_RED, "Unable to save screenshot because path doesn't exist: %s.", _screenshot_path.u8string().c_str());
-			else
-				ImGui::Text("Screenshot successfully saved to %s", _last_screenshot_file.u8string().c_str());
+					ImGui::Text("Screenshot successfully saved to %s", _last_screenshot_file.u8string().c_str());
+			}
 		}
 		else
 		{
@@ -1051,6 +1059,11 @@ void reshade::runtime::draw_ui_settings()
 
 		modified |= imgui_path_list("Effect search paths", _effect_search_paths, _file_selection_path, g_reshade_dll_path.parent_path());
 		modified |= imgui_path_list("Texture search paths", _texture_search_paths, _file_selection_path, g_reshade_dll_path.parent_path());
+		modified |= imgui_directory_input_box("Effect cache path", _intermediate_cache_path, _file_selection_path);
+
+		modified |= ImGui::Checkbox("Reload effects on file change", &_auto_reload_effects);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Watches all effect files and the files they include for changes and only reloads the effects affected by a change.");
 
 		if (ImGui::Button("Restart tutorial", ImVec2(ImGui::CalcItemWidth(), 0)))
 			_tutorial_index = 0;
@@ -1062,10 +1075,21 @@ void reshade::runtime::draw_ui_settings()
 		_ignore_shortcuts |= ImGui::IsItemActive();
 
 		modified |= imgui_directory_input_box("Screenshot Path", _screenshot_path, _file_selection_path);
-		modified |= ImGui::Combo("Screenshot Format", reinterpret_cast<int *>(&_screenshot_format), "Bitmap (*.bmp)\0Portable Network Graphics (*.png)\0");
+		modified |= ImGui::Combo("Screenshot Format", reinterpret_cast<int *>(&_screenshot_format), "Bitmap (*.bmp)\0Portable Network Graphics (*.png)\0Quite OK Image Format (*.qoi)\0");
 		modified |= ImGui::Checkbox("Include current preset", &_screenshot_include_preset);
 		modified |= ImGui::Checkbox("Save before and after images", &_screenshot_save_before);
 		modified |= ImGui::Checkbox("Save separate user interface image", &_screenshot_save_ui);
+
+		modified |= imgui_key_input("Frame Capture Key", _frame_capture_key_data, *_input);
+		_ignore_shortcuts |= ImGui::IsItemActive();
+
+		modified |= ImGui::Combo("Frame Capture Format", reinterpret_cast<int *>(&_frame_capture_format), "Image sequence (screenshot format)\0Raw RGBA stream (*.rgba)\0");
+		modified |= ImGui::SliderInt("Frame Capture Interval", reinterpret_cast<int *>(&_frame_capture_interval), 1, 60);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Captures every Nth frame.");
+		modified |= ImGui::InputScalar("Frame Capture Length", ImGuiDataType_U32, &_frame_capture_length);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Number of frames to capture before stopping automatically.\nSet this to zero to capture until the frame capture key is pressed again.\nFrames are dropped instead of slowing down the application when encoding cannot keep up with the screenshot memory budget.\nDropped frames leave a gap in the numbering of image sequences and are written as blank frames to raw streams.");
 	}
 
 	if (ImGui::CollapsingHeader("User Interface", ImGuiTreeNodeFlags_DefaultOpen))
@@ -1279,6 +1303,7 @@ void reshade::runtime::draw_ui_statistics()
 		ImGui::Text("Frame %llu:", _framecount + 1);
 		ImGui::NewLine();
 		ImGui::TextUnformatted("Post-Processing:");
+		ImGui::TextUnformatted("Uniform Uploads:");
 
 		ImGui::EndGroup();
 		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
@@ -1294,6 +1319,7 @@ void reshade::runtime::draw_ui_statistics()
 		ImGui::Text("%.2f fps", _imgui_context->IO.Framerate);
 		ImGui::Text("%u draw calls", _drawcalls);
 		ImGui::Text("%*.3f ms CPU", cpu_digits + 4, post_processing_time_cpu * 1e-6f);
+		ImGui::Text("%u B", _uniform_bytes_uploaded);
 
 		ImGui::EndGroup();
 		ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
@@ -1310,6 +1336,9 @@ void reshade::runtime::draw_ui_statistics()
 		ImGui::Text("%u vertices", _vertices);
 		if (post_processing_time_gpu != 0)
 			ImGui::Text("%*.3f ms GPU", gpu_digits + 4, (post_processing_time_gpu * 1e-6f));
+		else
+			ImGui::NewLine();
+		ImGui::Text("%u skipped", _uniform_uploads_skipped);
 
 		ImGui::EndGroup();
 	}
@@ -1363,6 +1392,24 @@ void reshade::runtime::draw_ui_statistics()
 		ImGui::EndGroup();
 	}
 
+	if (ImGui::CollapsingHeader("Effects") && !is_loading())
+	{
+		ImGui::BeginGroup();
+
+		for (const auto &effect : _effects)
+			ImGui::TextUnformatted(effect.source_file.filename().u8string().c_str());
+
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
+		ImGui::BeginGroup();
+
+		// Time spent in 'load_effect' (pre-processing and compilation on a worker thread, without back-end initialization)
+		for (const auto &effect : _effects)
+			ImGui::Text("%.3f ms", effect.compile_duration * 1e-6f);
+
+		ImGui::EndGroup();
+	}
+
 	if (ImGui::CollapsingHeader("Render Targets & Textures", ImGuiTreeNodeFlags_DefaultOpen) && !is_loading())
 	{
 		const char *texture_formats[] = {
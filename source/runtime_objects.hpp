@@ -6,6 +6,7 @@
 #pragma once
 
 #include "effect_module.hpp"
+#include <limits> // std::numeric_limits
 
 namespace reshade
 {
@@ -75,33 +76,105 @@ namespace reshade
 		const T *as() const { return dynamic_cast<const T *>(this); }
 	};
 
-	struct texture final : reshadefx::texture_info
+	/// <summary>
+	/// Name of an annotation to look up, with its hash computed up front (at compile time for string literals).
+	/// </summary>
+	struct annotation_key
 	{
-		texture() {}
-		texture(const reshadefx::texture_info &init) : texture_info(init) {}
+		constexpr annotation_key(const char *name) : annotation_key(std::string_view(name)) {}
+		constexpr annotation_key(std::string_view name) : name(name), hash(2166136261)
+		{
+			for (const char c : name)
+				hash = (hash ^ static_cast<uint8_t>(c)) * 16777619;
+		}
+
+		std::string_view name;
+		uint32_t hash;
+	};
+
+	/// <summary>
+	/// Adds annotation lookups to a module object. Annotations are found through a small open-addressing hash table that is built once on construction, instead of comparing against the name of every annotation.
+	/// </summary>
+	template <typename info_type>
+	struct annotated_object : info_type
+	{
+		annotated_object() {}
+		annotated_object(const info_type &init) : info_type(init) { build_annotation_table(); }
 
-		int annotation_as_int(const char *ann_name, size_t i = 0) const
+		const reshadefx::annotation *find_annotation(annotation_key key) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0;
-			return it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i]);
+			if (_annotation_table.empty())
+				return nullptr;
+
+			const size_t mask = _annotation_table.size() - 1;
+			for (size_t slot = key.hash & mask; _annotation_table[slot].index != 0; slot = (slot + 1) & mask)
+			{
+				const reshadefx::annotation &annotation = this->annotations[_annotation_table[slot].index - 1];
+				if (_annotation_table[slot].hash == key.hash && annotation.name == key.name)
+					return &annotation;
+			}
+			return nullptr;
 		}
-		float annotation_as_float(const char *ann_name, size_t i = 0) const
+
+		int annotation_as_int(annotation_key key, size_t i = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0.0f;
-			return it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i]);
+			const reshadefx::annotation *const annotation = find_annotation(key);
+			if (annotation == nullptr) return 0;
+			return annotation->type.is_integral() ? annotation->value.as_int[i] : static_cast<int>(annotation->value.as_float[i]);
 		}
-		std::string_view annotation_as_string(const char *ann_name) const
+		float annotation_as_float(annotation_key key, size_t i = 0) const
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return std::string_view();
-			return it->value.string_data;
+			const reshadefx::annotation *const annotation = find_annotation(key);
+			if (annotation == nullptr) return 0.0f;
+			return annotation->type.is_floating_point() ? annotation->value.as_float[i] : static_cast<float>(annotation->value.as_int[i]);
+		}
+		std::string_view annotation_as_string(annotation_key key) const
+		{
+			const reshadefx::annotation *const annotation = find_annotation(key);
+			if (annotation == nullptr) return std::string_view();
+			return annotation->value.string_data;
+		}
+
+	private:
+		void build_annotation_table()
+		{
+			if (this->annotations.empty())
+				return;
+
+			// Keep the table at most half full, so that probe sequences stay short
+			size_t size = 4;
+			while (size < this->annotations.size() * 2)
+				size *= 2;
+			_annotation_table.resize(size);
+
+			// Insert in declaration order, so that the first of multiple annotations with the same name is found first, like with a linear search
+			for (size_t index = 0; index < this->annotations.size(); ++index)
+			{
+				const annotation_key key(this->annotations[index].name);
+
+				size_t slot = key.hash & (size - 1);
+				while (_annotation_table[slot].index != 0)
+					slot = (slot + 1) & (size - 1);
+
+				_annotation_table[slot] = { key.hash, static_cast<uint32_t>(index + 1) };
+			}
 		}
 
+		struct table_slot
+		{
+			uint32_t hash;
+			uint32_t index; // One-based index into the annotation list, zero marks an empty slot
+		};
+
+		// Indices instead of pointers, so that copies of the object can use the table as is
+		std::vector<table_slot> _annotation_table;
+	};
+
+	struct texture final : annotated_object<reshadefx::texture_info>
+	{
+		texture() {}
+		texture(const reshadefx::texture_info &init) : annotated_object(init) {}
+
 		bool matches_description(const reshadefx::texture_info &desc) const
 		{
 			return width == desc.width && height == desc.height && levels == desc.levels && format == desc.format;
@@ -111,33 +184,12 @@ namespace reshade
 		texture_reference impl_reference = texture_reference::none;
 		std::unique_ptr<base_object> impl;
 		bool shared = false;
+		bool loaded = false;
 	};
 
-	struct uniform final : reshadefx::uniform_info
+	struct uniform final : annotated_object<reshadefx::uniform_info>
 	{
-		uniform(const reshadefx::uniform_info &init) : uniform_info(init) {}
-
-		int annotation_as_int(const char *ann_name, size_t i = 0) const
-		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0;
-			return it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i]);
-		}
-		float annotation_as_float(const char *ann_name, size_t i = 0) const
-		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0.0f;
-			return it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i]);
-		}
-		std::string_view annotation_as_string(const char *ann_name) const
-		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return std::string_view();
-			return it->value.string_data;
-		}
+		uniform(const reshadefx::uniform_info &init) : annotated_object(init) {}
 
 		bool supports_toggle_key() const
 		{
@@ -154,31 +206,32 @@ namespace reshade
 		uint32_t toggle_key_data[4] = {};
 	};
 
-	struct technique final : reshadefx::technique_info
+	/// <summary>
+	/// Update record for a special uniform variable, with all parameters from its annotations decoded at load time, so that updating it every frame does not have to look at them again.
+	/// </summary>
+	struct special_uniform_update
 	{
-		technique(const reshadefx::technique_info &init) : technique_info(init) {}
-
-		int annotation_as_int(const char *ann_name, size_t i = 0) const
+		enum class input_mode
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0;
-			return it->type.is_integral() ? it->value.as_int[i] : static_cast<int>(it->value.as_float[i]);
-		}
-		float annotation_as_float(const char *ann_name, size_t i = 0) const
-		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return 0.0f;
-			return it->type.is_floating_point() ? it->value.as_float[i] : static_cast<float>(it->value.as_int[i]);
-		}
-		std::string_view annotation_as_string(const char *ann_name) const
+			down,
+			press,
+			toggle,
+		};
+
+		special_uniform kind = special_uniform::none;
+		uint32_t uniform_index = 0; // Index into the uniform list of the effect
+		union
 		{
-			const auto it = std::find_if(annotations.begin(), annotations.end(),
-				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
-			if (it == annotations.end()) return std::string_view();
-			return it->value.string_data;
-		}
+			struct { bool as_boolean; } frame_count;
+			struct { int min, max; } random;
+			struct { float min, max, step_min, step_max, smoothing; } ping_pong;
+			struct { int keycode; input_mode mode; } key; // Also used for mouse buttons
+		};
+	};
+
+	struct technique final : annotated_object<reshadefx::technique_info>
+	{
+		technique(const reshadefx::technique_info &init) : annotated_object(init) {}
 
 		size_t effect_index = std::numeric_limits<size_t>::max();
 		std::vector<std::unique_ptr<base_object>> passes_data;
@@ -204,6 +257,15 @@ namespace reshade
 		std::vector<std::pair<std::string, std::string>> definitions;
 		std::unordered_map<std::string, std::string> assembly;
 		std::vector<uniform> uniforms;
+		std::vector<special_uniform_update> special_uniforms;
 		std::vector<unsigned char> uniform_data_storage;
+		// Range of 'uniform_data_storage' that was modified since it was last uploaded (nothing was modified if begin and end are equal)
+		size_t uniform_data_dirty_begin = 0;
+		size_t uniform_data_dirty_end = 0;
+		// Modifications to the block of uniforms updated every frame (see 'reshadefx::module::per_frame_uniform_size') are tracked separately, so that they do not extend the range above
+		bool per_frame_uniform_data_dirty = false;
+		// Frame in which the uniform data was last checked for changes, so that a skipped upload is only counted once per frame
+		uint64_t uniform_data_checked_frame = std::numeric_limits<uint64_t>::max();
+		uint64_t compile_duration = 0;
 	};
 }
@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "task_pool.hpp"
+#include <algorithm>
+
+reshade::task_pool::task_pool(size_t num_threads)
+{
+	if (num_threads == 0)
+		num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1;
+
+	_queues.reserve(num_threads);
+	for (size_t i = 0; i < num_threads; ++i)
+		_queues.push_back(std::make_unique<task_queue>());
+
+	// Launch threads only after all queues exist, since workers access the queues of each other
+	_threads.reserve(num_threads);
+	for (size_t i = 0; i < num_threads; ++i)
+		_threads.emplace_back(&task_pool::worker_main, this, i);
+}
+reshade::task_pool::~task_pool()
+{
+	{	const std::lock_guard<std::mutex> lock(_mutex);
+		_exit = true;
+	}
+
+	_wake_condition.notify_all();
+
+	for (std::thread &thread : _threads)
+		thread.join();
+}
+
+void reshade::task_pool::submit(std::vector<std::function<void()>> tasks)
+{
+	if (tasks.empty())
+		return;
+
+	_num_pending += tasks.size();
+
+	{	// Update the queued count while holding the lock, so that no worker can miss the wake up between checking it and going to sleep
+		// It is updated before the tasks are actually pushed, so that it cannot underflow when a worker picks up a task right away
+		const std::lock_guard<std::mutex> lock(_mutex);
+		_num_queued += tasks.size();
+	}
+
+	// Deal tasks round-robin, so that every worker starts with one of the highest priority tasks
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		task_queue &queue = *_queues[i % _queues.size()];
+
+		const std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(tasks[i]));
+	}
+
+	_wake_condition.notify_all();
+}
+
+void reshade::task_pool::wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle_condition.wait(lock, [this]() { return _num_pending == 0; });
+}
+
+bool reshade::task_pool::pop_task(size_t index, std::function<void()> &task)
+{
+	// Take the next task from the front of the own queue first
+	{	task_queue &queue = *_queues[index];
+		const std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+
+	// Otherwise steal from the back of another queue, where the lowest priority tasks are
+	for (size_t offset = 1; offset < _queues.size(); ++offset)
+	{
+		task_queue &queue = *_queues[(index + offset) % _queues.size()];
+		const std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void reshade::task_pool::worker_main(size_t index)
+{
+	while (true)
+	{
+		if (std::function<void()> task; pop_task(index, task))
+		{
+			_num_queued--;
+
+			task();
+
+			if (--_num_pending == 0)
+			{
+				// Acquire the lock before notifying, so that a thread which just checked the count in 'wait' cannot miss this
+				const std::lock_guard<std::mutex> lock(_mutex);
+				_idle_condition.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_wake_condition.wait(lock, [this]() { return _exit || _num_queued != 0; });
+
+		if (_exit && _num_queued == 0)
+			break;
+	}
+}
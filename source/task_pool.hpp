@@ -0,0 +1,75 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+namespace reshade
+{
+	/// <summary>
+	/// A pool of persistent worker threads with one task queue per worker.
+	/// Workers take tasks from the front of their own queue and steal from the back of other queues when they run out of work.
+	/// </summary>
+	class task_pool
+	{
+	public:
+		/// <summary>
+		/// Create the pool and launch its worker threads.
+		/// </summary>
+		/// <param name="num_threads">The number of worker threads, or zero to use one less than the number of hardware threads.</param>
+		explicit task_pool(size_t num_threads = 0);
+		/// <summary>
+		/// Finish all queued tasks and exit the worker threads.
+		/// </summary>
+		~task_pool();
+
+		/// <summary>
+		/// Get the number of worker threads in this pool.
+		/// </summary>
+		size_t num_threads() const { return _threads.size(); }
+
+		/// <summary>
+		/// Queue a batch of tasks for execution.
+		/// </summary>
+		/// <param name="tasks">The tasks to run, ordered by priority. Tasks are dealt round-robin to the worker queues, so earlier ones are started first.</param>
+		void submit(std::vector<std::function<void()>> tasks);
+
+		/// <summary>
+		/// Block until all submitted tasks have finished.
+		/// </summary>
+		void wait();
+		/// <summary>
+		/// Check whether all submitted tasks have finished.
+		/// </summary>
+		bool is_idle() const { return _num_pending == 0; }
+
+	private:
+		struct task_queue
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		void worker_main(size_t index);
+		bool pop_task(size_t index, std::function<void()> &task);
+
+		bool _exit = false;
+		std::mutex _mutex;
+		std::condition_variable _wake_condition;
+		std::condition_variable _idle_condition;
+		std::atomic<size_t> _num_queued = 0;
+		std::atomic<size_t> _num_pending = 0;
+		std::vector<std::unique_ptr<task_queue>> _queues;
+		std::vector<std::thread> _threads;
+	};
+}
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <vulkan.h>
+#include "pixel_conversion.hpp"
 
 inline VkFormat make_format_srgb(VkFormat format)
 {
@@ -43,3 +44,47 @@ inline VkImageAspectFlags aspect_flags_from_format(VkFormat format)
 		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
 	return VK_IMAGE_ASPECT_COLOR_BIT;
 }
+
+inline reshade::pixel_format pixel_format_from_vk(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8_UNORM:
+		return reshade::pixel_format::r8_unorm;
+	case VK_FORMAT_R8G8_UNORM:
+		return reshade::pixel_format::rg8_unorm;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+		return reshade::pixel_format::rgba8_unorm;
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+		return reshade::pixel_format::rgba8_unorm_srgb;
+	case VK_FORMAT_B8G8R8A8_UNORM:
+		return reshade::pixel_format::bgra8_unorm;
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		return reshade::pixel_format::bgra8_unorm_srgb;
+	// Packed formats are named from the most to the least significant bits, so this one has red in the lowest bits
+	case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+		return reshade::pixel_format::rgb10a2_unorm;
+	case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+		return reshade::pixel_format::bgr10a2_unorm;
+	case VK_FORMAT_R16G16_UNORM:
+		return reshade::pixel_format::rg16_unorm;
+	case VK_FORMAT_R16G16B16A16_UNORM:
+		return reshade::pixel_format::rgba16_unorm;
+	case VK_FORMAT_R16_SFLOAT:
+		return reshade::pixel_format::r16_float;
+	case VK_FORMAT_R16G16_SFLOAT:
+		return reshade::pixel_format::rg16_float;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+		return reshade::pixel_format::rgba16_float;
+	case VK_FORMAT_R32_SFLOAT:
+		return reshade::pixel_format::r32_float;
+	case VK_FORMAT_R32G32_SFLOAT:
+		return reshade::pixel_format::rg32_float;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return reshade::pixel_format::rgba32_float;
+	default:
+		return reshade::pixel_format::unknown;
+	}
+}
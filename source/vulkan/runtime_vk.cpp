@@ -390,6 +390,15 @@ void reshade::vulkan::runtime_vk::on_reset()
 
 	wait_for_command_buffers(); // Make sure none of the resources below are currently in use
 
+	for (unsigned int i = 0; i < NUM_READBACK_SLOTS; ++i)
+	{
+		vk.DestroyBuffer(_device, _readback_buffers[i], nullptr);
+		_readback_buffers[i] = VK_NULL_HANDLE;
+		vk.FreeMemory(_device, _readback_mem[i], nullptr); // Implicitly unmaps the memory
+		_readback_mem[i] = VK_NULL_HANDLE;
+		_readback_data[i] = nullptr;
+	}
+
 	for (VkImageView view : _swapchain_views)
 		vk.DestroyImageView(_device, view, nullptr);
 	_swapchain_views.clear();
@@ -521,15 +530,26 @@ void reshade::vulkan::runtime_vk::on_present(VkQueue queue, uint32_t swapchain_i
 	_cmd_index = std::numeric_limits<uint32_t>::max();
 }
 
-bool reshade::vulkan::runtime_vk::capture_screenshot(uint8_t *buffer) const
+static uint32_t calc_pixel_size(VkFormat format)
+{
+	// Assume four bytes per pixel for unknown formats, which is what most back buffer formats use
+	return static_cast<uint32_t>(std::max<size_t>(reshade::pixel_format_size(pixel_format_from_vk(format)), 4));
+}
+
+static void copy_screenshot_data(VkFormat format, uint32_t width, uint32_t height, const uint8_t *mapped_data, uint8_t *buffer)
 {
-	const size_t data_pitch = _width * 4;
+	// Screenshots are always RGBA without transparency, regardless of the back buffer format
+	const reshade::pixel_format src_format = pixel_format_from_vk(format);
+	reshade::convert_pixels(src_format, mapped_data, width * calc_pixel_size(format), reshade::pixel_format_for_screenshot(src_format), buffer, width * 4, width, height, true);
+}
 
+bool reshade::vulkan::runtime_vk::capture_screenshot(uint8_t *buffer) const
+{
 	vk_handle<VK_OBJECT_TYPE_BUFFER> intermediate(_device, vk);
 	vk_handle<VK_OBJECT_TYPE_DEVICE_MEMORY> intermediate_mem(_device, vk);
 
 	{   VkBufferCreateInfo create_info { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-		create_info.size = _width * _height * 4;
+		create_info.size = _width * _height * calc_pixel_size(_backbuffer_format);
 		create_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -551,6 +571,25 @@ bool reshade::vulkan::runtime_vk::capture_screenshot(uint8_t *buffer) const
 		check_result(vk.BindBufferMemory(_device, intermediate, intermediate_mem, 0)) false;
 	}
 
+	if (!record_backbuffer_copy(intermediate))
+		return false;
+
+	// Execute and wait for completion
+	execute_command_buffer();
+
+	// Copy data from intermediate image into output buffer
+	uint8_t *mapped_data;
+	check_result(vk.MapMemory(_device, intermediate_mem, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&mapped_data))) false;
+
+	copy_screenshot_data(_backbuffer_format, _width, _height, mapped_data, buffer);
+
+	vk.UnmapMemory(_device, intermediate_mem);
+
+	return true;
+}
+
+bool reshade::vulkan::runtime_vk::record_backbuffer_copy(VkBuffer intermediate) const
+{
 	if (!begin_command_buffer())
 		return false;
 	const VkCommandBuffer cmd_list = _cmd_buffers[_cmd_index].first;
@@ -569,44 +608,67 @@ bool reshade::vulkan::runtime_vk::capture_screenshot(uint8_t *buffer) const
 	}
 	transition_layout(vk, cmd_list, _swapchain_images[_swap_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
-	// Execute and wait for completion
-	execute_command_buffer();
+	return true;
+}
 
-	// Copy data from intermediate image into output buffer
-	uint8_t *mapped_data;
-	check_result(vk.MapMemory(_device, intermediate_mem, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&mapped_data))) false;
+bool reshade::vulkan::runtime_vk::begin_readback(unsigned int slot)
+{
+	// The copy is recorded into the command buffer of the current frame, which is only available during 'on_present'
+	if (_cmd_index >= NUM_COMMAND_FRAMES)
+		return false;
 
-	for (uint32_t y = 0; y < _height; y++, buffer += data_pitch, mapped_data += data_pitch)
+	// The readback buffers are kept around and stay mapped until the next reset, so that continuous captures do not have to create new ones every time
+	if (_readback_buffers[slot] == VK_NULL_HANDLE)
 	{
-		if (_backbuffer_format == VK_FORMAT_A2R10G10B10_UNORM_PACK32 ||
-			_backbuffer_format == VK_FORMAT_A2R10G10B10_SNORM_PACK32 ||
-			_backbuffer_format == VK_FORMAT_A2R10G10B10_USCALED_PACK32 ||
-			_backbuffer_format == VK_FORMAT_A2R10G10B10_SSCALED_PACK32)
-		{
-			for (uint32_t x = 0; x < data_pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ((rgba & 0x3FF) / 4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0xFFC00) >> 10) / 4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) / 4) & 0xFF;
-				buffer[x + 3] = 0xFF;
-			}
-		}
-		else
-		{
-			std::memcpy(buffer, mapped_data, data_pitch);
+		vk_handle<VK_OBJECT_TYPE_BUFFER> intermediate(_device, vk);
+		vk_handle<VK_OBJECT_TYPE_DEVICE_MEMORY> intermediate_mem(_device, vk);
 
-			for (uint32_t x = 0; x < data_pitch; x += 4)
-			{
-				buffer[x + 3] = 0xFF; // Clear alpha channel
-				if (_backbuffer_format >= VK_FORMAT_B8G8R8A8_UNORM && _backbuffer_format <= VK_FORMAT_B8G8R8A8_SRGB)
-					std::swap(buffer[x + 0], buffer[x + 2]); // Format is BGRA, but output should be RGBA, so flip channels
-			}
-		}
+		VkBufferCreateInfo create_info { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+		create_info.size = _width * _height * calc_pixel_size(_backbuffer_format);
+		create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		check_result(vk.CreateBuffer(_device, &create_info, nullptr, &intermediate)) false;
+
+		VkMemoryRequirements reqs = {};
+		vk.GetBufferMemoryRequirements(_device, intermediate, &reqs);
+
+		// Prefer cached memory, since the data is read by the CPU
+		VkMemoryAllocateInfo alloc_info { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+		alloc_info.allocationSize = reqs.size;
+		alloc_info.memoryTypeIndex = find_memory_type_index(_memory_props,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, reqs.memoryTypeBits);
+		if (alloc_info.memoryTypeIndex == std::numeric_limits<uint32_t>::max())
+			alloc_info.memoryTypeIndex = find_memory_type_index(_memory_props,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, reqs.memoryTypeBits);
+
+		if (alloc_info.memoryTypeIndex == std::numeric_limits<uint32_t>::max())
+			return false;
+
+		check_result(vk.AllocateMemory(_device, &alloc_info, nullptr, &intermediate_mem)) false;
+		check_result(vk.BindBufferMemory(_device, intermediate, intermediate_mem, 0)) false;
+		check_result(vk.MapMemory(_device, intermediate_mem, 0, VK_WHOLE_SIZE, 0, &_readback_data[slot])) false;
+
+		_readback_buffers[slot] = intermediate.release();
+		_readback_mem[slot] = intermediate_mem.release();
 	}
 
-	vk.UnmapMemory(_device, intermediate_mem);
+	if (!record_backbuffer_copy(_readback_buffers[slot]))
+		return false;
+
+	// Do not execute the command buffer here, it is submitted together with all other commands of this frame
+	// Remember which one it was, so that its fence can be checked when the data is read back
+	_readback_cmd_index[slot] = _cmd_index;
+
+	return true;
+}
+bool reshade::vulkan::runtime_vk::finish_readback(unsigned int slot, uint8_t *buffer)
+{
+	// The command buffer with the copy was submitted a few frames ago, so it has usually finished by now and this does not stall
+	const VkFence fence = _cmd_fences[_readback_cmd_index[slot]];
+	check_result(vk.WaitForFences(_device, 1, &fence, VK_TRUE, UINT64_MAX)) false;
+
+	copy_screenshot_data(_backbuffer_format, _width, _height, static_cast<const uint8_t *>(_readback_data[slot]), buffer);
 
 	return true;
 }
@@ -636,7 +698,11 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 	vulkan_effect_data &effect_data = _effect_data[index];
 	effect_data.module = effect.module;
 
+	// The query pool, pipeline layout, uniform buffer and descriptor sets are shared by all techniques, so they already exist if this effect was initialized for other techniques before
+	const bool is_initialized = effect_data.pipeline_layout != VK_NULL_HANDLE;
+
 	// Create query pool for time measurements
+	if (!is_initialized)
 	{   VkQueryPoolCreateInfo create_info { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
 		create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
 		create_info.queryCount = static_cast<uint32_t>(effect.module.techniques.size() * 2 * NUM_COMMAND_FRAMES);
@@ -645,6 +711,7 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 	}
 
 	// Initialize pipeline layout
+	if (!is_initialized)
 	{   std::vector<VkDescriptorSetLayoutBinding> bindings;
 		bindings.reserve(effect.module.num_sampler_bindings);
 		for (uint32_t i = 0; i < effect.module.num_sampler_bindings; ++i)
@@ -659,6 +726,7 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 
 	const VkDescriptorSetLayout set_layouts[2] = { _effect_descriptor_layout, effect_data.set_layout };
 
+	if (!is_initialized)
 	{   VkPipelineLayoutCreateInfo create_info { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
 		create_info.setLayoutCount = 2; // [0] = Global UBO, [1] = Samplers
 		create_info.pSetLayouts = set_layouts;
@@ -667,7 +735,7 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 	}
 
 	// Create global uniform buffer object
-	if (!effect.uniform_data_storage.empty())
+	if (!effect.uniform_data_storage.empty() && effect_data.ubo == VK_NULL_HANDLE)
 	{
 		effect_data.ubo = create_buffer(
 			effect.uniform_data_storage.size(),
@@ -682,7 +750,7 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 	{
 		const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
 			[&texture_name = info.texture_name](const auto &item) {
-			return item.unique_name == texture_name && item.impl != nullptr;
+			return item.unique_name == texture_name;
 		});
 		if (existing_texture == _textures.end())
 			return false;
@@ -704,7 +772,11 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 			effect_data.depth_image_binding = info.binding;
 			break;
 		default:
-			image_binding.imageView = existing_texture->impl->as<vulkan_tex_data>()->view[info.srgb];
+			// Textures only used by techniques that are not enabled yet were not created, but the descriptor set is shared by all techniques, so still have to bind something valid
+			if (existing_texture->impl == nullptr)
+				image_binding.imageView = _empty_depth_image_view;
+			else
+				image_binding.imageView = existing_texture->impl->as<vulkan_tex_data>()->view[info.srgb];
 			break;
 		}
 
@@ -789,12 +861,16 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 		alloc_info.descriptorSetCount = 2;
 		alloc_info.pSetLayouts = set_layouts;
 
-		if (vk.AllocateDescriptorSets(_device, &alloc_info, effect_data.set) != VK_SUCCESS)
+		if (!is_initialized && vk.AllocateDescriptorSets(_device, &alloc_info, effect_data.set) != VK_SUCCESS)
 		{
 			LOG(ERROR) << "Too many effects loaded. Only " << (MAX_EFFECT_DESCRIPTOR_SETS / 2) << " effects can be active simultaneously in Vulkan.";
 			return false;
 		}
 
+		// Make sure all previous frames have finished before updating descriptors of techniques that were already initialized (since they may be in use otherwise)
+		if (is_initialized)
+			wait_for_command_buffers();
+
 		uint32_t num_writes = 0;
 		VkWriteDescriptorSet writes[2];
 		const VkDescriptorBufferInfo ubo_info = { effect_data.ubo, 0, VK_WHOLE_SIZE };
@@ -840,13 +916,19 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 	uint32_t technique_index = 0;
 	for (technique &technique : _techniques)
 	{
-		if (technique.impl != nullptr || technique.effect_index != index)
+		if (technique.effect_index != index)
+			continue;
+
+		// Count all techniques of this effect, so that the query index does not depend on which of them were initialized together
+		const uint32_t query_index = technique_index++ * 2 * NUM_COMMAND_FRAMES;
+
+		if (!is_technique_pending(technique, index))
 			continue;
 
 		technique.impl = std::make_unique<vulkan_technique_data>();
 		auto &technique_data = *technique.impl->as<vulkan_technique_data>();
 		// Offset index so that a query exists for each command frame and two subsequent ones are used for before/after stamps
-		technique_data.query_index = technique_index++ * 2 * NUM_COMMAND_FRAMES;
+		technique_data.query_index = query_index;
 
 		for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 		{
@@ -1275,9 +1357,17 @@ void reshade::vulkan::runtime_vk::upload_texture(texture &texture, const uint8_t
 	auto impl = texture.impl->as<vulkan_tex_data>();
 	assert(impl != nullptr && pixels != nullptr && texture.impl_reference == texture_reference::none);
 
+	// Images are always loaded as RGBA, so they are converted to the layout of the texture while filling the upload buffer
+	const pixel_format format = pixel_format_from_texture_format(texture.format);
+	if (format == pixel_format::unknown)
+	{
+		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
+		return;
+	}
+
 	// Allocate host memory for upload
 	vk_handle<VK_OBJECT_TYPE_BUFFER> intermediate(_device, vk,
-		create_buffer(texture.width * texture.height * 4, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+		create_buffer(texture.width * texture.height * pixel_format_size(format), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
 	if (intermediate == VK_NULL_HANDLE)
 		return;
 	vk_handle<VK_OBJECT_TYPE_DEVICE_MEMORY> intermediate_mem(_device, vk, _allocations.back());
@@ -1287,33 +1377,11 @@ void reshade::vulkan::runtime_vk::upload_texture(texture &texture, const uint8_t
 	uint8_t *mapped_data;
 	check_result(vk.MapMemory(_device, intermediate_mem, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&mapped_data)));
 
-	bool unsupported_format = false;
-	switch (texture.format)
-	{
-	case reshadefx::texture_format::r8:
-		for (uint32_t y = 0; y < texture.height; ++y, mapped_data += texture.width * 1, pixels += texture.width * 4)
-			for (uint32_t x = 0; x < texture.width; ++x)
-				mapped_data[x] = pixels[x * 4];
-		break;
-	case reshadefx::texture_format::rg8:
-		for (uint32_t y = 0; y < texture.height; ++y, mapped_data += texture.width * 2, pixels += texture.width * 4)
-			for (uint32_t x = 0; x < texture.width; ++x)
-				mapped_data[x * 2 + 0] = pixels[x * 4 + 0],
-				mapped_data[x * 2 + 1] = pixels[x * 4 + 1];
-		break;
-	case reshadefx::texture_format::rgba8:
-		for (uint32_t y = 0; y < texture.height; ++y, mapped_data += texture.width * 4, pixels += texture.width * 4)
-			std::memcpy(mapped_data, pixels, texture.width * 4);
-		break;
-	default:
-		unsupported_format = true;
-		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << '!';
-		break;
-	}
+	convert_pixels(pixel_format::rgba8_unorm, pixels, texture.width * 4, format, mapped_data, texture.width * pixel_format_size(format), texture.width, texture.height);
 
 	vk.UnmapMemory(_device, intermediate_mem);
 
-	if (unsupported_format || !begin_command_buffer())
+	if (!begin_command_buffer())
 		return;
 	const VkCommandBuffer cmd_list = _cmd_buffers[_cmd_index].first;
 
@@ -1386,8 +1454,9 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 	vk.CmdBindDescriptorSets(cmd_list, VK_PIPELINE_BIND_POINT_GRAPHICS, effect_data.pipeline_layout, 0, 2, effect_data.set, 0, nullptr);
 
 	// Setup shader constants
-	if (effect_data.ubo != VK_NULL_HANDLE)
-		vk.CmdUpdateBuffer(cmd_list, effect_data.ubo, 0, _effects[technique.effect_index].uniform_data_storage.size(), _effects[technique.effect_index].uniform_data_storage.data());
+	// The buffer keeps its contents, so only the modified ranges have to be written (offsets and sizes are multiples of four, as required by 'vkCmdUpdateBuffer', since all uniforms are)
+	for (size_t offset, size; effect_data.ubo != VK_NULL_HANDLE && consume_uniform_data_changes(technique.effect_index, offset, size);)
+		vk.CmdUpdateBuffer(cmd_list, effect_data.ubo, offset, size, _effects[technique.effect_index].uniform_data_storage.data() + offset);
 
 	// Clear default depth stencil
 	const VkImageSubresourceRange clear_range = { VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, 0, 1, 0, 1 };
@@ -43,6 +43,11 @@ namespace reshade::vulkan
 
 		void render_technique(technique &technique) override;
 
+		bool supports_readback() const override { return true; }
+		bool begin_readback(unsigned int slot) override;
+		bool finish_readback(unsigned int slot, uint8_t *buffer) override;
+		bool record_backbuffer_copy(VkBuffer intermediate) const;
+
 		bool begin_command_buffer() const;
 		void execute_command_buffer() const;
 		void wait_for_command_buffers();
@@ -76,6 +81,11 @@ namespace reshade::vulkan
 		VkImage _empty_depth_image = VK_NULL_HANDLE;
 		VkImageView _empty_depth_image_view = VK_NULL_HANDLE;
 
+		void *_readback_data[NUM_READBACK_SLOTS] = {};
+		VkBuffer _readback_buffers[NUM_READBACK_SLOTS] = {};
+		VkDeviceMemory _readback_mem[NUM_READBACK_SLOTS] = {};
+		uint32_t _readback_cmd_index[NUM_READBACK_SLOTS] = {};
+
 		std::vector<VkDeviceMemory> _allocations;
 
 		VkImage _effect_depthstencil = VK_NULL_HANDLE;
@@ -0,0 +1,419 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_lexer.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_preprocessor.hpp"
+#include "version.h"
+#include <new>
+#include <cstddef> // std::max_align_t
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+// Count all heap allocations made by the compiler, so that regressions in allocation behavior show up next to the timings
+static std::atomic<size_t> s_num_allocations = 0;
+static std::atomic<size_t> s_allocated_bytes = 0;
+static std::atomic<size_t> s_current_bytes = 0;
+static std::atomic<size_t> s_peak_bytes = 0;
+
+// Each allocation is prefixed with its size, so that the amount of live memory can be tracked on deallocation
+static constexpr size_t s_header_size = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+
+void *operator new(size_t size)
+{
+	const auto block = static_cast<char *>(std::malloc(size + s_header_size));
+	if (block == nullptr)
+		throw std::bad_alloc();
+
+	*reinterpret_cast<size_t *>(block) = size;
+
+	s_num_allocations++;
+	s_allocated_bytes += size;
+	const size_t current = s_current_bytes += size;
+	for (size_t peak = s_peak_bytes; current > peak && !s_peak_bytes.compare_exchange_weak(peak, current);)
+		continue;
+
+	return block + s_header_size;
+}
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	try { return operator new(size); } catch (const std::bad_alloc &) { return nullptr; }
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+void operator delete(void *ptr) noexcept
+{
+	if (ptr == nullptr)
+		return;
+
+	const auto block = static_cast<char *>(ptr) - s_header_size;
+	s_current_bytes -= *reinterpret_cast<size_t *>(block);
+
+	std::free(block);
+}
+void operator delete[](void *ptr) noexcept
+{
+	operator delete(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+void operator delete[](void *ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+	operator delete(ptr);
+}
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+	operator delete(ptr);
+}
+
+struct stage_result
+{
+	std::vector<double> times; // In seconds, one entry per measured run
+	size_t tokens = 0;
+	size_t bytes = 0;
+	size_t allocations = 0;
+	size_t allocated_bytes = 0;
+	size_t peak_bytes = 0;
+};
+
+class stage_timer
+{
+public:
+	explicit stage_timer(stage_result &result, bool record) : _result(result), _record(record)
+	{
+		_allocations = s_num_allocations;
+		_allocated_bytes = s_allocated_bytes;
+		_base_bytes = s_current_bytes;
+		s_peak_bytes = _base_bytes;
+		_start = std::chrono::high_resolution_clock::now();
+	}
+	~stage_timer()
+	{
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		if (!_record)
+			return;
+
+		_result.times.push_back(std::chrono::duration<double>(end - _start).count());
+		// Allocation behavior is deterministic, so the values of the last run are representative for all of them
+		_result.allocations = s_num_allocations - _allocations;
+		_result.allocated_bytes = s_allocated_bytes - _allocated_bytes;
+		_result.peak_bytes = s_peak_bytes - _base_bytes;
+	}
+
+private:
+	stage_result &_result;
+	bool _record;
+	size_t _allocations;
+	size_t _allocated_bytes;
+	size_t _base_bytes;
+	std::chrono::high_resolution_clock::time_point _start;
+};
+
+static std::string escape_json(const std::string &s)
+{
+	std::string result;
+	result.reserve(s.size());
+	for (const char c : s)
+	{
+		if (c == '\\' || c == '\"')
+			result += '\\';
+		if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			result += buf;
+			continue;
+		}
+		result += c;
+	}
+	return result;
+}
+
+static void write_stage_json(std::ostream &out, const char *name, const stage_result &result)
+{
+	std::vector<double> times = result.times;
+	std::sort(times.begin(), times.end());
+
+	double mean = 0.0;
+	for (const double time : times)
+		mean += time;
+	mean /= times.size();
+	const double median = times.size() % 2 ? times[times.size() / 2] : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+
+	char buf[1024];
+	snprintf(buf, sizeof(buf),
+		"\"%s\": { \"runs\": %zu, \"min_ms\": %.4f, \"median_ms\": %.4f, \"mean_ms\": %.4f, \"max_ms\": %.4f, "
+		"\"tokens\": %zu, \"tokens_per_sec\": %.0f, \"bytes\": %zu, \"bytes_per_sec\": %.0f, "
+		"\"allocations\": %zu, \"allocated_bytes\": %zu, \"peak_bytes\": %zu }",
+		name, times.size(), times.front() * 1000.0, median * 1000.0, mean * 1000.0, times.back() * 1000.0,
+		result.tokens, result.tokens / median, result.bytes, result.bytes / median,
+		result.allocations, result.allocated_bytes, result.peak_bytes);
+	out << buf;
+}
+
+static void print_usage(const char *path)
+{
+	printf(R"(usage: %s [options] <file or directory>...
+
+Compiles every effect file in the given corpus repeatedly and prints timings for each compiler stage as JSON.
+Directories are searched recursively for '.fx' files.
+
+Options:
+  -h, --help                Print this help.
+  --version                 Print ReShade version.
+
+  -D <id>=<text>            Define a preprocessor macro.
+  -I <path>                 Add directory to include search path.
+  -o <file>                 Write the JSON report to the given file instead of standard output.
+
+  --runs <count>            Number of measured runs per file and stage (default 10).
+  --warmup <count>          Number of unmeasured runs per file and stage before measuring (default 1). These also fill the shared include file cache.
+  --shader-model <value>    HLSL shader model version. Can be 30, 40, 41, 50, ...
+	)", path);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *outputfile = nullptr;
+	unsigned int num_runs = 10;
+	unsigned int num_warmup_runs = 1;
+	unsigned int shader_model = 50;
+	std::vector<std::filesystem::path> corpus;
+	std::vector<std::filesystem::path> include_paths;
+	std::vector<std::pair<std::string, std::string>> macros = {
+		{ "__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION) },
+		{ "__RESHADE_PERFORMANCE_MODE__", "0" },
+		{ "BUFFER_WIDTH", "800" },
+		{ "BUFFER_HEIGHT", "600" },
+		{ "BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)" },
+		{ "BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)" },
+	};
+
+	// Parse command-line arguments
+	for (int i = 1; i < argc; ++i)
+	{
+		if (const char *arg = argv[i]; arg[0] == '-')
+		{
+			if (0 == std::strcmp(arg, "-h") || 0 == std::strcmp(arg, "--help"))
+			{
+				print_usage(argv[0]);
+				return 0;
+			}
+			if (0 == std::strcmp(arg, "--version"))
+			{
+				printf("%s\n", VERSION_STRING_PRODUCT);
+				return 0;
+			}
+
+			if (i + 1 >= argc)
+				continue;
+			else if (0 == std::strcmp(arg, "-D"))
+			{
+				char *macro = argv[++i];
+				char *value = std::strchr(macro, '=');
+				if (value) *value++ = '\0';
+				macros.emplace_back(macro, value ? value : "1");
+			}
+			else if (0 == std::strcmp(arg, "-I"))
+				include_paths.push_back(argv[++i]);
+			else if (0 == std::strcmp(arg, "-o"))
+				outputfile = argv[++i];
+			else if (0 == std::strcmp(arg, "--runs"))
+				num_runs = std::max(1u, static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10)));
+			else if (0 == std::strcmp(arg, "--warmup"))
+				num_warmup_runs = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+			else if (0 == std::strcmp(arg, "--shader-model"))
+				shader_model = std::strtol(argv[++i], nullptr, 10);
+		}
+		else
+		{
+			std::error_code ec;
+			if (std::filesystem::is_directory(arg, ec))
+			{
+				for (const auto &entry : std::filesystem::recursive_directory_iterator(arg, std::filesystem::directory_options::skip_permission_denied, ec))
+					if (entry.path().extension() == ".fx")
+						corpus.push_back(entry.path());
+			}
+			else
+			{
+				corpus.push_back(arg);
+			}
+		}
+	}
+
+	if (corpus.empty())
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	// Sort so that reports of different runs can be compared line by line
+	std::sort(corpus.begin(), corpus.end());
+
+	std::ofstream file;
+	if (outputfile != nullptr)
+		file.open(outputfile);
+	std::ostream &out = outputfile != nullptr ? file : std::cout;
+
+	out << "{\n\t\"version\": \"" << VERSION_STRING_PRODUCT << "\",\n\t\"runs\": " << num_runs << ",\n\t\"files\": [";
+
+	bool success = true;
+
+	for (size_t file_index = 0; file_index < corpus.size(); ++file_index)
+	{
+		const std::filesystem::path &path = corpus[file_index];
+
+		stage_result preprocessor_result, lexer_result, backtrack_result;
+		stage_result parser_results[3], write_results[3];
+		static const char *const backend_names[3] = { "spirv", "glsl", "hlsl" };
+
+		std::string source, errors;
+		bool failed = false;
+
+		for (unsigned int run = 0; run < num_warmup_runs + num_runs && !failed; ++run)
+		{
+			const bool record = run >= num_warmup_runs;
+
+			{	stage_timer timer(preprocessor_result, record);
+
+				reshadefx::preprocessor pp;
+				for (const auto &include_path : include_paths)
+					pp.add_include_path(include_path);
+				for (const auto &macro : macros)
+					pp.add_macro_definition(macro.first, macro.second);
+
+				if (!pp.append_file(path))
+				{
+					errors = pp.errors();
+					failed = true;
+					break;
+				}
+
+				source = std::move(pp.output());
+			}
+
+			preprocessor_result.bytes = source.size();
+
+			// The lexer is measured in isolation on the pre-processed output, which is what the parser consumes
+			{	stage_timer timer(lexer_result, record);
+
+				size_t num_tokens = 0;
+				reshadefx::lexer lexer(source);
+				for (reshadefx::token tok; (tok = lexer.lex()).id != reshadefx::tokenid::end_of_file;)
+					num_tokens++;
+
+				lexer_result.tokens = num_tokens;
+				lexer_result.bytes = source.size();
+			}
+
+			// The parser backs up the lexer for speculative parses (e.g. to check whether a parenthesis starts a cast), so measure that on its own by doing the same at every opening parenthesis
+			// A backup copies the lexer into a reused object and looks ahead from it, which has to stay cheap no matter how large the input is
+			{	stage_timer timer(backtrack_result, record);
+
+				size_t num_tokens = 0;
+				reshadefx::lexer lexer(source);
+				reshadefx::lexer backup(lexer);
+				for (reshadefx::token tok; (tok = lexer.lex()).id != reshadefx::tokenid::end_of_file;)
+				{
+					num_tokens++;
+
+					if (tok.id == reshadefx::tokenid::parenthesis_open)
+					{
+						backup = lexer;
+						backup.lex();
+						backup.lex();
+					}
+				}
+
+				backtrack_result.tokens = num_tokens;
+				backtrack_result.bytes = source.size();
+			}
+
+			// The parser drives the code generator directly, so each back-end is measured together with parsing, followed by finalizing the module separately
+			for (int backend_index = 0; backend_index < 3 && !failed; ++backend_index)
+			{
+				std::unique_ptr<reshadefx::codegen> backend;
+				if (backend_index == 0)
+					backend.reset(reshadefx::create_codegen_spirv(true, false, false));
+				else if (backend_index == 1)
+					backend.reset(reshadefx::create_codegen_glsl(false, false));
+				else
+					backend.reset(reshadefx::create_codegen_hlsl(shader_model, false, false));
+
+				reshadefx::parser parser;
+
+				{	stage_timer timer(parser_results[backend_index], record);
+
+					if (!parser.parse(source, backend.get()))
+					{
+						errors = parser.errors();
+						failed = true;
+						continue;
+					}
+				}
+
+				parser_results[backend_index].tokens = lexer_result.tokens;
+				parser_results[backend_index].bytes = source.size();
+
+				reshadefx::module module;
+
+				{	stage_timer timer(write_results[backend_index], record);
+
+					backend->write_result(module);
+				}
+
+				write_results[backend_index].bytes = backend_index == 0 ? module.spirv.size() * sizeof(uint32_t) : module.hlsl.size();
+			}
+		}
+
+		out << (file_index != 0 ? ",\n" : "\n") << "\t\t{\n\t\t\t\"file\": \"" << escape_json(path.u8string()) << "\",\n";
+
+		if (failed)
+		{
+			success = false;
+			out << "\t\t\t\"error\": \"" << escape_json(errors) << "\"\n\t\t}";
+			continue;
+		}
+
+		out << "\t\t\t\"source_bytes\": " << std::filesystem::file_size(path) << ",\n\t\t\t\"stages\": {\n\t\t\t\t";
+		write_stage_json(out, "preprocessor", preprocessor_result);
+		out << ",\n\t\t\t\t";
+		write_stage_json(out, "lexer", lexer_result);
+		out << ",\n\t\t\t\t";
+		write_stage_json(out, "lexer_backtrack", backtrack_result);
+		for (int backend_index = 0; backend_index < 3; ++backend_index)
+		{
+			out << ",\n\t\t\t\t";
+			write_stage_json(out, ("parser_" + std::string(backend_names[backend_index])).c_str(), parser_results[backend_index]);
+			out << ",\n\t\t\t\t";
+			write_stage_json(out, ("write_" + std::string(backend_names[backend_index])).c_str(), write_results[backend_index]);
+		}
+		out << "\n\t\t\t}\n\t\t}";
+	}
+
+	out << "\n\t]\n}" << std::endl;
+
+	return success ? 0 : 1;
+}
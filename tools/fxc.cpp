@@ -3,6 +3,8 @@
  * License: https://github.com/crosire/reshade#license
  */
 
+#include "effect_cache.hpp"
+#include "effect_binary.hpp"
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
@@ -12,6 +14,15 @@
 #include <fstream>
 #include <iostream>
 
+static size_t count_spirv_instructions(const std::vector<uint32_t> &spirv)
+{
+	size_t count = 0;
+	// Skip the 5 word header, each instruction then starts with a word containing its word count in the high 16 bits
+	for (size_t i = 5; i < spirv.size() && (spirv[i] >> 16) != 0; i += spirv[i] >> 16)
+		++count;
+	return count;
+}
+
 static void print_usage(const char *path)
 {
 	printf(R"(usage: %s [options] <filename>
@@ -26,6 +37,7 @@ Options:
 
   -Fo <file>                Output SPIR-V binary to the given file.
   -Fe <file>                Output warnings and errors to the given file.
+  -Fm <file>                Output the compiled effect module (all code, textures, samplers, uniforms and techniques) in binary format to the given file.
 
   --glsl                    Print GLSL code for the previously specified entry point.
   --hlsl                    Print HLSL code for the previously specified entry point.
@@ -37,6 +49,9 @@ Options:
   --spec-constants          Convert uniform variables to specialization constants.
 
   -Zi                       Enable debug information.
+  -O                        Optimize the generated SPIR-V and print how much it reduced the module size.
+
+  --cache <path>            Look up the compiled result in the effect cache directory at <path> before compiling and store it there afterwards.
 	)", path);
 }
 
@@ -46,11 +61,14 @@ int main(int argc, char *argv[])
 	const char *preprocess = nullptr;
 	const char *errorfile = nullptr;
 	const char *objectfile = nullptr;
+	const char *modulefile = nullptr;
+	const char *cache_path = nullptr;
 	const char *buffer_width = "800";
 	const char *buffer_height = "600";
 	bool print_glsl = false;
 	bool print_hlsl = false;
 	bool debug_info = false;
+	bool optimize = false;
 	bool invert_y_axis = false;
 	bool spec_constants = false;
 	unsigned int shader_model = 50;
@@ -93,6 +111,8 @@ int main(int argc, char *argv[])
 
 			if (0 == std::strcmp(arg, "-Zi"))
 				debug_info = true;
+			else if (0 == std::strcmp(arg, "-O"))
+				optimize = true;
 			else if (0 == std::strcmp(arg, "--glsl"))
 				print_glsl = true;
 			else if (0 == std::strcmp(arg, "--hlsl"))
@@ -110,12 +130,16 @@ int main(int argc, char *argv[])
 				errorfile = argv[++i];
 			else if (0 == std::strcmp(arg, "-Fo"))
 				objectfile = argv[++i];
+			else if (0 == std::strcmp(arg, "-Fm"))
+				modulefile = argv[++i];
 			else if (0 == std::strcmp(arg, "--shader-model"))
 				shader_model = std::strtol(argv[++i], nullptr, 10);
 			else if (0 == std::strcmp(arg, "--width"))
 				buffer_width = argv[++i];
 			else if (0 == std::strcmp(arg, "--height"))
 				buffer_height = argv[++i];
+			else if (0 == std::strcmp(arg, "--cache"))
+				cache_path = argv[++i];
 		}
 		else
 		{
@@ -158,25 +182,73 @@ int main(int argc, char *argv[])
 		return 0;
 	}
 
-	std::unique_ptr<reshadefx::codegen> backend;
-	if (print_glsl)
-		backend.reset(reshadefx::create_codegen_glsl(debug_info, spec_constants));
-	else if (print_hlsl)
-		backend.reset(reshadefx::create_codegen_hlsl(shader_model, debug_info, spec_constants));
-	else
-		backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, invert_y_axis));
+	// Describe the code generation settings for the cache key (this intentionally differs from the runtime, since the renderer is unknown here)
+	std::string cache_settings = "version=" VERSION_STRING_FILE " " VERSION_DATE " " VERSION_TIME ";fxc";
+	cache_settings += print_glsl ? ";glsl" : print_hlsl ? ";hlsl" + std::to_string(shader_model) : invert_y_axis ? ";spirv_invert_y" : ";spirv";
+	cache_settings += ";debug_info=" + std::to_string(debug_info);
+	cache_settings += ";spec_constants=" + std::to_string(spec_constants);
+	cache_settings += ";optimize=" + std::to_string(optimize);
+
+	const reshadefx::module_cache cache(cache_path != nullptr ? cache_path : std::filesystem::path());
+
+	reshadefx::module module;
+	std::string warnings;
 
-	if (!parser.parse(pp.output(), backend.get()))
+	if (!cache.load(pp.output(), cache_settings, module, warnings))
 	{
-		if (errorfile == nullptr)
-			std::cout << pp.errors() << parser.errors() << std::endl;
+		std::unique_ptr<reshadefx::codegen> backend;
+		if (print_glsl)
+			backend.reset(reshadefx::create_codegen_glsl(debug_info, spec_constants));
+		else if (print_hlsl)
+			backend.reset(reshadefx::create_codegen_hlsl(shader_model, debug_info, spec_constants));
 		else
-			std::ofstream(errorfile) << pp.errors() << parser.errors();
-		return 1;
+			backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, invert_y_axis));
+
+		if (!parser.parse(pp.output(), backend.get()))
+		{
+			if (errorfile == nullptr)
+				std::cout << pp.errors() << parser.errors() << std::endl;
+			else
+				std::ofstream(errorfile) << pp.errors() << parser.errors();
+			return 1;
+		}
+
+		backend->write_result(module);
+
+		// Optimize here instead of in the back-end, so that the size before and after can be reported
+		if (optimize && !print_glsl && !print_hlsl)
+		{
+			const size_t size_before = module.spirv.size() * sizeof(uint32_t);
+			const size_t instructions_before = count_spirv_instructions(module.spirv);
+
+			if (reshadefx::optimize_spirv(module.spirv))
+			{
+				const size_t size_after = module.spirv.size() * sizeof(uint32_t);
+				const size_t instructions_after = count_spirv_instructions(module.spirv);
+
+				printf("SPIR-V size: %zu -> %zu bytes (%.1f%%), %zu -> %zu instructions (%.1f%%)\n",
+					size_before, size_after, 100.0 * size_after / size_before,
+					instructions_before, instructions_after, 100.0 * instructions_after / instructions_before);
+			}
+			else
+			{
+				std::cout << "warning: SPIR-V module contains unsupported instructions and was not optimized" << std::endl;
+			}
+		}
+
+		warnings = parser.errors();
+		if (cache_path != nullptr && !cache.save(pp.output(), cache_settings, module, warnings))
+			std::cout << "warning: Failed to write to effect cache in " << cache_path << std::endl;
 	}
 
-	reshadefx::module module;
-	backend->write_result(module);
+	if (modulefile != nullptr)
+	{
+		std::vector<uint8_t> data;
+		reshadefx::write_binary_module(module, data);
+
+		std::ofstream(modulefile, std::ios::binary).write(
+			reinterpret_cast<const char *>(data.data()), data.size());
+	}
 
 	if (print_glsl || print_hlsl)
 	{
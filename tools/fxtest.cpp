@@ -0,0 +1,196 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_lexer.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "fxtest_lexer_reference.hpp"
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <filesystem>
+
+// Compiles small effect snippets and checks the generated code for regressions in the expression simplification done by the parser
+struct test_case
+{
+	const char *name;
+	const char *code;
+	const char *snapshot; // Copy of the variable that has to be taken ...
+	const char *side_effect; // ... before this statement modifies it
+	const char *stale_read; // Reading the variable directly in the final operation would see the modified value
+};
+
+static const test_case s_test_cases[] = {
+	{ "identity addition before assignment", "float z = 1; return (z + 0) * (z = 3);", "= z;", "z = 3", "= z *" },
+	{ "identity multiplication before increment", "float z = 1; return (z * 1) + (z++);", "= z;", "z = _", "= z +" },
+};
+
+static bool run_test(const test_case &test, const char *backend_name, reshadefx::codegen *backend)
+{
+	const std::string source =
+		"float4 main() : SV_Target { " + std::string(test.code) + " }\n"
+		"technique T { pass { VertexShader = main; PixelShader = main; } }\n";
+
+	reshadefx::parser parser;
+	if (!parser.parse(source, backend))
+	{
+		printf("FAILED %s (%s): %s", test.name, backend_name, parser.errors().c_str());
+		return false;
+	}
+
+	reshadefx::module module;
+	backend->write_result(module);
+
+	// Only look at the body of the entry point function
+	const std::string &code = module.hlsl;
+	const size_t body = code.find("float z = ");
+	const size_t snapshot = code.find(test.snapshot, body + 1);
+	const size_t side_effect = code.find(test.side_effect, body + 1);
+
+	if (body == std::string::npos || snapshot == std::string::npos || side_effect == std::string::npos || snapshot > side_effect)
+	{
+		printf("FAILED %s (%s): expected '%s' before '%s' in\n%s\n", test.name, backend_name, test.snapshot, test.side_effect, code.c_str());
+		return false;
+	}
+	if (code.find(test.stale_read, side_effect) != std::string::npos)
+	{
+		printf("FAILED %s (%s): unexpected '%s' after '%s' in\n%s\n", test.name, backend_name, test.stale_read, test.side_effect, code.c_str());
+		return false;
+	}
+
+	printf("passed %s (%s)\n", test.name, backend_name);
+	return true;
+}
+
+// Lexes inputs with both the current lexer and the reference copy of the lexer before it was optimized and checks that the token streams are identical
+struct lexer_test_case
+{
+	const char *name;
+	const char *code;
+};
+
+static const lexer_test_case s_lexer_test_cases[] = {
+	{ "empty input", "" },
+	{ "whitespace", " \t\v\f a \t b\n  \n\t\n" },
+	{ "unterminated string", "float a = \"abc\nfloat b;" },
+	{ "unterminated string at end of input", "\"abc" },
+	{ "unterminated block comment", "a /* b\n c" },
+	{ "comments", "a // b /* c\n/* d // e\n */ f /**/ g /* * / */" },
+	{ "string escapes", "\"\\t\\n\\x41\\101\\\"\\\\\" \"\\q\" \"\\x\"" },
+	{ "string line continuation", "\"ab\\\ncd\" x \"ef\\\r\ngh\"" },
+	{ "line continuation", "#define A 1 \\\n + 2\nA \\\n B" },
+	{ "crlf line endings", "float a;\r\n// c\r\n/* d\r\n */ #define X \\\r\n 1\r\n\"s\r\n" },
+	{ "numeric literals", "0 07 08 0x 0x1F 0XaBc 1. .5 1.5f 1e5 1E+5 1.0e- 2e-3f 4294967295 4294967296 1u 2U 1h 1.0l 0.5L 1.x 3.f" },
+	{ "operators", "! != # $ % %= & && &= ( ) * *= + ++ += , - -- -= -> . ... / /= : :: ; < << <<= <= = == > >= >> >>= ? @ [ ] ^ ^= { | |= || } ~ \\ `" },
+	{ "preprocessor directives", "# define X\n#  unknown\n#pragma once\n  #if 1\n#endif\n#include \"a.fxh\"\n#" },
+	{ "line directives", "#line 10 \"file.fx\"\na\n#line 0\nb\n#line 7\nc" },
+	{ "bytes above 0x7F", "\xC3\xA4 a\xFF b // \xE2\x82\xAC\n\"\xC3\xB6\" /* \x80 */ c" },
+};
+
+static bool compare_lexers(const std::string &name, std::string input)
+{
+	// Input always ends with a line feed, the same as files read by the preprocessor
+	if (input.empty() || input.back() != '\n')
+		input.push_back('\n');
+
+	const auto shared_input = std::make_shared<const std::string>(std::move(input));
+
+	static const struct { const char *name; bool ignore_comments, ignore_whitespace, ignore_pp_directives, ignore_line_directives, ignore_keywords, escape_string_literals; } s_modes[] = {
+		{ "parser", true, true, true, false, false, true },
+		{ "preprocessor", true, false, false, false, true, false },
+		{ "all tokens", false, false, false, true, false, false },
+		{ "all tokens escaped", false, false, false, false, true, true },
+	};
+
+	for (const auto &mode : s_modes)
+	{
+		reshadefx::lexer lexer(shared_input, mode.ignore_comments, mode.ignore_whitespace, mode.ignore_pp_directives, mode.ignore_line_directives, mode.ignore_keywords, mode.escape_string_literals);
+		reshadefx::reference::lexer reference(shared_input, mode.ignore_comments, mode.ignore_whitespace, mode.ignore_pp_directives, mode.ignore_line_directives, mode.ignore_keywords, mode.escape_string_literals);
+
+		// Every token consumes at least one character, so more tokens than that means one of the lexers is stuck
+		for (size_t index = 0; index <= shared_input->size() + 1; ++index)
+		{
+			const reshadefx::token tok = lexer.lex();
+			const reshadefx::token ref = reference.lex();
+
+			// Columns are not compared, since the reference reports them one too high after multi-line block comments
+			if (tok.id != ref.id || tok.offset != ref.offset || tok.length != ref.length ||
+				std::memcmp(&tok.literal_as_double, &ref.literal_as_double, sizeof(double)) != 0 || tok.literal_as_string != ref.literal_as_string ||
+				tok.location.line != ref.location.line || tok.location.source != ref.location.source)
+			{
+				printf("FAILED lexer %s (%s): token %zu differs\n"
+					"  expected %s at offset %zu, length %zu, line %u, literal '%s'\n"
+					"  actual   %s at offset %zu, length %zu, line %u, literal '%s'\n",
+					name.c_str(), mode.name, index,
+					reshadefx::token::id_to_name(ref.id).c_str(), ref.offset, ref.length, ref.location.line, ref.literal_as_string.c_str(),
+					reshadefx::token::id_to_name(tok.id).c_str(), tok.offset, tok.length, tok.location.line, tok.literal_as_string.c_str());
+				return false;
+			}
+
+			if (tok.id == reshadefx::tokenid::end_of_file)
+				break;
+		}
+	}
+
+	printf("passed lexer %s\n", name.c_str());
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	bool success = true;
+
+	for (const test_case &test : s_test_cases)
+	{
+		success &= run_test(test, "hlsl", std::unique_ptr<reshadefx::codegen>(reshadefx::create_codegen_hlsl(50, false, false)).get());
+		success &= run_test(test, "glsl", std::unique_ptr<reshadefx::codegen>(reshadefx::create_codegen_glsl(false, false)).get());
+	}
+
+	for (const lexer_test_case &test : s_lexer_test_cases)
+		success &= compare_lexers(test.name, test.code);
+
+	// Every prefix of a keyword is an identifier (or a shorter keyword), which exercises all collision chains of the keyword lookup
+	std::string keyword_prefixes;
+	for (const std::string &keyword : reshadefx::reference::keyword_names())
+	{
+		for (size_t length = 1; length <= keyword.size(); ++length)
+			keyword_prefixes += keyword.substr(0, length) + '\n';
+		keyword_prefixes += keyword + "_ " + keyword + "0 " + keyword + "x\n";
+	}
+	success &= compare_lexers("keyword prefixes", keyword_prefixes);
+
+	// Also compare all shader files in the specified directories (defaults to the shaders shipped with ReShade when run from the repository root)
+	std::vector<std::filesystem::path> directories;
+	for (int i = 1; i < argc; ++i)
+		directories.push_back(std::filesystem::u8path(argv[i]));
+	if (directories.empty())
+		directories.push_back("res/shaders");
+
+	for (const std::filesystem::path &directory : directories)
+	{
+		std::error_code ec;
+		for (const auto &entry : std::filesystem::recursive_directory_iterator(directory, ec))
+		{
+			const std::filesystem::path extension = entry.path().extension();
+			if (!entry.is_regular_file() || (extension != ".fx" && extension != ".fxh" && extension != ".hlsl" && extension != ".glsl"))
+				continue;
+
+			std::stringstream data;
+			data << std::ifstream(entry.path(), std::ios::binary).rdbuf();
+			success &= compare_lexers(entry.path().u8string(), data.str());
+		}
+
+		if (ec)
+		{
+			printf("FAILED lexer: could not open directory '%s'\n", directory.u8string().c_str());
+			success = false;
+		}
+	}
+
+	return success ? 0 : 1;
+}
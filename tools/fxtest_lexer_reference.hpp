@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_token.hpp"
+#include <memory> // std::shared_ptr
+#include <vector>
+
+namespace reshadefx::reference
+{
+	/// <summary>
+	/// The lexical analyzer as it was before keyword lookup and scanning were optimized, used as reference to compare the token stream of the current one against.
+	/// </summary>
+	class lexer
+	{
+	public:
+		explicit lexer(
+			std::shared_ptr<const std::string> input,
+			bool ignore_comments = true,
+			bool ignore_whitespace = true,
+			bool ignore_pp_directives = true,
+			bool ignore_line_directives = false,
+			bool ignore_keywords = false,
+			bool escape_string_literals = true) :
+			_input(std::move(input)),
+			_ignore_comments(ignore_comments),
+			_ignore_whitespace(ignore_whitespace),
+			_ignore_pp_directives(ignore_pp_directives),
+			_ignore_line_directives(ignore_line_directives),
+			_ignore_keywords(ignore_keywords),
+			_escape_string_literals(escape_string_literals)
+		{
+			_cur = _input->data();
+			_end = _cur + _input->size();
+		}
+
+		/// <summary>
+		/// Perform lexical analysis on the input string and return the next token in sequence.
+		/// </summary>
+		/// <returns>The next token from the input string.</returns>
+		token lex();
+
+		/// <summary>
+		/// Advances to the next token that is not whitespace.
+		/// </summary>
+		void skip_space();
+		/// <summary>
+		/// Advances to the next new line, ignoring all tokens.
+		/// </summary>
+		void skip_to_next_line();
+
+	private:
+		/// <summary>
+		/// Skips an arbitrary amount of characters in the input string.
+		/// </summary>
+		/// <param name="length">The number of input characters to skip.</param>
+		void skip(size_t length);
+
+		void parse_identifier(token &tok) const;
+		bool parse_pp_directive(token &tok);
+		void parse_string_literal(token &tok, bool escape) const;
+		void parse_numeric_literal(token &tok) const;
+
+		std::shared_ptr<const std::string> _input;
+		location _cur_location;
+		const std::string::value_type *_cur, *_end;
+		bool _ignore_comments;
+		bool _ignore_whitespace;
+		bool _ignore_pp_directives;
+		bool _ignore_line_directives;
+		bool _ignore_keywords;
+		bool _escape_string_literals;
+	};
+
+	/// <summary>
+	/// Get the names of all keywords and preprocessor directives (prefixed with '#') known to the lexer.
+	/// </summary>
+	std::vector<std::string> keyword_names();
+}
@@ -0,0 +1,279 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "pixel_conversion.hpp"
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+using namespace reshade;
+
+struct conversion
+{
+	const char *name;
+	pixel_format src_format;
+	pixel_format dst_format;
+	bool force_opaque;
+};
+
+// The conversions the runtime does when capturing screenshots and uploading images to textures
+static const conversion s_conversions[] = {
+	{ "bgra8 -> rgba8 (opaque)", pixel_format::bgra8_unorm, pixel_format::rgba8_unorm, true },
+	{ "bgra8_srgb -> rgba8_srgb (opaque)", pixel_format::bgra8_unorm_srgb, pixel_format::rgba8_unorm_srgb, true },
+	{ "rgba8 -> rgba8 (opaque)", pixel_format::rgba8_unorm, pixel_format::rgba8_unorm, true },
+	{ "rgba8 -> bgra8", pixel_format::rgba8_unorm, pixel_format::bgra8_unorm, false },
+	{ "rgb10a2 -> rgba8", pixel_format::rgb10a2_unorm, pixel_format::rgba8_unorm, false },
+	{ "rgb10a2 -> rgba8 (opaque)", pixel_format::rgb10a2_unorm, pixel_format::rgba8_unorm, true },
+	{ "bgr10a2 -> rgba8 (opaque)", pixel_format::bgr10a2_unorm, pixel_format::rgba8_unorm, true },
+	{ "rgba16f -> rgba8", pixel_format::rgba16_float, pixel_format::rgba8_unorm, false },
+	{ "rgba16f -> rgba8 (opaque)", pixel_format::rgba16_float, pixel_format::rgba8_unorm, true },
+	{ "rgba16f -> rgba8_srgb (opaque)", pixel_format::rgba16_float, pixel_format::rgba8_unorm_srgb, true },
+	{ "rgba8 -> r8", pixel_format::rgba8_unorm, pixel_format::r8_unorm, false },
+	{ "rgba8 -> rg8", pixel_format::rgba8_unorm, pixel_format::rg8_unorm, false },
+	{ "rgba8 -> rgba32f", pixel_format::rgba8_unorm, pixel_format::rgba32_float, false },
+	// These go through the generic path on all instruction sets
+	{ "rgba8 -> rgba16f", pixel_format::rgba8_unorm, pixel_format::rgba16_float, false },
+	{ "rgba8 -> rgba16", pixel_format::rgba8_unorm, pixel_format::rgba16_unorm, false },
+	{ "rgba8 -> rgb10a2", pixel_format::rgba8_unorm, pixel_format::rgb10a2_unorm, false },
+	{ "rgba8_srgb -> rgba8", pixel_format::rgba8_unorm_srgb, pixel_format::rgba8_unorm, false },
+};
+
+static const char *const s_isa_names[] = { "scalar", "sse2", "avx2" };
+
+static void fill_random(std::vector<uint8_t> &data, std::mt19937 &rng)
+{
+	for (uint8_t &value : data)
+		value = static_cast<uint8_t>(rng());
+}
+
+static size_t count_mismatches(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+		count += a[i] != b[i];
+	return count;
+}
+
+static bool verify(uint32_t width, uint32_t height)
+{
+	bool success = true;
+	std::mt19937 rng(42);
+
+	// Every instruction set has to produce exactly the same result as the scalar code, for every row length (to cover the remainder loops)
+	for (const conversion &conv : s_conversions)
+	{
+		const size_t src_size = pixel_format_size(conv.src_format), dst_size = pixel_format_size(conv.dst_format);
+
+		for (uint32_t w = 1; w <= width; w += w < 40 ? 1 : 97)
+		{
+			std::vector<uint8_t> src(w * height * src_size), reference(w * height * dst_size), result(reference.size());
+			fill_random(src, rng);
+
+			pixel_conversion_limit_isa(pixel_conversion_isa::scalar);
+			convert_pixels(conv.src_format, src.data(), w * src_size, conv.dst_format, reference.data(), w * dst_size, w, height, conv.force_opaque);
+
+			for (int isa = 1; isa <= static_cast<int>(pixel_conversion_supported_isa()); ++isa)
+			{
+				pixel_conversion_limit_isa(static_cast<pixel_conversion_isa>(isa));
+				convert_pixels(conv.src_format, src.data(), w * src_size, conv.dst_format, result.data(), w * dst_size, w, height, conv.force_opaque);
+
+				if (const size_t mismatches = count_mismatches(reference, result))
+				{
+					printf("FAILED: %s differs from scalar for '%s' with width %u (%zu bytes)\n", s_isa_names[isa], conv.name, w, mismatches);
+					success = false;
+				}
+			}
+		}
+	}
+
+	for (int isa = 0; isa <= static_cast<int>(pixel_conversion_supported_isa()); ++isa)
+	{
+		pixel_conversion_limit_isa(static_cast<pixel_conversion_isa>(isa));
+
+		// Decoding an 8-bit value to float and encoding it again has to give back the same value
+		for (const pixel_format format : { pixel_format::rgba8_unorm, pixel_format::rgba8_unorm_srgb })
+		{
+			std::vector<uint8_t> values(256 * 4), decoded(256 * 16), encoded(256 * 4);
+			for (size_t i = 0; i < values.size(); ++i)
+				values[i] = static_cast<uint8_t>(i / 4);
+
+			convert_pixels(format, values.data(), 0, pixel_format::rgba32_float, decoded.data(), 0, 256, 1);
+			convert_pixels(pixel_format::rgba32_float, decoded.data(), 0, format, encoded.data(), 0, 256, 1);
+
+			if (const size_t mismatches = count_mismatches(values, encoded))
+			{
+				printf("FAILED: %s round trip through float is not exact for %s (%zu bytes)\n", s_isa_names[isa], format == pixel_format::rgba8_unorm ? "unorm" : "sRGB", mismatches);
+				success = false;
+			}
+		}
+
+		// Check every possible half value against a reference encoding computed with a binary search over the sRGB thresholds
+		{
+			std::vector<uint8_t> halves(65536 * 8), result(65536 * 4);
+			for (uint32_t i = 0; i < 65536; ++i)
+				for (uint32_t c = 0; c < 4; ++c)
+					std::memcpy(&halves[i * 8 + c * 2], &i, 2);
+
+			std::vector<uint8_t> floats(65536 * 16);
+			convert_pixels(pixel_format::rgba16_float, halves.data(), 0, pixel_format::rgba32_float, floats.data(), 0, 65536, 1);
+			convert_pixels(pixel_format::rgba16_float, halves.data(), 0, pixel_format::rgba8_unorm_srgb, result.data(), 0, 65536, 1);
+
+			float thresholds[255];
+			for (int k = 0; k < 255; ++k)
+			{
+				const double v = (k + 0.5) / 255.0;
+				thresholds[k] = static_cast<float>(v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4));
+			}
+
+			size_t mismatches = 0;
+			for (uint32_t i = 0; i < 65536; ++i)
+			{
+				float v;
+				std::memcpy(&v, &floats[i * 16], 4);
+				v = v > 0.0f ? v : 0.0f; // Also turns NaN into zero
+				v = v < 1.0f ? v : 1.0f;
+
+				const uint8_t expected_color = static_cast<uint8_t>(std::upper_bound(thresholds, thresholds + 255, v) - thresholds);
+				const uint8_t expected_alpha = static_cast<uint8_t>(v * 255.0f + 0.5f);
+
+				mismatches += result[i * 4 + 0] != expected_color || result[i * 4 + 3] != expected_alpha;
+			}
+
+			if (mismatches != 0)
+			{
+				printf("FAILED: %s half to sRGB encoding differs from reference for %zu values\n", s_isa_names[isa], mismatches);
+				success = false;
+			}
+		}
+
+		// Converting in-place with a negative pitch flips the image, which is how the OpenGL back-end uses it
+		{
+			std::vector<uint8_t> src(7 * 5 * 4), flipped(src.size());
+			fill_random(src, rng);
+			flipped = src;
+
+			convert_pixels(pixel_format::bgra8_unorm, src.data() + 4 * 7 * 4, -7 * 4, pixel_format::bgra8_unorm, src.data() + 4 * 7 * 4, -7 * 4, 7, 5);
+			convert_pixels(pixel_format::rgba8_unorm, flipped.data() + 4 * 7 * 4, -7 * 4, pixel_format::bgra8_unorm, flipped.data() + 4 * 7 * 4, -7 * 4, 7, 5);
+			convert_pixels(pixel_format::bgra8_unorm, flipped.data(), 7 * 4, pixel_format::rgba8_unorm, flipped.data(), 7 * 4, 7, 5);
+
+			if (count_mismatches(src, flipped) != 0)
+			{
+				printf("FAILED: %s in-place conversion with negative pitch changed the image\n", s_isa_names[isa]);
+				success = false;
+			}
+		}
+	}
+
+	pixel_conversion_limit_isa(pixel_conversion_isa::avx2);
+
+	return success;
+}
+
+static void benchmark(uint32_t width, uint32_t height, unsigned int num_runs)
+{
+	std::mt19937 rng(1);
+
+	printf("%-36s", "conversion (MB/s of source data)");
+	for (int isa = 0; isa <= static_cast<int>(pixel_conversion_supported_isa()); ++isa)
+		printf("%10s", s_isa_names[isa]);
+	printf("\n");
+
+	for (const conversion &conv : s_conversions)
+	{
+		const size_t src_size = pixel_format_size(conv.src_format), dst_size = pixel_format_size(conv.dst_format);
+
+		std::vector<uint8_t> src(width * height * src_size), dst(width * height * dst_size);
+		fill_random(src, rng);
+
+		printf("%-36s", conv.name);
+
+		for (int isa = 0; isa <= static_cast<int>(pixel_conversion_supported_isa()); ++isa)
+		{
+			pixel_conversion_limit_isa(static_cast<pixel_conversion_isa>(isa));
+
+			// Take the fastest run, since anything slower is caused by outside interference
+			double best_time = 1e9;
+			for (unsigned int run = 0; run < num_runs; ++run)
+			{
+				const auto start = std::chrono::high_resolution_clock::now();
+				convert_pixels(conv.src_format, src.data(), width * src_size, conv.dst_format, dst.data(), width * dst_size, width, height, conv.force_opaque);
+				best_time = std::min(best_time, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+			}
+
+			printf("%10.0f", src.size() / best_time / 1e6);
+		}
+
+		printf("\n");
+	}
+
+	pixel_conversion_limit_isa(pixel_conversion_isa::avx2);
+}
+
+static void print_usage(const char *path)
+{
+	printf(R"(usage: %s [options]
+
+Verifies that all vectorized pixel conversion kernels match the scalar code and prints the throughput of each conversion per instruction set.
+Returns a non-zero exit code if verification fails.
+
+Options:
+  -h, --help                Print this help.
+
+  --width <value>           Image width used for benchmarking (default 3840).
+  --height <value>          Image height used for benchmarking (default 2160).
+  --runs <count>            Number of measured runs per conversion and instruction set (default 10).
+  --verify-only             Skip the benchmark.
+	)", path);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t width = 3840;
+	uint32_t height = 2160;
+	unsigned int num_runs = 10;
+	bool verify_only = false;
+
+	// Parse command-line arguments
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+
+		if (0 == std::strcmp(arg, "-h") || 0 == std::strcmp(arg, "--help"))
+		{
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (0 == std::strcmp(arg, "--verify-only"))
+		{
+			verify_only = true;
+			continue;
+		}
+
+		if (i + 1 >= argc)
+			continue;
+		else if (0 == std::strcmp(arg, "--width"))
+			width = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+		else if (0 == std::strcmp(arg, "--height"))
+			height = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+		else if (0 == std::strcmp(arg, "--runs"))
+			num_runs = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+	}
+
+	printf("Best supported instruction set: %s\n", s_isa_names[static_cast<int>(pixel_conversion_supported_isa())]);
+
+	if (!verify(300, 3))
+		return 1;
+
+	printf("Verification passed.\n\n");
+
+	if (!verify_only)
+		benchmark(width, height, num_runs);
+
+	return 0;
+}